@@ -0,0 +1,135 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <future>
+#include <vector>
+#include <atomic>
+#include <experimental/filesystem>
+#include "cancellation.h"
+#include "crawl_errors.h"
+#include "message_queue.h"
+#include "spsc_channel.h"
+#include "trace.h"
+
+using namespace std::experimental::filesystem;
+
+
+/*
+ * The same server farm as in concurency7, but the file names don't go through
+ * one shared MessageQueue.
+ *
+ * In concurency7 all NUM_THREADS listDirServers push into the same fileQueue, so
+ * every file name means taking the same mutex - N producers fight for 1 lock,
+ * while there is only 1 consumer anyway.
+ *
+ * Here every dir server gets its own single producer / single consumer lane
+ * (include/spsc_channel.h). A lane has exactly one writer and one reader so
+ * it needs no lock at all, only two indices on separate cache lines.
+ * The print server polls the lanes round robin.
+ *
+ * Directories still go through MessageQueue - here we really have many producers
+ * and many consumers.
+ *
+ * Like in concurency7 a directory which can't be read goes to an ErrorTable: a server which
+ * died on an exception would never decrement pending nor close its lane, and the crawl would
+ * never end (see include/crawl_errors.h).
+ */
+
+constexpr int NUM_THREADS = 10;
+
+
+void listDirServer (MessageQueue<path> & dirQueue, SpscChannel<std::string>& fileLane,
+                    std::atomic<int>& pending, ErrorTable& errors)
+{
+    std::vector<CrawlError> dirErrors;
+    Tracer::setThreadName("listDirServer");
+    for (;;)
+    {
+        path dir = dirQueue.recieve();
+        if (dir.empty())
+            break;
+
+        TRACE_SCOPE("task", "listDirServer dir");
+        forEachEntry(dir, dirErrors, CancellationToken(),
+                     [&](path&& p)
+                     {
+                         ++pending;
+                         dirQueue.send(std::move(p));
+                     },
+                     [&](const path& p, const struct stat&)
+                     {
+                         fileLane.send(p.filename());
+                     });
+        errors.add(dirErrors);
+
+        // lane publishes in batches - don't keep the names while we wait for the next dir
+        fileLane.flush();
+
+        if (--pending == 0)
+        {
+            for (int i = 0; i < NUM_THREADS; ++i)
+                dirQueue.send(path());
+        }
+    }
+
+    //print server stops when all the lanes are closed
+    fileLane.close();
+}
+
+
+void printServer (SpscLanes<std::string>& lanes)
+{
+    Tracer::setThreadName("printServer");
+    std::string name;
+    while (lanes.receive(name))
+    {
+        std::cout << name << "\n";
+    }
+    std::cout << std::flush;
+}
+
+void listTree (path&& rootDir)
+{
+    MessageQueue<path> dirQueue;
+    SpscLanes<std::string> fileLanes(NUM_THREADS);
+    std::atomic<int> pending(1);
+    ErrorTable errors;
+    dirQueue.send(std::move(rootDir));
+
+    std::vector<std::future<void>> futures;
+
+    //Spawn #NUM_THREADS servers, each with its own lane
+    for (int i = 0; i < NUM_THREADS; ++i) {
+        futures.push_back(
+                    std::async(std::launch::async, &listDirServer,
+                               std::ref(dirQueue),
+                               std::ref(fileLanes.lane(i)),
+                               std::ref(pending),
+                               std::ref(errors)));
+    }
+
+    //Spawn one print server
+    futures.push_back(std::async(std::launch::async, &printServer, std::ref(fileLanes)));
+
+    try {
+        while(!futures.empty())
+        {
+            auto ftr = std::move(futures.back());
+            futures.pop_back();
+            ftr.get();
+        }
+    } catch (std::exception& e) {
+        std::cout << "Exception: " << e.what() << std::endl;
+    }
+    errors.print(std::cerr);
+}
+
+
+
+int main(int argc, char *argv[])
+{
+    TraceSession trace;
+
+    std::string root(argc > 1 ? argv[1] : "/home/jpola/Projects/Concurency");
+    listTree(path(root));
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include "list_directory.h"
+#include "fork_join.h"
+#include "fork_join_algorithms.h"
+
+/*
+ * Fork / join revisited.
+ *
+ * In concurency4 every subdirectory got its own std::async - its own OS thread.
+ * The shape of that code is a general one: split the problem, solve the parts in parallel,
+ * wait for them (join) and combine the results. Here the same shape runs on a ForkJoinPool
+ * (include/fork_join.h): the parts are small tasks on a fixed number of threads,
+ * and below a cutoff the recursion is just serial.
+ *
+ * Three clients of the same engine:
+ *  1. directory listing (listDirectoryForkJoin)
+ *  2. quicksort - fork the left partition, sort the right one ourselves
+ *  3. reduce - fork the left half, reduce the right one ourselves
+ */
+
+template<typename F>
+long long timeUs(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+void example1(ForkJoinPool& pool, const std::string& root)
+{
+    string_vector listing;
+    long long us = timeUs([&] { listing = listDirectoryForkJoin(pool, root); });
+    std::cout << "Listed " << listing.size() << " entries in " << us << " us" << std::endl;
+}
+
+void example2(ForkJoinPool& pool)
+{
+    std::vector<int> data(1000000);
+    std::mt19937 gen(42);
+    std::generate(data.begin(), data.end(), [&gen] { return static_cast<int>(gen()); });
+    std::vector<int> copy(data);
+
+    long long parallelUs = timeUs([&] { parallelQuicksort(pool, data.begin(), data.end()); });
+    long long serialUs = timeUs([&] { std::sort(copy.begin(), copy.end()); });
+
+    std::cout << "Quicksort of " << data.size() << " ints: " << parallelUs << " us, std::sort: "
+              << serialUs << " us, same result: " << std::boolalpha << (data == copy) << std::endl;
+}
+
+void example3(ForkJoinPool& pool)
+{
+    std::vector<double> data(4000000);
+    std::iota(data.begin(), data.end(), 0.0);
+
+    double parallelSum = 0, serialSum = 0;
+    long long parallelUs = timeUs([&]
+    {
+        parallelSum = parallelReduce(pool, data.begin(), data.end(), 0.0, std::plus<double>());
+    });
+    long long serialUs = timeUs([&] { serialSum = std::accumulate(data.begin(), data.end(), 0.0); });
+
+    std::cout << "Sum of " << data.size() << " doubles: " << parallelUs << " us, std::accumulate: "
+              << serialUs << " us, sums " << parallelSum << " / " << serialSum << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string root(argc > 1 ? argv[1] : "/home/jpola/Projects");
+
+    ForkJoinPool pool;
+    std::cout << pool.threads() << " worker threads.\n";
+
+    std::cout << " -- example 1 -- " << std::endl;
+    try
+    {
+        example1(pool, root);
+    }
+    catch (std::exception& e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+    std::cout << " -- example 1 end -- " << std::endl;
+
+    std::cout << " -- example 2 -- " << std::endl;
+    example2(pool);
+    std::cout << " -- example 2 end -- " << std::endl;
+
+    std::cout << " -- example 3 -- " << std::endl;
+    example3(pool);
+    std::cout << " -- example 3 end -- " << std::endl;
+}
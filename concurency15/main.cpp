@@ -0,0 +1,158 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <future>
+#include <vector>
+#include "big_factorial.h"
+#include "fork_join.h"
+#include "memo_cache.h"
+
+/*
+ * Factorial revisited.
+ *
+ * concurency11/12 compute factorial in an int - from 13! on the result overflows -
+ * and the "parallel" part is four tasks computing the very same value.
+ *
+ * Here the value is a BigInteger (include/big_integer.h) and the work itself is split:
+ * the range 2..n is multiplied by binary splitting on a ForkJoinPool, the two halves
+ * of every level are fork/join tasks and the big products use Karatsuba (include/big_factorial.h).
+ *
+ * Like in concurency12 one n is broadcast by a shared_future, but every request is different:
+ * n!, (n/2)!, C(n, n/2), C(n, n/10). factorialAsync / binomialAsync return std::future<BigInteger>.
+ *
+ * When the same requests arrive at once, MemoCache (include/memo_cache.h) computes each n! only once:
+ * the first request starts it, the duplicates share its shared_future.
+ */
+
+template<typename F>
+long long timeUs(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+void example1()
+{
+    // the numbers concurency11 can't do
+    for (std::uint32_t n : { 12u, 13u, 20u, 30u })
+        std::cout << n << "! = " << factorial(n).toString() << std::endl;
+}
+
+void example2(ForkJoinPool& pool, std::uint32_t n)
+{
+    BigInteger serial, parallel;
+    long long serialUs = timeUs([&] { serial = factorial(n); });
+    long long parallelUs = timeUs([&] { parallel = factorialAsync(pool, n).get(); });
+
+    std::cout << n << "! has " << parallel.bits() << " bits. Serial: " << serialUs << " us, pool: "
+              << parallelUs << " us, same result: " << std::boolalpha << (serial == parallel) << std::endl;
+}
+
+void example3(ForkJoinPool& pool, std::uint32_t n)
+{
+    std::promise<std::uint32_t> p;
+    std::shared_future<std::uint32_t> sf = p.get_future().share();
+
+    // requests wait for n, then run on the pool
+    auto request = [&pool, sf](int kind) -> BigInteger
+    {
+        std::uint32_t N = sf.get();
+        switch (kind)
+        {
+        case 0:  return factorialAsync(pool, N).get();
+        case 1:  return factorialAsync(pool, N / 2).get();
+        case 2:  return binomialAsync(pool, N, N / 2).get();
+        default: return binomialAsync(pool, N, N / 10).get();
+        }
+    };
+    const char* names[] = { "n!", "(n/2)!", "C(n, n/2)", "C(n, n/10)" };
+
+    std::vector<std::future<BigInteger>> futures;
+    for (int kind = 0; kind < 4; ++kind)
+        futures.push_back(std::async(std::launch::async, request, kind));
+
+    p.set_value(n);
+
+    for (int kind = 0; kind < 4; ++kind)
+        std::cout << names[kind] << " for n = " << n << " has " << futures[kind].get().bits() << " bits" << std::endl;
+}
+
+/// Process CPU time (all threads) in ms
+double cpuMs()
+{
+    return 1000.0 * std::clock() / CLOCKS_PER_SEC;
+}
+
+void example4(std::uint32_t n)
+{
+    const int REQUESTS = 64;
+    const std::uint32_t distinct[] = { n / 8, n / 4, n / 2, n };
+
+    // every request computes its own n!
+    double cpuStart = cpuMs();
+    long long plainUs = timeUs([&]
+    {
+        std::vector<std::future<std::size_t>> futures;
+        for (int i = 0; i < REQUESTS; ++i)
+        {
+            std::uint32_t m = distinct[i % 4];
+            futures.push_back(std::async(std::launch::async, [m] { return factorial(m).bits(); }));
+        }
+        for (auto& f : futures)
+            f.get();
+    });
+    double plainCpu = cpuMs() - cpuStart;
+
+    // the same requests through the cache
+    MemoCache<std::uint32_t, BigInteger> cache(16);
+    cpuStart = cpuMs();
+    long long cachedUs = timeUs([&]
+    {
+        std::vector<std::future<std::size_t>> futures;
+        for (int i = 0; i < REQUESTS; ++i)
+        {
+            std::uint32_t m = distinct[i % 4];
+            futures.push_back(std::async(std::launch::async, [m, &cache]
+            {
+                return cache.get(m, [m] { return factorial(m); }).get().bits();
+            }));
+        }
+        for (auto& f : futures)
+            f.get();
+    });
+    double cachedCpu = cpuMs() - cpuStart;
+
+    MemoCache<std::uint32_t, BigInteger>::Stats st = cache.stats();
+    std::cout << REQUESTS << " requests for 4 different factorials\n"
+              << "  without cache: " << plainUs << " us, cpu " << plainCpu << " ms\n"
+              << "  with cache:    " << cachedUs << " us, cpu " << cachedCpu << " ms ("
+              << st.misses << " computed, " << st.joins << " joined, " << st.hits << " hits)" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::uint32_t n = argc > 1 ? static_cast<std::uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 100000;
+
+    ForkJoinPool pool;
+    std::cout << pool.threads() << " worker threads.\n";
+
+    std::cout << " -- example 1 -- " << std::endl;
+    example1();
+    std::cout << " -- example 1 end -- " << std::endl;
+
+    std::cout << " -- example 2 -- " << std::endl;
+    example2(pool, n);
+    std::cout << " -- example 2 end -- " << std::endl;
+
+    std::cout << " -- example 3 -- " << std::endl;
+    example3(pool, n);
+    std::cout << " -- example 3 end -- " << std::endl;
+
+    std::cout << " -- example 4 -- " << std::endl;
+    example4(n);
+    std::cout << " -- example 4 end -- " << std::endl;
+}
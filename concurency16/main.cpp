@@ -0,0 +1,46 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include "duplicate_finder.h"
+#include "trace.h"
+
+/*
+ * Duplicate files.
+ *
+ * The crawls of concurency4 - 7 stop at the file names. Here the crawl is only the first stage
+ * of a pipeline which finds files with the same content (include/duplicate_finder.h):
+ * crawl -> group by size -> hash of the first 4 KB -> group -> full hash -> group.
+ * Every stage has its own threads and passes its results on through a bounded queue.
+ *
+ * Run with CONCURENCY_TRACE=trace.json to see the stages working at the same time.
+ */
+
+int main(int argc, char *argv[])
+{
+    TraceSession trace;
+
+    std::string root(argc > 1 ? argv[1] : "/home/jpola/Projects");
+
+    auto start = std::chrono::steady_clock::now();
+    DuplicateReport report = findDuplicates(root);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    // the biggest groups first
+    std::sort(report.groups.begin(), report.groups.end(),
+              [](const std::vector<std::string>& a, const std::vector<std::string>& b) { return a.size() > b.size(); });
+
+    const std::size_t SHOW = 10;
+    for (std::size_t i = 0; i < report.groups.size() && i < SHOW; ++i)
+    {
+        std::cout << report.groups[i].size() << " copies:\n";
+        for (const std::string& f : report.groups[i])
+            std::cout << "\t" << f << "\n";
+    }
+
+    std::cout << "\n" << report.files << " files, " << report.sizeCandidates << " with a common size, "
+              << report.prefixCandidates << " with a common prefix, " << report.duplicateFiles()
+              << " duplicates in " << report.groups.size() << " groups\n"
+              << report.bytesHashed / (1024.0 * 1024.0) << " MB hashed in " << ms.count() << " ms, "
+              << report.errors << " unreadable" << std::endl;
+}
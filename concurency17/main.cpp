@@ -0,0 +1,46 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include "tree_watcher.h"
+#include "trace.h"
+
+/*
+ * Watch mode.
+ *
+ * concurency4 - 7 list the tree once; to see what changed they have to list it all again.
+ * TreeWatcher (include/tree_watcher.h) crawls once and then keeps the index up to date
+ * from inotify events, handled by a single event thread. Nothing is listed again unless
+ * a new directory appears or the kernel's event queue overflows.
+ *
+ * Run it, then create, delete and rename files under the root from another terminal.
+ */
+
+int main(int argc, char *argv[])
+{
+    TraceSession trace;
+
+    std::string root(argc > 1 ? argv[1] : "/home/jpola/Projects/Concurency");
+    int seconds = argc > 2 ? std::stoi(argv[2]) : 10;
+
+    auto start = std::chrono::steady_clock::now();
+    TreeWatcher watcher(root);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    WatchStats s = watcher.stats();
+    std::cout << "initial crawl: " << s.entries << " entries, " << s.watches << " watches in "
+              << ms.count() << " ms" << std::endl;
+    if (s.watchErrors)
+        std::cout << s.watchErrors << " directories not watched - see fs.inotify.max_user_watches" << std::endl;
+    if (s.scanErrors)
+        std::cout << s.scanErrors << " directories or entries couldn't be read" << std::endl;
+
+    for (int i = 0; i < seconds; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        s = watcher.stats();
+        std::cout << i + 1 << " s: " << s.entries << " entries, " << s.events << " events, "
+                  << s.rescans << " rescans, " << s.overflows << " overflows, event thread cpu "
+                  << s.eventThreadCpuNs / 1e6 << " ms" << std::endl;
+    }
+}
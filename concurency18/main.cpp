@@ -0,0 +1,65 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include "coro_crawl.h"
+#include "list_directory.h"
+
+/*
+ * Directory traversal with C++20 coroutines (include/coro_task.h, include/coro_crawl.h).
+ *
+ * concurency4 lists every subdirectory in its own std::async - a thread which spends most
+ * of its life waiting in get() for its own children. Here a directory is a Task: co_await
+ * on the children suspends it, and its thread goes on with other directories. The whole tree
+ * runs on a pool of a few threads, a waiting directory costs only its coroutine frame.
+ *
+ * This target is built with -std=c++20 (see CMakeLists.txt), the rest of the repo is C++11.
+ */
+
+template<typename F>
+long long timeUs(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 1. the same listing as concurency4 - with threads and with coroutines
+void example1(const std::string& root)
+{
+    string_vector threads, coroutines;
+    long long usThreads = timeUs([&] { threads = listDirectory(std::string(root)); });
+
+    CoroPool pool(4);
+    long long usCoro = timeUs([&] { coroutines = syncWait(pool, listDirectoryCoro(pool, root)); });
+
+    std::cout << "std::async:  " << threads.size() << " entries in " << usThreads << " us\n"
+              << "coroutines:  " << coroutines.size() << " entries in " << usCoro << " us on "
+              << pool.threads() << " threads" << std::endl;
+}
+
+// 2. streaming - the generator yields entry by entry, we stop after the first ten
+void example2(const std::string& root)
+{
+    int n = 0;
+    for (const fs::path& p : walkTree(root))
+    {
+        std::cout << "\t" << p.string() << "\n";
+        if (++n == 10)
+            break;
+    }
+    std::cout << "(stopped after " << n << " entries - the rest of the tree was never listed)" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string root(argc > 1 ? argv[1] : "/home/jpola/Projects");
+
+    std::cout << " -- example 1 -- " << std::endl;
+    example1(root);
+    std::cout << " -- example 1 end\n -- " << std::endl;
+
+    std::cout << " -- example 2 -- " << std::endl;
+    example2(root);
+    std::cout << " -- example 2 end\n -- " << std::endl;
+}
@@ -4,6 +4,8 @@
 #include <cmath>
 #include <chrono>
 #include <thread>
+#include <unistd.h>
+#include "sin_graph.h"
 
 void display_graph (std::list<double>& lst)
 {
@@ -131,6 +133,24 @@ void example3()
 
 }
 
+// The same graph as a pipeline (include/sin_graph.h): a thread computes sin chunk by chunk
+// into two buffers, the main thread renders the other one and writes it with one write().
+// Here chunks of 8 points, so the 33 points go through the buffers a few times.
+void example4()
+{
+    std::list<double> list;
+    const double pi = 3.141592;
+    const double epsilon = 0.0000001;
+
+    for (double x = 0.0; x < 2* pi + epsilon; x += pi/16.)
+    {
+        list.push_back(x) ;
+    }
+
+    std::cout.flush();  // the pipeline writes to the file descriptor, past cout's buffer
+    sinGraphPipeline(list.begin(), list.end(), STDOUT_FILENO, 8);
+}
+
 int main()
 {
     unsigned int n = std::thread::hardware_concurrency();
@@ -148,4 +168,8 @@ int main()
     std::cout << " -- example 3 -- " << std::endl;
     example3();
     std::cout << " -- example 3 end -- " << std::endl;
+
+    std::cout << " -- example 4 -- " << std::endl;
+    example4();
+    std::cout << " -- example 4 end -- " << std::endl;
 }
@@ -8,6 +8,9 @@
 
 //This header requires to link with stdc++fs // experimental filesystem
 #include <experimental/filesystem>
+#include "executor.h"
+#include "list_directory.h"
+#include "walk_policy.h"
 /*
  * This is related to task / thread parallelism. How to deal with many tasks
  */
@@ -45,46 +48,7 @@ void example1()
 
 
 // This is good example of hiding disk I/O latency we will list many directories concurrently
-//using namespace boost::filesystem;
-typedef std::vector<std::string> string_vector;
-
-string_vector listDirectory(std::string&& dir)
-{
-    string_vector listing;
-    std::string dirStr("\n> ");
-    dirStr += dir;
-    dirStr += ":\n\t ";
-    listing.push_back(dirStr);
-
-
-    std::vector<std::future<string_vector>> futures;
-    for (std::experimental::filesystem::directory_iterator it(dir);
-         it != std::experimental::filesystem::directory_iterator(); ++it)
-    {
-       //if this is a directory
-       if (std::experimental::filesystem::is_directory(it->path()))
-       {
-
-           auto ftr = std::async(std::launch::async, &listDirectory, it->path());
-           futures.push_back(std::move(ftr));
-       }
-       else
-       {
-           listing.push_back(it->path().filename());
-       }
-    }
-
-    std::for_each(futures.begin(), futures.end(), [&listing](std::future<string_vector>& f)
-    {
-        string_vector lst = f.get();
-        // instead of copy we are moving;
-        std::copy(std::make_move_iterator(std::begin(lst)),
-                  std::make_move_iterator(std::end(lst)),
-                  std::back_inserter(listing));
-    });
-
-    return listing;
-}
+// listDirectory lives in include/list_directory.h so the benchmarks can use it too
 
 
 void example2()
@@ -92,7 +56,10 @@ void example2()
 
     std::experimental::filesystem::path root("/home/jpola/Projects");
 
-    auto ftr = std::async(std::launch::async, &listDirectory, root);
+    // give up on the listing after 10 seconds - every task of the tree gets the same deadline
+    CancellationToken token = CancellationToken().withTimeout(std::chrono::seconds(10));
+    auto ftr = std::async(std::launch::async, &listDirectory, root, token, std::ref(defaultExecutor()),
+                          static_cast<WalkPolicy*>(nullptr));
 
     try
     {
@@ -115,6 +82,47 @@ void example2()
 }
 
 
+// The same listing with the tasks on different executors (include/executor.h).
+// The default - a new thread for every directory - is what example2 does.
+void example3(const std::string& root)
+{
+    InlineExecutor inlineExecutor;
+    NewThreadExecutor newThread;
+    FixedThreadPool pool(8);
+    WorkStealingExecutor stealing(8);
+    Executor* executors[] = { &inlineExecutor, &newThread, &pool, &stealing };
+
+    for (Executor* executor : executors)
+    {
+        auto start = std::chrono::steady_clock::now();
+        string_vector listing = listDirectory(std::string(root), CancellationToken(), *executor);
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << executor->name() << ": " << listing.size() << " entries in " << us.count() << " us" << std::endl;
+    }
+}
+
+
+// The same listing following the symlinks: one WalkPolicy for all the tasks of the tree,
+// so a directory reached through several links is listed once and a link to a parent ends.
+void example4(const std::string& root)
+{
+    WalkOptions opt;
+    opt.followSymlinks = true;
+    WalkPolicy walk(root, opt);
+    FixedThreadPool pool(8);
+    try
+    {
+        string_vector listing = listDirectory(std::string(root), CancellationToken(), pool, &walk);
+        std::cout << "following symlinks: " << listing.size() << " entries in " << walk.visited()
+                  << " directories, " << walk.seenAgain() << " reached again through a link" << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+}
+
+
 int main(int argc, char *argv[])
 {
 
@@ -128,4 +136,12 @@ int main(int argc, char *argv[])
     std::cout << " -- example 2 -- " << std::endl;
     example2();
     std::cout << " -- example 2 end\n -- " << std::endl;
+
+    std::cout << " -- example 3 -- " << std::endl;
+    example3(argc > 1 ? argv[1] : "/home/jpola/Projects");
+    std::cout << " -- example 3 end\n -- " << std::endl;
+
+    std::cout << " -- example 4 -- " << std::endl;
+    example4(argc > 1 ? argv[1] : "/home/jpola/Projects");
+    std::cout << " -- example 4 end\n -- " << std::endl;
 }
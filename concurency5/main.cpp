@@ -4,7 +4,15 @@
 #include <future>
 #include <vector>
 #include <algorithm>
+#include <cstdlib>
 #include <experimental/filesystem>
+#include "batched_crawl.h"
+#include "cancellation.h"
+#include "crawl_hooks.h"
+#include "crawl_stream.h"
+#include "frontier.h"
+#include "trace.h"
+#include "walk_policy.h"
 
 using namespace std::experimental::filesystem;
 
@@ -17,126 +25,115 @@ using namespace std::experimental::filesystem;
  * That will flood the processor. We would like to limit it i.e. up to 4 threads
  */
 
-struct Result
+// Result, listDir and listAllFiles live in include/batched_crawl.h
+
+int main(int argc, char *argv[])
 {
-    std::vector<std::string> files;
-    std::vector<path> dirs;
+    // run with CONCURENCY_TRACE=trace.json to see the workers waiting at the batch barrier
+    TraceSession trace;
 
-    Result () {}
-    //Create move semantics to be able to RVO
-    //but since we defined move ctor we have to cvreate explicit default ctor
-    Result (Result && r): files(std::move(r.files)), dirs(std::move(r.dirs))
-    {
+    std::string root(argc > 1 ? argv[1] : "/home/jpola/OpenFOAM");
 
-    }
+    auto startTime = std::chrono::system_clock::now();
 
-    Result & operator=(Result&& r)
-    {
-        files = std::move(r.files);
-        dirs = std::move(r.dirs);
+    for (int i = 0; i < 25; i++)
+        auto files = listAllFiles(root);
+
+    auto endTime = std::chrono::system_clock::now();
+
+    auto duration = (endTime - startTime)/25;
+    auto durationMs = std::chrono::duration_cast<std::chrono::microseconds>(duration);
 
-        return *this;
+    std::cout << "\nSearch performed in " << durationMs.count() << std::endl;
+
+    // directories and entries which couldn't be read don't stop the crawl - they are counted
+    {
+        ErrorTable errors;
+        CrawlHooks hooks;
+        hooks.errors = &errors;
+        auto files = listAllFiles(root, 8, CancellationToken(), defaultExecutor(), hooks);
+        std::cout << files.size() << " files, " << errors.total() << " errors" << std::endl;
+        errors.print(std::cout);
     }
-};
 
+    // following the symlinks - every directory once, however many links lead to it
+    {
+        WalkOptions opt;
+        opt.followSymlinks = true;
+        WalkPolicy walk(root, opt);
+        CrawlHooks hooks;
+        hooks.walk = &walk;
+        auto files = listAllFiles(root, 8, CancellationToken(), defaultExecutor(), hooks);
+        std::cout << "following symlinks: " << files.size() << " files in " << walk.visited()
+                  << " directories, " << walk.seenAgain() << " reached again through a link" << std::endl;
+    }
 
-Result listDir (path && dir)
-{
-    Result result;
-    for (directory_iterator it(dir); it != directory_iterator(); ++it)
+    // CONCURENCY_PROGRESS=<ms> - one more crawl which reports its progress to stderr every <ms>
+    if (const char* ms = std::getenv("CONCURENCY_PROGRESS"))
     {
-        if (is_directory(it->path()))
+        std::chrono::milliseconds interval;
+        if (!parseProgressInterval(ms, interval))
         {
-            result.dirs.push_back(it->path());
+            std::cerr << "CONCURENCY_PROGRESS: the interval in ms, at least 1" << std::endl;
         }
         else
         {
-            result.files.push_back(it->path().filename());
+            CrawlProgress progress;
+            ProgressReporter reporter(progress, interval, std::cerr);
+            CrawlHooks hooks;
+            hooks.progress = &progress;
+            listAllFiles(root, 8, CancellationToken(), defaultExecutor(), hooks);
         }
     }
 
-    return result; //RVO;
-}
-
-std::vector<std::string> listAllFiles(std::string& root)
-{
-    std::vector<path> dirsToDo;
-    dirsToDo.push_back(root);
-
-    //accumulator for list of files;
-    std::vector<std::string> files;
-
-    //we don't want to create unbounded number of tasks
-    while(!dirsToDo.empty())
+    // the order of the directories: depth first, breadth first, hybrid
+    // (bounded to 1024 paths in memory, the rest goes to a temporary file)
+    for (TraversalPolicy policy : { TraversalPolicy::DepthFirst, TraversalPolicy::BreadthFirst, TraversalPolicy::Hybrid })
     {
-        std::vector<std::future<Result>> futures;
+        DirFrontier frontier(policy, 1024);
+        auto start = std::chrono::steady_clock::now();
+        auto files = listAllFiles(root, frontier);
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << policyName(policy) << ": " << files.size() << " files in " << us.count()
+                  << " us, frontier peak " << frontier.peakSize() << " paths ("
+                  << frontier.peakMemoryBytes() << " bytes in memory, " << frontier.spilled() << " spilled)" << std::endl;
+    }
 
-        //limit the number of tasks to 4
-        for (int i = 0; i < 8 && !dirsToDo.empty(); ++i)
+    // the same files as a stream (include/crawl_stream.h) - the first ones come
+    // while the workers are still crawling, at most 16 batches wait in memory
+    {
+        auto start = std::chrono::steady_clock::now();
+        CrawlStream stream(root);
+        std::vector<std::string> batch;
+        std::size_t n = 0;
+        long long firstUs = -1;
+        while (stream.next(batch))
         {
-            /* We are poping down the directories to do from back to beginning
-            *  pop_back Removes last element.
-            *  This is a typical stack operation. It shrinks the %vector by one.
-            *
-            *  Firstly we have moved the last element
-            *  so later we have to remove it from the list (pop_back)
-            */
-            auto ftr = std::async(std::launch::async, &listDir, std::move(dirsToDo.back()));
-            dirsToDo.pop_back();
-            futures.push_back(std::move(ftr));
+            if (firstUs < 0)
+                firstUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+            n += batch.size();
         }
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << "stream: " << n << " files in " << us.count() << " us, the first after " << firstUs
+                  << " us, at most " << stream.peakBuffered() << " paths buffered" << std::endl;
+    }
 
+    // concurency5 <root> <timeout ms> - the same search with a deadline
+    if (argc > 2)
+    {
+        CancellationToken token = CancellationToken().withTimeout(std::chrono::milliseconds(std::atol(argv[2])));
         try
         {
-            //here we are creating barrier
-            while(!futures.empty())
-            {
-                auto ftr = std::move(futures.back());
-                futures.pop_back();
-                Result result = ftr.get(); //Get the result;
-                //back inserter will do push backs - which means it will add the elements to the end of the vector
-                std::move(result.files.begin(), result.files.end(), std::back_inserter(files));
-                //add (sub)directories to be parsed
-                std::move(result.dirs.begin(), result.dirs.end(), std::back_inserter(dirsToDo));
-
-            }
+            auto files = listAllFiles(root, 8, token);
+            std::cout << "Found " << files.size() << " files before the deadline" << std::endl;
         }
-        catch (std::system_error& e)
+        catch (OperationCancelled& e)
         {
-            std::cout << "System error: " << e.code().message() << std::endl;
-        }
-
-        catch (std::exception& e)
-        {
-            std::cout << "Exception: " << e.what() << std::endl;
-        }
-
-        catch (...)
-        {
-            std::cout <<"Unknown Exception" << std::endl;
+            auto late = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - token.deadline());
+            std::cout << e.what() << ", all tasks stopped " << late.count() << " us after the deadline" << std::endl;
         }
     }
 
-    return files;
-
-}
-
-int main(int argc, char *argv[])
-{
-    std::string root("/home/jpola/OpenFOAM");
-
-    auto startTime = std::chrono::system_clock::now();
-
-    for (int i = 0; i < 25; i++)
-        auto files = listAllFiles(root);
-
-    auto endTime = std::chrono::system_clock::now();
-
-    auto duration = (endTime - startTime)/25;
-    auto durationMs = std::chrono::duration_cast<std::chrono::microseconds>(duration);
-
-    std::cout << "\nSearch performed in " << durationMs.count() << std::endl;
-
 
 //    std::for_each(files.begin(), files.end(), [](std::string & s)
 //    {
@@ -4,7 +4,10 @@
 #include <future>
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include <cstdlib>
 #include <experimental/filesystem>
+#include "monitor_crawl.h"
 
 using namespace std::experimental::filesystem;
 
@@ -25,184 +28,96 @@ using namespace std::experimental::filesystem;
  */
 
 
-struct Result
-{
-    std::vector<std::string> files;
-    std::vector<path> dirs;
+// Result, MonitorResult, listDir and listAllFilesShared live in include/monitor_crawl.h
 
-    Result () {}
-    //Create move semantics to be able to RVO
-    //but since we defined move ctor we have to cvreate explicit default ctor
-    Result (Result && r): files(std::move(r.files)), dirs(std::move(r.dirs))
+void listAllFiles(std::string& root)
+{
+    // what couldn't be read goes into the ErrorTable instead of an exception
+    ErrorTable errors;
+    CrawlHooks hooks;
+    hooks.errors = &errors;
+    auto r = listAllFilesShared(root, 16, CancellationToken(), defaultExecutor(), hooks);
+    std::for_each(r.files.begin(), r.files.end(), [](std::string & s)
     {
+        std::cout << s << "\n";
 
-    }
-
-    Result & operator=(Result&& r)
-    {
-        files = std::move(r.files);
-        dirs = std::move(r.dirs);
+    });
 
-        return *this;
-    }
-};
+    errors.print(std::cerr);
 
+}
 
-//create monitor pattern for result data;
-/// Monitor pattern should aquire locks in each public functions
-/// It makes it thread-safe
-class MonitorResult
+int main(int argc, char *argv[])
 {
-    Result _result;
-    std::mutex _mutex; //used for synchronization
-public:
-
-    bool isDirsEmpty()
-    {
-        std::lock_guard<std::mutex> lck(_mutex);
-        return _result.dirs.empty();
-    }
+    std::string root(argc > 1 ? argv[1] : "/home/jpola/Projects/Concurency");
 
-    //encapsulation to access the files vector;
-    void putFile(std::string&& file)
-    {
-        ///This piece of code is not very secure.
-        /// If we have an exception from push_back the mutex will
-        /// not be unlocked due to interuption.
-//        _mutex.lock();
-//        _result.files.push_back(file);
-//        _mutex.unlock();
-
-        ///The solution is to use lock_guard.
-        /// It will release mutex when the lock_guard desctuctor is called!
-        /// In this case when code is interrupted when stack will be unvinded _mutex will be released;
-
-        //This is RAII object. Resource Aquisition Is Initialisation.
-        std::lock_guard<std::mutex> lck(_mutex);
-        _result.files.push_back(file);
-    }
-
-    void putDir(path&& pth)
-    {
-        std::lock_guard<std::mutex> lck(_mutex);
-        _result.dirs.push_back(pth);
+    auto startTime = std::chrono::system_clock::now();
 
-    }
+    //for (int i = 0; i < 25; i++)
+        listAllFiles(root);
 
-    std::vector<path> getDirs(int n)
-    {
-        std::vector<path> dirs;
-        std::lock_guard<std::mutex> lck(_mutex);
-        for (int i = 0; i < n && !_result.dirs.empty(); ++i)
-        {
-            dirs.push_back(std::move(_result.dirs.back()));
-            _result.dirs.pop_back();
-        }
-        return dirs;
-    }
+    auto endTime = std::chrono::system_clock::now();
 
-    Result getResult()
-    {
-        Result res = std::move(_result);
-        return res;
-    }
-};
+    auto duration = (endTime - startTime)/25;
+    auto durationMs = std::chrono::duration_cast<std::chrono::microseconds>(duration);
 
-// Sharing result data
-void listDir (path && dir, MonitorResult& result)
-{
+    std::cout << "\nSearch performed in " << durationMs.count() << std::endl;
 
-    for (directory_iterator it(dir); it != directory_iterator(); ++it)
+    // CONCURENCY_PROGRESS=<ms> - one more crawl which reports its progress to stderr every <ms>
+    if (const char* ms = std::getenv("CONCURENCY_PROGRESS"))
     {
-        if (is_directory(it->path()))
+        std::chrono::milliseconds interval;
+        if (!parseProgressInterval(ms, interval))
         {
-            auto pth = it->path();
-            result.putDir(std::move(pth));
+            std::cerr << "CONCURENCY_PROGRESS: the interval in ms, at least 1" << std::endl;
         }
         else
         {
-            result.putFile(it->path().filename());
+            CrawlProgress progress;
+            ProgressReporter reporter(progress, interval, std::cerr);
+            CrawlHooks hooks;
+            hooks.progress = &progress;
+            listAllFilesShared(root, 16, CancellationToken(), defaultExecutor(), hooks);
         }
     }
 
-}
-
-void listAllFiles(std::string& root)
-{
-
-    //Create shared data
-    MonitorResult result;
-    result.putDir(path(root));
-
-
-    //we don't want to create unbounded number of tasks
-    while(!result.isDirsEmpty())
+    // CONCURENCY_SORTED=1 - one more crawl, the full paths of the files printed in sorted order;
+    // CONCURENCY_SORT_BUDGET=<bytes> - runs over <bytes> in memory go to a temporary file, like in concurency7
+    if (std::getenv("CONCURENCY_SORTED"))
     {
-        std::vector<path> dirsToDo = result.getDirs(16);
-
-        std::vector<std::future<void>> futures;
-
-        //limit the number of tasks to 16
-        while(!dirsToDo.empty())
-        {
-            //pass the result (shared data) to async function
-            auto ftr = std::async(std::launch::async, &listDir, std::move(dirsToDo.back()), std::ref(result));
-            dirsToDo.pop_back();
-            futures.push_back(std::move(ftr));
-        }
-
-        try
-        {
-            //here we are creating barrier
-            while(!futures.empty())
-            {
-                auto ftr = std::move(futures.back());
-                futures.pop_back();
-                ftr.wait(); //previously it was ftr.get() to retrieve data from async now we just have to sync
-            }
-        }
-        catch (std::system_error& e)
+        std::size_t budget = 0;
+        const char* text = std::getenv("CONCURENCY_SORT_BUDGET");
+        if (text && !parseMemoryBudget(text, budget))
         {
-            std::cout << "System error: " << e.code().message() << std::endl;
-        }
-
-        catch (std::exception& e)
-        {
-            std::cout << "Exception: " << e.what() << std::endl;
+            std::cerr << "CONCURENCY_SORT_BUDGET: bytes, 0 or at least " << MIN_MEMORY_BUDGET << std::endl;
+            return 1;
         }
+        SortedRuns sorted(budget);
+        CrawlHooks hooks;
+        hooks.sorted = &sorted;
+        listAllFilesShared(root, 16, CancellationToken(), defaultExecutor(), hooks);
+        // forEach - with a budget the runs don't all fit into memory, merge() would need them to
+        sorted.forEach([](const std::string& p) { std::cout << p << "\n"; });
+    }
 
-        catch (...)
+    // concurency6 <root> <file>... - crawl into a FileIndex once, then look the files up in it
+    if (argc > 2)
+    {
+        FileIndex index;
+        CrawlHooks hooks;
+        hooks.index = &index;
+        listAllFilesShared(root, 16, CancellationToken(), defaultExecutor(), hooks);
+        index.publish();
+        for (int i = 2; i < argc; ++i)
         {
-            std::cout <<"Unknown Exception" << std::endl;
+            std::uint64_t size;
+            if (index.find(argv[i], size))
+                std::cout << argv[i] << ": " << size << " bytes" << std::endl;
+            else
+                std::cout << argv[i] << ": not found" << std::endl;
         }
     }
 
-    //we are going out of scope of MonitorResult so we can get the data from it.
-    auto r = result.getResult();
-    std::for_each(r.files.begin(), r.files.end(), [](std::string & s)
-    {
-        std::cout << s << "\n";
-
-    });
-
-}
-
-int main(int argc, char *argv[])
-{
-    std::string root("/home/jpola/Projects/Concurency");
-
-    auto startTime = std::chrono::system_clock::now();
-
-    //for (int i = 0; i < 25; i++)
-        listAllFiles(root);
-
-    auto endTime = std::chrono::system_clock::now();
-
-    auto duration = (endTime - startTime)/25;
-    auto durationMs = std::chrono::duration_cast<std::chrono::microseconds>(duration);
-
-    std::cout << "\nSearch performed in " << durationMs.count() << std::endl;
-
 
 
 
@@ -6,7 +6,16 @@
 #include <algorithm>
 #include <deque>
 #include <condition_variable>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
 #include <experimental/filesystem>
+#include "content_search.h"
+#include "crawl_errors.h"
+#include "message_queue.h"
+#include "sorted_output.h"
+#include "trace.h"
+#include "walk_policy.h"
 
 using namespace std::experimental::filesystem;
 
@@ -51,76 +60,56 @@ using namespace std::experimental::filesystem;
 constexpr int NUM_THREADS = 10;
 
 
-template<typename T>
-class MessageQueue
-{
-    std::deque<T> _queue;
-    std::condition_variable _cond;
-    std::mutex _mutex;
-
-public:
-
-    //Notify the reciever
-    void send(T&& message)
-    {
-        //lock guard is releasing the lock in destr. So in this case in the end of this scope
-        {
-            std::lock_guard<std::mutex> lck(_mutex);
-            _queue.push_front(std::move(message));
-        }
-        _cond.notify_one();
-
-    }
-
-    T recieve()
-    {
-        std::unique_lock<std::mutex> lck(_mutex);
-
-        /// below corresponds to following piece of code;
-        /// since it is very common the condition_variable
-        /// is taking predicate as an argument
-        ///
-        /*
-         * while (!queue.empty())
-         * {
-         *   cond.wait(lock) //release lock to give a chance for producer to do the changes
-         *
-         * }
-         */
-
-        /// Predicate is provided as lambda
-        /// so server will wake up when queue is not empty
-        ///
-        /// _queue is part of the class so we have to capture pointer to this class
-        _cond.wait(lck, [this] { return !_queue.empty();});
-
-        T msg = std::move(_queue.back());
-        _queue.pop_back();
-        return msg;
-    }
-
-
-};
+// MessageQueue itself lives in include/message_queue.h
 
 
 // queues are shared among threads
-void listDirServer (MessageQueue<path> & dirQueue, MessageQueue<std::string>& fileQueue)
+// pending counts directories which were sent to dirQueue but are not listed yet.
+// When it drops to zero no server can produce more work - the job is done (HINT1 below).
+// A directory which can't be read goes to errors - a server which died on an exception
+// would never decrement pending and the crawl would never end (see include/crawl_errors.h).
+// With sorted the files don't go to the print server: every server collects their full paths in
+// a RunBuffer, a sorted run every CRAWL_RUN_SIZE files and once more at shutdown (include/sorted_output.h).
+// With walk all the servers share one WalkPolicy - symlinks to directories are followed and every
+// directory is sent to dirQueue once, so pending still reaches zero on a tree with link loops.
+
+void listDirServer (MessageQueue<path> & dirQueue, MessageQueue<std::string>& fileQueue,
+                    std::atomic<int>& pending, ErrorTable& errors, SortedRuns* sorted, WalkPolicy* walk)
 {
+    std::vector<CrawlError> dirErrors;
+    RunBuffer run(sorted);
+    Tracer::setThreadName("listDirServer");
     for (;;)
     {
         path dir = dirQueue.recieve();
-        for (directory_iterator it(dir); it != directory_iterator(); ++it)
+        if (dir.empty())
+        {
+            run.flush();
+            break; //HINT2: empty path means shutdown
+        }
+
+        TRACE_SCOPE("task", "listDirServer dir");
+        forEachEntry(dir, dirErrors, CancellationToken(), walk,
+                     [&](path&& p)
+                     {
+                         ++pending;
+                         dirQueue.send(std::move(p));
+                     },
+                     [&](const path& p, const struct stat&)
+                     {
+                         if (sorted)
+                             run.push(p.string());
+                         else
+                             fileQueue.send(p.filename());
+                     });
+        errors.add(dirErrors);
+
+        // subdirectories were counted before so zero means that this was the last one
+        if (--pending == 0)
         {
-            if (is_directory(it->path()))
-            {
-                path p = std::move(it->path());
-                dirQueue.send(std::move(p));
-            }
-            else
-            {
-                fileQueue.send(it->path().filename());
-
-            }
+            for (int i = 0; i < NUM_THREADS; ++i)
+                dirQueue.send(path());
+            fileQueue.send(std::string());
         }
     }
 }
@@ -128,17 +117,24 @@ void listDirServer (MessageQueue<path> & dirQueue, MessageQueue<std::string>& fi
 
 void printServer (MessageQueue<std::string>& nameQueue)
 {
+    Tracer::setThreadName("printServer");
     for(;;)
     {
         std::string name = nameQueue.recieve();
+        if (name.empty())
+            break;
+
+        TRACE_SCOPE("task", "printServer print");
         std::cout << name << std::endl;
     }
 }
 
-void listTree (path&& rootDir)
+void listTree (path&& rootDir, SortedRuns* sorted = nullptr, WalkPolicy* walk = nullptr)
 {
     MessageQueue<path> dirQueue;
     MessageQueue<std::string> fileQueue;
+    std::atomic<int> pending(1);
+    ErrorTable errors;
     dirQueue.send(std::move(rootDir));
 
     std::vector<std::future<void>> futures;
@@ -148,7 +144,11 @@ void listTree (path&& rootDir)
         futures.push_back(
                     std::async(std::launch::async, &listDirServer,
                                std::ref(dirQueue),
-                               std::ref(fileQueue)));
+                               std::ref(fileQueue),
+                               std::ref(pending),
+                               std::ref(errors),
+                               sorted,
+                               walk));
     }
 
     //Spawn one print server
@@ -164,17 +164,70 @@ void listTree (path&& rootDir)
     } catch (std::exception& e) {
 
     }
+    errors.print(std::cerr);
+
+    if (sorted)
+        sorted->forEach([](const std::string& p) { std::cout << p << "\n"; });
 }
 
 
 
 int main(int argc, char *argv[])
 {
-    std::string root("/home/jpola/Projects/Concurency");
-    listTree(path(root));
+    // run with CONCURENCY_TRACE=trace.json to get the timeline of the servers
+    TraceSession trace;
+
+    std::string root(argc > 1 ? argv[1] : "/home/jpola/Projects/Concurency");
+
+    // concurency7 <root> <pattern> [--regex] - the same servers, but the consumers grep the files
+    // (include/content_search.h). Output is path:line:text, sorted by path.
+    if (argc > 2)
+    {
+        SearchOptions opt;
+        opt.pattern = argv[2];
+        opt.regex = argc > 3 && std::string(argv[3]) == "--regex";
+        SearchReport report = searchTree(root, opt);
+        for (const FileMatches& f : report.files)
+            for (const LineMatch& m : f.lines)
+                std::cout << f.path << ":" << m.line << ":" << m.text << "\n";
+        std::cerr << report.matches() << " matching lines in " << report.files.size() << " of "
+                  << report.filesScanned << " files, " << report.binarySkipped << " binary skipped, "
+                  << report.errors << " unreadable" << std::endl;
+        return 0;
+    }
+
+    // CONCURENCY_FOLLOW=1 - follow the symlinks to directories, every directory listed once
+    std::unique_ptr<WalkPolicy> walk;
+    if (std::getenv("CONCURENCY_FOLLOW"))
+    {
+        WalkOptions opt;
+        opt.followSymlinks = true;
+        walk.reset(new WalkPolicy(root, opt));
+    }
+
+    // CONCURENCY_SORTED=1 - full paths in sorted order; CONCURENCY_SORT_BUDGET=<bytes> - runs over
+    // <bytes> in memory go to a temporary file (0, the default - no limit)
+    if (std::getenv("CONCURENCY_SORTED"))
+    {
+        std::size_t budget = 0;
+        const char* text = std::getenv("CONCURENCY_SORT_BUDGET");
+        if (text && !parseMemoryBudget(text, budget))
+        {
+            std::cerr << "CONCURENCY_SORT_BUDGET: bytes, 0 or at least " << MIN_MEMORY_BUDGET << std::endl;
+            return 1;
+        }
+        SortedRuns sorted(budget);
+        listTree(path(root), &sorted, walk.get());
+    }
+    else
+        listTree(path(root), nullptr, walk.get());
+
+    if (walk)
+        std::cerr << walk->visited() << " directories, " << walk->seenAgain()
+                  << " reached again through a link" << std::endl;
 
 
-    //TODO: How to shutdown the servers;
+    //How to shutdown the servers;
     //How to decide that the job is done
     //HINT1: Dir Message queue is empty, however other servers can still produce the subdirectories to be listed so none of
     // the servers are active - implement counter for active servers in any point in time.
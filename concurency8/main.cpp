@@ -1,46 +1,11 @@
 #include <iostream>
 #include <thread>
+#include "scoped_thread.h"
 
 // Let's build a thread wrapper class to have scoped execution
 
 
-class scoped_thread
-{
-    std::thread _t;
-
-public:
-
-    scoped_thread() = delete ;
-    scoped_thread(const scoped_thread  &) = delete;
-    scoped_thread& operator=(scoped_thread const&) = delete;
-
-    scoped_thread(std::thread t) : _t(std::move(t))
-    {
-    }
-
-    template<typename _Callable, typename... _Args>
-      explicit
-      scoped_thread(_Callable&& __f, _Args&&... __args): _t(__f, __args...)
-      {}
-
-
-    void detach()
-    {
-        _t.detach();
-    }
-
-    bool joinable()
-    {
-        return _t.joinable();
-    }
-
-    ~scoped_thread()
-    {
-
-        if (_t.joinable())
-            _t.join();
-    }
-};
+// scoped_thread lives in include/scoped_thread.h
 
 
 void sc_thr_func()
@@ -0,0 +1,181 @@
+#include "bench.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <ctime>
+#include <thread>
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+
+    double rank = p / 100.0 * (sorted.size() - 1);
+    std::size_t lo = static_cast<std::size_t>(std::floor(rank));
+    std::size_t hi = static_cast<std::size_t>(std::ceil(rank));
+    double frac = rank - lo;
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * frac;
+}
+
+std::vector<double> timedReps(const std::vector<double>& perRep, int reps)
+{
+    std::size_t n = reps > 0 ? std::min(perRep.size(), static_cast<std::size_t>(reps)) : perRep.size();
+    return std::vector<double>(perRep.end() - n, perRep.end());
+}
+
+double medianOfReps(const std::vector<double>& perRep, int reps)
+{
+    std::vector<double> sorted = timedReps(perRep, reps);
+    std::sort(sorted.begin(), sorted.end());
+    return percentile(sorted, 50);
+}
+
+BenchResult* BenchRunner::run(const std::string& name, std::size_t items,
+                              const std::function<void()>& setup, const std::function<void()>& body)
+{
+    if (!enabled(name))
+        return nullptr;
+
+    std::cout << "running " << name << std::flush;
+
+    for (int i = 0; i < _cfg.warmup; ++i)
+    {
+        setup();
+        body();
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.items = items;
+
+    std::map<std::string, double> counters;
+    for (int i = 0; i < _cfg.reps; ++i)
+    {
+        setup();
+        _perf.start();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+        result.samplesUs.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+
+        for (auto& c : _perf.stop())
+            counters[c.first] += c.second;
+    }
+
+    for (auto& c : counters)
+        result.metrics[c.first] = _cfg.reps > 0 ? c.second / _cfg.reps : 0.0;
+
+    std::vector<double> sorted(result.samplesUs);
+    std::sort(sorted.begin(), sorted.end());
+
+    result.min = sorted.empty() ? 0.0 : sorted.front();
+    result.max = sorted.empty() ? 0.0 : sorted.back();
+    result.p50 = percentile(sorted, 50);
+    result.p90 = percentile(sorted, 90);
+    result.p99 = percentile(sorted, 99);
+    result.mean = sorted.empty() ? 0.0
+                                 : std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+    double sq = 0.0;
+    for (double s : sorted)
+        sq += (s - result.mean) * (s - result.mean);
+    result.stddev = sorted.size() > 1 ? std::sqrt(sq / (sorted.size() - 1)) : 0.0;
+
+    std::cout << " p50 " << result.p50 << " us" << std::endl;
+
+    _results.push_back(std::move(result));
+    return &_results.back();
+}
+
+void BenchRunner::printTable(std::ostream& os) const
+{
+    os << std::left << std::setw(48) << "benchmark"
+       << std::right << std::setw(12) << "p50 [us]"
+       << std::setw(12) << "p90 [us]"
+       << std::setw(12) << "p99 [us]"
+       << std::setw(12) << "stddev"
+       << std::setw(16) << "items/s" << "\n";
+
+    for (const BenchResult& r : _results)
+    {
+        os << std::left << std::setw(48) << r.name
+           << std::right << std::fixed << std::setprecision(1)
+           << std::setw(12) << r.p50
+           << std::setw(12) << r.p90
+           << std::setw(12) << r.p99
+           << std::setw(12) << r.stddev
+           << std::setw(16) << std::setprecision(0) << r.itemsPerSec() << "\n";
+
+        for (auto& m : r.metrics)
+            os << "    " << m.first << " = " << std::setprecision(3) << m.second << "\n";
+    }
+    os.unsetf(std::ios::fixed);
+}
+
+static std::string jsonEscape(const std::string& s)
+{
+    std::string out;
+    for (char c : s)
+    {
+        switch (c)
+        {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default:   out += c;
+        }
+    }
+    return out;
+}
+
+void BenchRunner::writeJson(std::ostream& os) const
+{
+    os << std::setprecision(6);
+    os << "{\n";
+    os << "  \"suite\": \"concurency_bench\",\n";
+    os << "  \"timestamp\": " << std::time(nullptr) << ",\n";
+    os << "  \"machine\": {\"hardware_concurrency\": " << std::thread::hardware_concurrency()
+       << ", \"compiler\": \"" << jsonEscape(__VERSION__) << "\"},\n";
+    os << "  \"config\": {\"warmup\": " << _cfg.warmup
+       << ", \"reps\": " << _cfg.reps
+       << ", \"tree\": {\"depth\": " << _cfg.tree.depth
+       << ", \"fanout\": " << _cfg.tree.fanout
+       << ", \"files_per_dir\": " << _cfg.tree.filesPerDir
+       << ", \"file_bytes\": " << _cfg.tree.fileBytes
+       << ", \"seed\": " << _cfg.tree.seed << "}"
+       << ", \"factorial_max\": " << _cfg.factorialMax << "},\n";
+    os << "  \"results\": [";
+
+    for (std::size_t i = 0; i < _results.size(); ++i)
+    {
+        const BenchResult& r = _results[i];
+        os << (i ? ",\n" : "\n");
+        os << "    {\"name\": \"" << jsonEscape(r.name) << "\""
+           << ", \"items\": " << r.items
+           << ", \"reps\": " << r.samplesUs.size()
+           << ", \"unit\": \"us\""
+           << ", \"min\": " << r.min
+           << ", \"p50\": " << r.p50
+           << ", \"p90\": " << r.p90
+           << ", \"p99\": " << r.p99
+           << ", \"max\": " << r.max
+           << ", \"mean\": " << r.mean
+           << ", \"stddev\": " << r.stddev
+           << ", \"items_per_sec\": " << r.itemsPerSec()
+           << ", \"metrics\": {";
+        bool first = true;
+        for (auto& m : r.metrics)
+        {
+            os << (first ? "" : ", ") << "\"" << jsonEscape(m.first) << "\": " << m.second;
+            first = false;
+        }
+        os << "}, \"samples\": [";
+        for (std::size_t s = 0; s < r.samplesUs.size(); ++s)
+            os << (s ? ", " : "") << r.samplesUs[s];
+        os << "]}";
+    }
+    os << "\n  ]\n}\n";
+}
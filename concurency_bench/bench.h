@@ -0,0 +1,129 @@
+#ifndef CONCURENCY_BENCH_H
+#define CONCURENCY_BENCH_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <ostream>
+#include "perf_counters.h"
+
+/*
+ * Small benchmark harness used by concurency_bench.
+ *
+ * Every benchmark is a body which is executed warmup + reps times.
+ * Only the reps are timed. From the samples we compute percentiles
+ * so one slow run (page cache miss, scheduler hiccup) is visible
+ * instead of being hidden in an average like in concurency5.
+ * Where the kernel allows it, perf counters (cache misses, context switches)
+ * are collected for the timed reps and reported per rep in the metrics.
+ */
+
+struct TreeShape
+{
+    int depth;          // number of directory levels below the root
+    int fanout;         // subdirectories per directory
+    int filesPerDir;    // plain files per directory
+    int fileBytes;      // average file size, real size is in [0, 2 * fileBytes]
+    unsigned seed;      // the same seed gives the same tree
+
+    TreeShape() : depth(4), fanout(4), filesPerDir(8), fileBytes(64), seed(42) {}
+};
+
+struct BenchConfig
+{
+    int warmup;
+    int reps;
+    std::string filter;     // run only benchmarks which names contain this string
+    std::string jsonPath;   // machine readable output, empty = don't write
+    TreeShape tree;
+    unsigned factorialMax;  // the biggest n for the n! benchmarks
+
+    BenchConfig() : warmup(2), reps(10), jsonPath("bench_output.json"), factorialMax(100000) {}
+};
+
+struct BenchResult
+{
+    std::string name;
+    std::size_t items;              // work items done by a single rep
+    std::vector<double> samplesUs;  // one sample per timed rep
+
+    double min, p50, p90, p99, max, mean, stddev;
+
+    //additional numbers reported by the benchmark itself (e.g. bytes, peak memory)
+    std::map<std::string, double> metrics;
+
+    double itemsPerSec() const
+    {
+        return p50 > 0 ? items / (p50 * 1e-6) : 0.0;
+    }
+};
+
+class BenchRunner
+{
+    BenchConfig _cfg;
+    std::deque<BenchResult> _results;  // deque - returned pointers stay valid
+    PerfCounters _perf;
+
+public:
+    explicit BenchRunner(const BenchConfig& cfg) : _cfg(cfg) {}
+
+    const BenchConfig& config() const { return _cfg; }
+
+    bool enabled(const std::string& name) const
+    {
+        return _cfg.filter.empty() || name.find(_cfg.filter) != std::string::npos;
+    }
+
+    /// Suites use it to skip expensive preparation (e.g. generating a tree) when filtered out.
+    /// names are the full names of the benchmarks which need it - the filter may match any part
+    /// of a name, so a prefix of them isn't enough.
+    bool anyEnabled(std::initializer_list<const char*> names) const
+    {
+        for (const char* name : names)
+            if (enabled(name))
+                return true;
+        return false;
+    }
+
+    /// The same for names built at run time.
+    bool anyEnabled(const std::vector<std::string>& names) const
+    {
+        for (const std::string& name : names)
+            if (enabled(name))
+                return true;
+        return false;
+    }
+
+    /// Runs body warmup + reps times and records the timed reps.
+    /// Returns nullptr when the benchmark is filtered out, otherwise
+    /// the result so the caller can attach its own metrics.
+    BenchResult* run(const std::string& name, std::size_t items, const std::function<void()>& body)
+    {
+        return run(name, items, []{}, body);
+    }
+
+    /// Same as above but setup is called before every rep outside of the timed region.
+    BenchResult* run(const std::string& name, std::size_t items,
+                     const std::function<void()>& setup, const std::function<void()>& body);
+
+    const std::deque<BenchResult>& results() const { return _results; }
+
+    void printTable(std::ostream& os) const;
+    void writeJson(std::ostream& os) const;
+};
+
+/// Percentile of already sorted samples with linear interpolation between ranks.
+double percentile(const std::vector<double>& sorted, double p);
+
+/// A body which records a value every time it runs has the warmup values in front -
+/// these are the last reps of them, the timed reps.
+std::vector<double> timedReps(const std::vector<double>& perRep, int reps);
+
+/// Median of the timed reps, the same statistic as p50.
+double medianOfReps(const std::vector<double>& perRep, int reps);
+
+#endif // CONCURENCY_BENCH_H
@@ -0,0 +1,149 @@
+#include "suites.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "synthetic_tree.h"
+#include "batched_crawl.h"
+#include "cancellation.h"
+#include "list_directory.h"
+#include "message_queue.h"
+#include "monitor_crawl.h"
+
+/*
+ * Cancel to quiescence: a crawl is running, we cancel it - how long until no task runs anymore?
+ * The crawl starts in setup (untimed) and gets a head start of a quarter of a full crawl,
+ * the timed body is cancel() + waiting for the crawl to return.
+ * The bodies record their metrics on every call - only the timed reps are reported (timedReps).
+ */
+
+typedef std::chrono::steady_clock Clock;
+
+template<typename Crawl>
+static void cancelCrawl(BenchRunner& runner, const std::string& name, std::size_t entries, Crawl crawl)
+{
+    if (!runner.enabled(name))
+        return;
+
+    // how long the whole crawl takes
+    auto start = Clock::now();
+    crawl(CancellationToken());
+    auto headStart = (Clock::now() - start) / 4;
+
+    std::unique_ptr<CancellationSource> source;
+    std::future<void> ftr;
+    std::vector<double> finishedEarly;     // 1 per rep whose crawl was done before the cancel
+
+    BenchResult* r = runner.run(name, entries, [&]
+    {
+        source.reset(new CancellationSource);
+        CancellationToken token = source->token();
+        ftr = std::async(std::launch::async, [crawl, token] { crawl(token); });
+        std::this_thread::sleep_for(headStart);
+    },
+    [&]
+    {
+        source->cancel();
+        try
+        {
+            ftr.get();
+            finishedEarly.push_back(1);
+        }
+        catch (OperationCancelled&)
+        {
+            finishedEarly.push_back(0);
+        }
+    });
+    if (r)
+    {
+        r->metrics["head_start_us"] = std::chrono::duration<double, std::micro>(headStart).count();
+        std::vector<double> timed = timedReps(finishedEarly, runner.config().reps);
+        r->metrics["finished_before_cancel"] = std::accumulate(timed.begin(), timed.end(), 0.0);
+    }
+}
+
+void benchCancel(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "cancel.crawl.async_fanout", "cancel.crawl.batched", "cancel.crawl.monitor",
+                             "cancel.crawl.deadline", "cancel.queue.recieve" }))
+        return;
+
+    // one level deeper than the other suites - a crawl long enough to be cancelled
+    TreeShape shape = runner.config().tree;
+    shape.depth += 1;
+    SyntheticTree tree(shape);
+    std::string root = tree.root().string();
+    std::size_t entries = tree.files();
+
+    cancelCrawl(runner, "cancel.crawl.async_fanout", entries, [root](const CancellationToken& token)
+    {
+        listDirectory(std::string(root), token);
+    });
+    cancelCrawl(runner, "cancel.crawl.batched", entries, [root](const CancellationToken& token)
+    {
+        std::string dir(root);
+        listAllFiles(dir, 8, token);
+    });
+    cancelCrawl(runner, "cancel.crawl.monitor", entries, [root](const CancellationToken& token)
+    {
+        std::string dir(root);
+        listAllFilesShared(dir, 16, token);
+    });
+
+    // deadline instead of cancel(): how late after the deadline does the crawl return
+    if (runner.enabled("cancel.crawl.deadline"))
+    {
+        std::string dir(root);
+        auto start = Clock::now();
+        listAllFilesShared(dir);
+        auto timeout = (Clock::now() - start) / 4;
+
+        std::vector<double> lateUs;
+        BenchResult* r = runner.run("cancel.crawl.deadline", entries, [&]
+        {
+            CancellationToken token = CancellationToken().withTimeout(timeout);
+            try
+            {
+                listAllFilesShared(dir, 16, token);
+            }
+            catch (OperationCancelled&)
+            {
+            }
+            lateUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - token.deadline()).count());
+        });
+        if (r)
+            r->metrics["late_after_deadline_us"] = medianOfReps(lateUs, runner.config().reps);
+    }
+
+    // a server blocked in recieve: cancel() until its thread is joined
+    std::unique_ptr<CancellationSource> source;
+    std::unique_ptr<std::thread> server;
+    MessageQueue<int> queue;
+    runner.run("cancel.queue.recieve", 1, [&]
+    {
+        source.reset(new CancellationSource);
+        CancellationToken token = source->token();
+        server.reset(new std::thread([&queue, token]
+        {
+            try
+            {
+                queue.recieve(token);
+                throw std::runtime_error("cancel.queue.recieve: got a message");
+            }
+            catch (OperationCancelled&)
+            {
+            }
+        }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    },
+    [&]
+    {
+        source->cancel();
+        server->join();
+    });
+}
@@ -0,0 +1,67 @@
+#include "suites.h"
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+#include "chunked_collector.h"
+
+constexpr int NUM_APPENDS = 256000; // per rep, split between the threads
+
+/// How MonitorResult::putFile looked before the collector: every append takes
+/// the monitor mutex and copies the name even though it was passed as rvalue.
+class MutexVector
+{
+    std::vector<std::string> _files;
+    std::mutex _mutex;
+public:
+    void putFile(std::string&& file)
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        _files.push_back(file);
+    }
+
+    std::size_t size() const { return _files.size(); }
+};
+
+template<typename Collector, typename Append>
+static void appendFromThreads(Collector& collector, int threads, Append append)
+{
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.push_back(std::thread([&collector, &append, threads, t]
+        {
+            for (int i = t; i < NUM_APPENDS; i += threads)
+                append(collector, "file_" + std::to_string(i) + ".dat");
+        }));
+    }
+    for (std::thread& th : workers)
+        th.join();
+}
+
+void benchCollector(BenchRunner& runner)
+{
+    for (int threads = 1; threads <= 64; threads *= 2)
+    {
+        std::string suffix = ".t" + std::to_string(threads);
+
+        runner.run("collector.mutex_vector" + suffix, NUM_APPENDS, [threads]
+        {
+            MutexVector files;
+            appendFromThreads(files, threads, [](MutexVector& c, std::string&& s) { c.putFile(std::move(s)); });
+            if (files.size() != NUM_APPENDS)
+                throw std::runtime_error("collector.mutex_vector: lost appends");
+        });
+
+        runner.run("collector.chunked" + suffix, NUM_APPENDS, [threads]
+        {
+            ChunkedCollector<std::string> files;
+            appendFromThreads(files, threads,
+                              [](ChunkedCollector<std::string>& c, std::string&& s) { c.append(std::move(s)); });
+            if (files.size() != NUM_APPENDS)
+                throw std::runtime_error("collector.chunked: lost appends");
+        });
+    }
+}
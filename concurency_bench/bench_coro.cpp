@@ -0,0 +1,146 @@
+#include "suites.h"
+
+#if __cplusplus >= 202002L
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "batched_crawl.h"
+#include "coro_crawl.h"
+#include "list_directory.h"
+#include "process_stats.h"
+#include "synthetic_tree.h"
+
+/*
+ * Coroutine crawl (include/coro_crawl.h) against the std::async crawls of concurency4 and 5.
+ *
+ * A wide tree - 4369 directories - so thousands of directory scans wait for their children
+ * at the same time. Besides the time every benchmark reports
+ *  - peak_rss_kb   - VmHWM during the last rep above the RSS before it (clear_refs resets the peak),
+ *                    0 when it's within the noise
+ *  - peak_threads  - most threads alive at once above the ones before, sampled from /proc/self/status
+ *                    (the sampler's own thread not counted)
+ * This file is compiled with -std=c++20, the rest of the bench with C++11.
+ */
+
+/// Samples the number of threads of the process while it lives.
+class ThreadSampler
+{
+    std::atomic<bool> _stop;
+    std::atomic<long> _peak;
+    std::thread _thread;
+
+public:
+    ThreadSampler() : _stop(false), _peak(0)
+    {
+        _thread = std::thread([this]
+        {
+            while (!_stop)
+            {
+                long n = processStatus("Threads");
+                if (n > _peak)
+                    _peak = n;
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+        });
+    }
+
+    ~ThreadSampler()
+    {
+        _stop = true;
+        _thread.join();
+    }
+
+    long peak() const { return _peak; }
+};
+
+template<typename F>
+static void benchCoroCrawl(BenchRunner& runner, const std::string& name, std::size_t items, F body)
+{
+    if (!runner.enabled(name))
+        return;
+
+    long baseline = 0;
+    long threadsBefore;
+    BenchResult* r;
+    long peakThreads;
+    {
+        ThreadSampler sampler;
+        // counted with the sampler running, so its thread is in both and drops out of the difference
+        threadsBefore = processStatus("Threads");
+        r = runner.run(name, items, [&]
+        {
+            resetPeakRss();
+            baseline = processStatus("VmRSS");
+        }, body);
+        peakThreads = sampler.peak();
+    }
+    if (r)
+    {
+        // VmHWM right after the reset can be a page or two below the VmRSS read then - below the
+        // noise floor the crawl added nothing
+        r->metrics["peak_rss_kb"] = static_cast<double>(std::max(0L, processStatus("VmHWM") - baseline));
+        r->metrics["peak_threads"] = static_cast<double>(peakThreads - threadsBefore);
+    }
+}
+
+void benchCoro(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "coro.crawl.async_fanout", "coro.crawl.batched", "coro.crawl.coroutine",
+                             "coro.crawl.generator" }))
+        return;
+
+    TreeShape shape;
+    shape.depth = 3;
+    shape.fanout = 16;
+    shape.filesPerDir = 2;
+    shape.fileBytes = 16;
+    shape.seed = runner.config().tree.seed;
+    SyntheticTree tree(shape);
+    std::string root = tree.root().string();
+    std::size_t entries = tree.dirs() + tree.files();   // a header line per directory + the files
+
+    benchCoroCrawl(runner, "coro.crawl.async_fanout", entries, [&]
+    {
+        if (listDirectory(std::string(root)).size() != entries)
+            throw std::runtime_error("coro.crawl.async_fanout: wrong number of entries");
+    });
+
+    benchCoroCrawl(runner, "coro.crawl.batched", tree.files(), [&]
+    {
+        std::string dir = root;
+        if (listAllFiles(dir).size() != tree.files())
+            throw std::runtime_error("coro.crawl.batched: wrong number of files");
+    });
+
+    CoroPool pool;
+    benchCoroCrawl(runner, "coro.crawl.coroutine", entries, [&]
+    {
+        if (syncWait(pool, listDirectoryCoro(pool, root)).size() != entries)
+            throw std::runtime_error("coro.crawl.coroutine: wrong number of entries");
+    });
+
+    benchCoroCrawl(runner, "coro.crawl.generator", entries - 1, [&]
+    {
+        std::size_t n = 0;
+        for (const fs::path& p : walkTree(root))
+        {
+            (void)p;
+            ++n;
+        }
+        if (n != entries - 1)
+            throw std::runtime_error("coro.crawl.generator: wrong number of entries");
+    });
+}
+
+#else
+
+// built without C++20 - no coroutines to measure
+void benchCoro(BenchRunner&)
+{
+}
+
+#endif
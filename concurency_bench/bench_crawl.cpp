@@ -0,0 +1,50 @@
+#include "suites.h"
+
+#include <string>
+#include <stdexcept>
+#include "synthetic_tree.h"
+#include "list_directory.h"
+#include "batched_crawl.h"
+#include "monitor_crawl.h"
+
+void benchCrawl(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "crawl.async_fanout", "crawl.batched", "crawl.monitor" }))
+        return;
+
+    SyntheticTree tree(runner.config().tree);
+    std::string root = tree.root().string();
+    std::size_t entries = tree.files();
+
+    // concurency4: one async task per directory
+    BenchResult* r = runner.run("crawl.async_fanout", entries, [&root, &tree]
+    {
+        std::string dir(root);
+        string_vector listing = listDirectory(std::move(dir));
+        // every directory adds its "> dir:" header line
+        if (listing.size() != tree.files() + tree.dirs())
+            throw std::runtime_error("crawl.async_fanout: wrong number of entries");
+    });
+    if (r)
+        r->metrics["dirs"] = tree.dirs();
+
+    // concurency5: batches of 8 tasks with a barrier after each batch
+    r = runner.run("crawl.batched", entries, [&root, &tree]
+    {
+        std::vector<std::string> files = listAllFiles(root);
+        if (files.size() != tree.files())
+            throw std::runtime_error("crawl.batched: wrong number of files");
+    });
+    if (r)
+        r->metrics["dirs"] = tree.dirs();
+
+    // concurency6: batches of 16 tasks sharing one MonitorResult
+    r = runner.run("crawl.monitor", entries, [&root, &tree]
+    {
+        Result result = listAllFilesShared(root);
+        if (result.files.size() != tree.files())
+            throw std::runtime_error("crawl.monitor: wrong number of files");
+    });
+    if (r)
+        r->metrics["dirs"] = tree.dirs();
+}
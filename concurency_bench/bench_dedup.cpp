@@ -0,0 +1,152 @@
+#include "suites.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "duplicate_finder.h"
+#include "filesystem.h"
+#include "hash64.h"
+#include "synthetic_tree.h"
+
+/*
+ * The duplicate finder pipeline on a generated tree with a known number of duplicates.
+ *
+ * DUP_FILES files in DUP_DIRS directories, sizes 1 KB .. 128 KB. A file is
+ *  - a copy of an earlier file (1 in 4)                      - a duplicate
+ *  - an earlier file with a different last 8 bytes (1 in 10) - passes size and prefix, not the full hash
+ *  - random otherwise
+ */
+
+constexpr int DUP_FILES = 1024;
+constexpr int DUP_DIRS = 32;
+
+class DuplicateTree
+{
+    SyntheticTree _tree;        // the temp dir, our files go into it
+    std::size_t _duplicateFiles;
+    std::uint64_t _bytes;
+
+public:
+    explicit DuplicateTree(unsigned seed) : _tree(rootOnly(seed)), _duplicateFiles(0), _bytes(0)
+    {
+        unsigned state = seed ? seed : 1;
+        const std::size_t sizes[] = { 1024, 8192, 32768, 131072 };
+        std::vector<std::vector<char>> contents;
+
+        for (int i = 0; i < DUP_FILES; ++i)
+        {
+            std::vector<char> data;
+            unsigned kind = nextRandom(state) % 20;
+            if (!contents.empty() && kind < 5)
+            {
+                std::size_t src = nextRandom(state) % contents.size();
+                data = contents[src];
+            }
+            else if (!contents.empty() && kind < 7 && contents.back().size() > 4096 + 8)
+            {
+                data = contents.back();
+                std::uint64_t tag = 0x8000000000000000ull | static_cast<std::uint64_t>(i);
+                std::memcpy(&data[data.size() - 8], &tag, 8);
+            }
+            else
+            {
+                data.resize(sizes[nextRandom(state) % 4]);
+                for (char& c : data)
+                    c = static_cast<char>(nextRandom(state));
+            }
+
+            fs::path dir = _tree.root() / ("d" + std::to_string(i % DUP_DIRS));
+            fs::create_directories(dir);
+            std::ofstream out((dir / ("f" + std::to_string(i) + ".bin")).string(), std::ios::binary);
+            out.write(data.data(), static_cast<std::streamsize>(data.size()));
+            _bytes += data.size();
+
+            contents.push_back(std::move(data));
+        }
+
+        // every file whose content appears more than once (an original and its copies)
+        std::map<std::vector<char>, int> byContent;
+        for (const auto& data : contents)
+            ++byContent[data];
+        for (const auto& kv : byContent)
+            if (kv.second > 1)
+                _duplicateFiles += kv.second;
+    }
+
+    std::string root() const { return _tree.root().string(); }
+    std::size_t duplicateFiles() const { return _duplicateFiles; }
+    std::uint64_t bytes() const { return _bytes; }
+};
+
+/// Without the pipeline: one thread, every file read and hashed completely.
+static std::size_t naiveDuplicates(const std::string& root, std::uint64_t& bytes)
+{
+    std::map<std::pair<std::uint64_t, std::uint64_t>, int> groups;
+    for (fs::recursive_directory_iterator it(root), end; it != end; ++it)
+    {
+        if (!fs::is_regular_file(it->path()))
+            continue;
+        std::ifstream in(it->path().string(), std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        bytes += data.size();
+        ++groups[std::make_pair(static_cast<std::uint64_t>(data.size()), hash64(data.data(), data.size()))];
+    }
+    std::size_t n = 0;
+    for (const auto& kv : groups)
+        if (kv.second > 1)
+            n += kv.second;
+    return n;
+}
+
+void benchDedup(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "dedup.naive_serial", "dedup.pipeline", "dedup.hash64.16mb" }))
+        return;
+
+    DuplicateTree tree(runner.config().tree.seed);
+    std::string root = tree.root();
+
+    std::uint64_t bytes = 0;
+    BenchResult* r = runner.run("dedup.naive_serial", DUP_FILES, [&]
+    {
+        bytes = 0;
+        if (naiveDuplicates(root, bytes) != tree.duplicateFiles())
+            throw std::runtime_error("dedup.naive_serial: wrong number of duplicates");
+    });
+    if (r)
+    {
+        r->metrics["bytes_hashed"] = static_cast<double>(bytes);
+        r->metrics["gb_per_s"] = bytes / (r->p50 * 1e-6) / 1e9;
+    }
+
+    DuplicateReport report;
+    r = runner.run("dedup.pipeline", DUP_FILES, [&]
+    {
+        report = findDuplicates(root);
+        if (report.duplicateFiles() != tree.duplicateFiles() || report.files != DUP_FILES)
+            throw std::runtime_error("dedup.pipeline: wrong number of duplicates");
+    });
+    if (r)
+    {
+        r->metrics["bytes_hashed"] = static_cast<double>(report.bytesHashed);
+        r->metrics["gb_per_s"] = report.bytesHashed / (r->p50 * 1e-6) / 1e9;
+        r->metrics["tree_bytes"] = static_cast<double>(tree.bytes());
+        r->metrics["size_candidates"] = static_cast<double>(report.sizeCandidates);
+        r->metrics["prefix_candidates"] = static_cast<double>(report.prefixCandidates);
+        r->metrics["duplicates"] = static_cast<double>(report.duplicateFiles());
+    }
+
+    // the hash alone, in memory
+    std::vector<char> block(1 << 24, 'x');
+    volatile std::uint64_t sink = 0;
+    r = runner.run("dedup.hash64.16mb", block.size(), [&]
+    {
+        sink = hash64(block.data(), block.size());
+    });
+    if (r)
+        r->metrics["gb_per_s"] = block.size() / (r->p50 * 1e-6) / 1e9;
+}
@@ -0,0 +1,143 @@
+#include "suites.h"
+
+#include <functional>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <sys/stat.h>
+#include "batched_crawl.h"
+#include "crawl_errors.h"
+#include "executor.h"
+#include "monitor_crawl.h"
+#include "synthetic_tree.h"
+#include "walk_policy.h"
+
+/*
+ * Crawls of a tree full of errors (include/crawl_errors.h) against the same tree without them.
+ *
+ * The broken tree gets in every directory a symlink loop (two ELOOP entries) and a dangling
+ * symlink (listed as a file), and every fourth directory is made unreadable (EACCES - unless
+ * we run as root, then eacces stays 0 and only the loops are errors). Both trees are crawled
+ * following the symlinks (include/walk_policy.h) - a physical walk lists the loops as files.
+ *
+ *  errors.<crawl>.clean / .broken - items = files listed + errors recorded
+ *      rate_vs_clean = items/s of the broken tree / items/s of the clean one, should be ~1:
+ *      an error costs about what an entry costs, nothing is unwound
+ */
+
+class BrokenTree
+{
+    SyntheticTree _tree;
+    std::vector<std::string> _locked;
+
+public:
+    explicit BrokenTree(const TreeShape& shape) : _tree(shape)
+    {
+        std::vector<fs::path> dirs;
+        dirs.push_back(_tree.root());
+        for (fs::recursive_directory_iterator it(_tree.root()), end; it != end; ++it)
+            if (fs::is_directory(it->symlink_status()))
+                dirs.push_back(it->path());
+
+        for (const fs::path& d : dirs)
+        {
+            fs::create_symlink("loop_b", d / "loop_a");
+            fs::create_symlink("loop_a", d / "loop_b");
+            fs::create_symlink("nowhere", d / "dangling");
+        }
+        // locked only now - a parent comes before its children in dirs
+        for (std::size_t i = 3; i < dirs.size(); i += 4)
+        {
+            ::chmod(dirs[i].c_str(), 0);
+            _locked.push_back(dirs[i].string());
+        }
+    }
+
+    ~BrokenTree()
+    {
+        // SyntheticTree has to be able to remove it
+        for (const std::string& d : _locked)
+            ::chmod(d.c_str(), 0755);
+    }
+
+    const fs::path& root() const { return _tree.root(); }
+};
+
+static WalkOptions follow()
+{
+    WalkOptions opt;
+    opt.followSymlinks = true;
+    return opt;
+}
+
+template<typename Crawl>
+static BenchResult* benchErrorCrawl(BenchRunner& runner, const std::string& name, std::size_t& items,
+                                    std::size_t& eacces, Crawl crawl)
+{
+    return runner.run(name, 0, [&]
+    {
+        ErrorTable errors;
+        std::size_t files = crawl(errors);
+        items = files + errors.total();
+        eacces = errors.count(std::errc::permission_denied);
+    });
+}
+
+void benchErrors(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "errors.batched.clean", "errors.batched.broken",
+                             "errors.monitor.clean", "errors.monitor.broken" }))
+        return;
+
+    TreeShape shape = runner.config().tree;
+    shape.fileBytes = 0;
+    SyntheticTree clean(shape);
+    BrokenTree broken(shape);
+    FixedThreadPool pool(4);
+
+    struct Case
+    {
+        const char* name;
+        std::function<std::size_t(const fs::path&, ErrorTable&)> crawl;
+    };
+    Case cases[] =
+    {
+        { "batched", [&pool](const fs::path& root, ErrorTable& errors)
+        {
+            std::string dir = root.string();
+            WalkPolicy walk(dir, follow());
+            CrawlHooks hooks;
+            hooks.errors = &errors;
+            hooks.walk = &walk;
+            return listAllFiles(dir, 8, CancellationToken(), pool, hooks).size();
+        } },
+        { "monitor", [&pool](const fs::path& root, ErrorTable& errors)
+        {
+            std::string dir = root.string();
+            WalkPolicy walk(dir, follow());
+            CrawlHooks hooks;
+            hooks.errors = &errors;
+            hooks.walk = &walk;
+            return listAllFilesShared(dir, 16, CancellationToken(), pool, hooks).files.size();
+        } },
+    };
+
+    for (Case& c : cases)
+    {
+        std::size_t cleanItems = 0, brokenItems = 0, eacces = 0, unused = 0;
+        std::string prefix = std::string("errors.") + c.name;
+        BenchResult* rc = benchErrorCrawl(runner, prefix + ".clean", cleanItems, unused,
+                                          [&](ErrorTable& e) { return c.crawl(clean.root(), e); });
+        BenchResult* rb = benchErrorCrawl(runner, prefix + ".broken", brokenItems, eacces,
+                                          [&](ErrorTable& e) { return c.crawl(broken.root(), e); });
+        if (rc)
+            rc->items = cleanItems;
+        if (rb)
+        {
+            rb->items = brokenItems;
+            rb->metrics["eacces"] = static_cast<double>(eacces);
+        }
+        if (rc && rb && rc->itemsPerSec() > 0)
+            rb->metrics["rate_vs_clean"] = rb->itemsPerSec() / rc->itemsPerSec();
+    }
+}
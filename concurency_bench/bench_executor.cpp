@@ -0,0 +1,86 @@
+#include "suites.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "executor.h"
+
+/*
+ * Task throughput of the executors (include/executor.h) - 1e6 tasks which do nothing
+ * but count, so only the cost of getting a task to a thread and running it is measured.
+ *
+ *  executor.<name>.execute  - execute() + a counter, the caller waits for the last task
+ *  executor.<name>.spawn    - spawn() of every task, the caller waits for all the futures
+ *
+ * new_thread starts an OS thread per task; it gets 1e4 tasks, items/s stays comparable.
+ */
+
+constexpr std::size_t EXECUTOR_TASKS = 1000000;
+constexpr std::size_t NEW_THREAD_TASKS = 10000;
+
+static void benchExecutor(BenchRunner& runner, Executor& executor, std::size_t tasks)
+{
+    std::string prefix = std::string("executor.") + executor.name();
+
+    std::atomic<std::size_t> done(0);
+    std::mutex mutex;
+    std::condition_variable finished;
+    runner.run(prefix + ".execute", tasks, [&]
+    {
+        done = 0;
+        for (std::size_t i = 0; i < tasks; ++i)
+        {
+            executor.execute([&]
+            {
+                if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == tasks)
+                {
+                    std::lock_guard<std::mutex> lck(mutex);
+                    finished.notify_one();
+                }
+            });
+        }
+        std::unique_lock<std::mutex> lck(mutex);
+        finished.wait(lck, [&] { return done.load() == tasks; });
+    });
+
+    std::vector<std::future<std::size_t>> futures;
+    futures.reserve(tasks);
+    runner.run(prefix + ".spawn", tasks, [&]
+    {
+        futures.clear();
+        for (std::size_t i = 0; i < tasks; ++i)
+            futures.push_back(spawn(executor, [](std::size_t x) { return x + 1; }, i));
+        std::size_t sum = 0;
+        for (std::future<std::size_t>& f : futures)
+            sum += f.get();
+        if (sum != tasks * (tasks + 1) / 2)
+            throw std::runtime_error(prefix + ".spawn: wrong sum");
+    });
+}
+
+void benchExecutors(BenchRunner& runner)
+{
+    // the names come from the executors, which cost next to nothing to create -
+    // runner.run skips what is filtered out
+    {
+        InlineExecutor executor;
+        benchExecutor(runner, executor, EXECUTOR_TASKS);
+    }
+    {
+        NewThreadExecutor executor;
+        benchExecutor(runner, executor, NEW_THREAD_TASKS);
+    }
+    {
+        FixedThreadPool executor;
+        benchExecutor(runner, executor, EXECUTOR_TASKS);
+    }
+    {
+        WorkStealingExecutor executor;
+        benchExecutor(runner, executor, EXECUTOR_TASKS);
+    }
+}
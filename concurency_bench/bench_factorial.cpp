@@ -0,0 +1,124 @@
+#include "suites.h"
+
+#include <ctime>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "big_factorial.h"
+#include "fork_join.h"
+#include "memo_cache.h"
+
+constexpr int MEMO_REQUESTS = 64;      // concurrent requests ...
+constexpr int MEMO_DISTINCT = 4;       // ... for this many different n
+
+/// Binary splitting has to agree with the simple loop, and C(n, k) * k! * (n-k)! with n!.
+static void checkFactorial(ForkJoinPool& pool)
+{
+    const std::uint32_t n = 3000;
+    BigInteger expected = factorialNaive(n);
+    if (factorial(n) != expected || factorial(n, &pool) != expected || factorialAsync(pool, n).get() != expected)
+        throw std::runtime_error("factorial: binary splitting differs from the naive product");
+    if (factorial(20).toString() != "2432902008176640000")
+        throw std::runtime_error("factorial: wrong 20!");
+
+    const std::uint32_t k = 1234;
+    BigInteger c = binomialAsync(pool, n, k).get();
+    if (multiply(multiply(c, factorial(k)), factorial(n - k)) != expected)
+        throw std::runtime_error("factorial: wrong binomial");
+}
+
+/// MEMO_REQUESTS threads asking for factorials at once, with or without the cache.
+/// Returns the process CPU time in ms.
+static double duplicateRequests(std::uint32_t n, MemoCache<std::uint32_t, BigInteger>* cache)
+{
+    std::clock_t start = std::clock();
+    std::vector<std::future<std::size_t>> futures;
+    for (int i = 0; i < MEMO_REQUESTS; ++i)
+    {
+        std::uint32_t m = n - i % MEMO_DISTINCT;
+        futures.push_back(std::async(std::launch::async, [m, cache]
+        {
+            if (!cache)
+                return factorial(m).bits();
+            return cache->get(m, [m] { return factorial(m); }).get().bits();
+        }));
+    }
+    for (auto& f : futures)
+        f.get();
+    return 1000.0 * (std::clock() - start) / CLOCKS_PER_SEC;
+}
+
+void benchFactorial(BenchRunner& runner)
+{
+    std::vector<std::string> names = { "factorial.memo.plain", "factorial.memo.cached" };
+    for (unsigned n = 10000; n <= runner.config().factorialMax; n *= 10)
+    {
+        std::string suffix = ".n" + std::to_string(n);
+        if (n <= 10000)
+            names.push_back("factorial.naive" + suffix);
+        names.push_back("factorial.serial" + suffix);
+        names.push_back("factorial.pool" + suffix);
+    }
+    if (!runner.anyEnabled(names))
+        return;
+
+    ForkJoinPool pool;
+    checkFactorial(pool);
+
+    for (unsigned n = 10000; n <= runner.config().factorialMax; n *= 10)
+    {
+        std::string suffix = ".n" + std::to_string(n);
+        std::size_t bits = 0;
+
+        // the concurency11 loop, quadratic - only for the small n
+        if (n <= 10000)
+        {
+            runner.run("factorial.naive" + suffix, n, [&]
+            {
+                bits = factorialNaive(n).bits();
+            });
+        }
+
+        BenchResult* serial = runner.run("factorial.serial" + suffix, n, [&]
+        {
+            bits = factorial(n).bits();
+        });
+        if (serial)
+            serial->metrics["bits"] = static_cast<double>(bits);
+
+        BenchResult* parallel = runner.run("factorial.pool" + suffix, n, [&]
+        {
+            bits = factorialAsync(pool, n).get().bits();
+        });
+        if (parallel)
+            parallel->metrics["bits"] = static_cast<double>(bits);
+    }
+
+    // ---- duplicate requests, include/memo_cache.h ----
+    const std::uint32_t memoN = 10000;
+    const int reps = runner.config().reps;
+    std::vector<double> cpuMs;      // every rep, the metric is the median like p50
+    BenchResult* plain = runner.run("factorial.memo.plain", MEMO_REQUESTS, [&]
+    {
+        cpuMs.push_back(duplicateRequests(memoN, nullptr));
+    });
+    if (plain)
+        plain->metrics["cpu_ms"] = medianOfReps(cpuMs, reps);
+
+    // a fresh cache every rep - measures the single flight, not the hits
+    std::unique_ptr<MemoCache<std::uint32_t, BigInteger>> cache;
+    cpuMs.clear();
+    BenchResult* cached = runner.run("factorial.memo.cached", MEMO_REQUESTS,
+        [&] { cache.reset(new MemoCache<std::uint32_t, BigInteger>(16)); },
+        [&]
+    {
+        cpuMs.push_back(duplicateRequests(memoN, cache.get()));
+    });
+    if (cached)
+    {
+        cached->metrics["cpu_ms"] = medianOfReps(cpuMs, reps);
+        cached->metrics["computed"] = static_cast<double>(cache->stats().misses);
+    }
+}
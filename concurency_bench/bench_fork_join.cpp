@@ -0,0 +1,158 @@
+#include "suites.h"
+
+#include <algorithm>
+#include <future>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "fork_join.h"
+#include "fork_join_algorithms.h"
+#include "list_directory.h"
+#include "synthetic_tree.h"
+
+constexpr std::size_t SORT_SIZE = 1000000;
+constexpr std::size_t REDUCE_SIZE = 4000000;
+constexpr std::size_t NAIVE_CUTOFF = 2048; // without any cutoff std::async runs out of threads
+
+/// The concurency4 way: std::async for the left part at every level.
+template<typename RandomIt>
+static void asyncQuicksort(RandomIt first, RandomIt last)
+{
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    std::size_t n = static_cast<std::size_t>(last - first);
+    if (n <= NAIVE_CUTOFF)
+    {
+        std::sort(first, last);
+        return;
+    }
+    T pivot = *(first + n / 2);
+    RandomIt lower = std::partition(first, last, [&](const T& x) { return x < pivot; });
+    RandomIt upper = std::partition(lower, last, [&](const T& x) { return !(pivot < x); });
+
+    auto left = std::async(std::launch::async, [first, lower] { asyncQuicksort(first, lower); });
+    asyncQuicksort(upper, last);
+    left.get();
+}
+
+template<typename RandomIt>
+static double asyncReduce(RandomIt first, RandomIt last)
+{
+    std::size_t n = static_cast<std::size_t>(last - first);
+    if (n <= NAIVE_CUTOFF * 16)
+        return std::accumulate(first, last, 0.0);
+    RandomIt mid = first + n / 2;
+    auto left = std::async(std::launch::async, [first, mid] { return asyncReduce(first, mid); });
+    double right = asyncReduce(mid, last);
+    return left.get() + right;
+}
+
+static string_vector serialListDirectory(const std::string& dir)
+{
+    string_vector listing;
+    listing.push_back("\n> " + dir + ":\n\t ");
+    std::vector<std::string> subdirs;
+    for (fs::directory_iterator it(dir); it != fs::directory_iterator(); ++it)
+    {
+        if (fs::is_directory(it->path()))
+            subdirs.push_back(it->path());
+        else
+            listing.push_back(it->path().filename());
+    }
+    for (const std::string& sub : subdirs)
+    {
+        string_vector lst = serialListDirectory(sub);
+        std::move(lst.begin(), lst.end(), std::back_inserter(listing));
+    }
+    return listing;
+}
+
+static void checkSorted(const std::vector<int>& v, const char* name)
+{
+    if (!std::is_sorted(v.begin(), v.end()))
+        throw std::runtime_error(std::string(name) + ": not sorted");
+}
+
+void benchForkJoin(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "forkjoin.quicksort.serial", "forkjoin.quicksort.async_naive", "forkjoin.quicksort.pool",
+                             "forkjoin.reduce.serial", "forkjoin.reduce.async_naive", "forkjoin.reduce.pool",
+                             "forkjoin.list_directory.serial", "forkjoin.list_directory.async_naive",
+                             "forkjoin.list_directory.pool" }))
+        return;
+
+    ForkJoinPool pool;
+
+    // ---- quicksort ----
+    std::vector<int> input(SORT_SIZE);
+    std::mt19937 gen(runner.config().tree.seed);
+    std::generate(input.begin(), input.end(), [&gen] { return static_cast<int>(gen()); });
+    std::vector<int> data;
+    auto reset = [&data, &input] { data = input; };
+
+    runner.run("forkjoin.quicksort.serial", SORT_SIZE, reset, [&data]
+    {
+        std::sort(data.begin(), data.end());
+    });
+    checkSorted(data, "forkjoin.quicksort.serial");
+
+    runner.run("forkjoin.quicksort.async_naive", SORT_SIZE, reset, [&data]
+    {
+        asyncQuicksort(data.begin(), data.end());
+    });
+    checkSorted(data, "forkjoin.quicksort.async_naive");
+
+    runner.run("forkjoin.quicksort.pool", SORT_SIZE, reset, [&data, &pool]
+    {
+        parallelQuicksort(pool, data.begin(), data.end());
+    });
+    checkSorted(data, "forkjoin.quicksort.pool");
+
+    // ---- reduce ----
+    std::vector<double> values(REDUCE_SIZE);
+    std::iota(values.begin(), values.end(), 0.0);
+    double expected = std::accumulate(values.begin(), values.end(), 0.0);
+    volatile double sink = 0;
+
+    runner.run("forkjoin.reduce.serial", REDUCE_SIZE, [&]
+    {
+        sink = std::accumulate(values.begin(), values.end(), 0.0);
+    });
+    runner.run("forkjoin.reduce.async_naive", REDUCE_SIZE, [&]
+    {
+        sink = asyncReduce(values.begin(), values.end());
+    });
+    runner.run("forkjoin.reduce.pool", REDUCE_SIZE, [&]
+    {
+        sink = parallelReduce(pool, values.begin(), values.end(), 0.0, std::plus<double>());
+        if (sink != expected)
+            throw std::runtime_error("forkjoin.reduce.pool: wrong sum");
+    });
+
+    // ---- directory listing ----
+    if (!runner.anyEnabled({ "forkjoin.list_directory.serial", "forkjoin.list_directory.async_naive",
+                             "forkjoin.list_directory.pool" }))
+        return;
+
+    SyntheticTree tree(runner.config().tree);
+    std::string root = tree.root().string();
+    std::size_t entries = tree.files() + tree.dirs();
+
+    runner.run("forkjoin.list_directory.serial", entries, [&]
+    {
+        if (serialListDirectory(root).size() != entries)
+            throw std::runtime_error("forkjoin.list_directory.serial: wrong number of entries");
+    });
+    runner.run("forkjoin.list_directory.async_naive", entries, [&]
+    {
+        std::string dir(root);
+        if (listDirectory(std::move(dir)).size() != entries)
+            throw std::runtime_error("forkjoin.list_directory.async_naive: wrong number of entries");
+    });
+    runner.run("forkjoin.list_directory.pool", entries, [&]
+    {
+        if (listDirectoryForkJoin(pool, root).size() != entries)
+            throw std::runtime_error("forkjoin.list_directory.pool: wrong number of entries");
+    });
+}
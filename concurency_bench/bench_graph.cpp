@@ -0,0 +1,109 @@
+#include "suites.h"
+
+#include <cmath>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "sin_graph.h"
+
+/*
+ * The sin graph of concurency2 over 1e7 points (include/sin_graph.h), written to /dev/null.
+ *
+ *  graph.sequential.put_endl       - sin over everything, then cout.put per star and std::endl
+ *                                    per row, like display_graph
+ *  graph.sequential.chunked_write  - sin over everything, then the rows of a chunk formatted into
+ *                                    a buffer and written at once: the buffering without the pipeline
+ *  graph.pipeline.chunkN           - sinGraphPipeline with N points per chunk
+ *      mb_per_s                    - bytes of the graph per second
+ */
+
+constexpr std::size_t NUM_POINTS = 10000000;
+
+class DevNull
+{
+    int _fd;
+
+public:
+    DevNull() : _fd(::open("/dev/null", O_WRONLY))
+    {
+        if (_fd < 0)
+            throw std::runtime_error("can't open /dev/null");
+    }
+    ~DevNull() { ::close(_fd); }
+
+    DevNull(const DevNull&) = delete;
+    DevNull& operator=(const DevNull&) = delete;
+
+    int fd() const { return _fd; }
+};
+
+static std::size_t chunkedWrite(const std::vector<double>& xs, int fd, std::size_t chunk)
+{
+    std::vector<double> ys(xs.size());
+    for (std::size_t i = 0; i < xs.size(); ++i)
+        ys[i] = std::sin(xs[i]);
+
+    GraphRows rows;
+    std::vector<char> buffer(chunk * GraphRows::MAX_ROW);
+    std::size_t written = 0;
+    for (std::size_t i = 0; i < ys.size(); i += chunk)
+    {
+        std::size_t bytes = 0;
+        for (std::size_t k = i; k < ys.size() && k < i + chunk; ++k)
+            bytes += rows.render(ys[k], buffer.data() + bytes);
+        writeAll(fd, buffer.data(), bytes);
+        written += bytes;
+    }
+    return written;
+}
+
+void benchGraph(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "graph.sequential.put_endl", "graph.sequential.chunked_write",
+                             "graph.pipeline.chunk4096", "graph.pipeline.chunk65536" }))
+        return;
+
+    const double pi = 3.141592;
+    std::vector<double> xs(NUM_POINTS);
+    for (std::size_t i = 0; i < NUM_POINTS; ++i)
+        xs[i] = i * pi / 16.;
+
+    DevNull devNull;
+    std::size_t graphBytes = 0;     // what every variant has to write
+    for (double x : xs)
+        graphBytes += starCount(std::sin(x)) + 1;
+    auto addRate = [&](BenchResult* r)
+    {
+        if (r && r->p50 > 0)
+            r->metrics["mb_per_s"] = graphBytes / r->p50;   // bytes per us = MB/s
+    };
+
+    if (runner.enabled("graph.sequential.put_endl"))
+    {
+        std::ofstream os("/dev/null");
+        addRate(runner.run("graph.sequential.put_endl", NUM_POINTS, [&]
+        {
+            sinThenGraph(xs.begin(), xs.end(), os);
+        }));
+    }
+
+    addRate(runner.run("graph.sequential.chunked_write", NUM_POINTS, [&]
+    {
+        if (chunkedWrite(xs, devNull.fd(), 65536) != graphBytes)
+            throw std::runtime_error("graph.sequential.chunked_write: the graph differs in size");
+    }));
+
+    for (std::size_t chunk : { std::size_t(4096), std::size_t(65536) })
+    {
+        std::string name = "graph.pipeline.chunk" + std::to_string(chunk);
+        addRate(runner.run(name, NUM_POINTS, [&]
+        {
+            std::size_t bytes = sinGraphPipeline(xs.begin(), xs.end(), devNull.fd(), chunk);
+            if (bytes != graphBytes)
+                throw std::runtime_error(name + ": the graph differs in size");
+        }));
+    }
+}
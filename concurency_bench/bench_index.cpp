@@ -0,0 +1,204 @@
+#include "suites.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "batched_crawl.h"
+#include "file_index.h"
+#include "synthetic_tree.h"
+
+/*
+ * FileIndex (include/file_index.h) against std::unordered_map under one std::mutex.
+ *
+ * 2e6 paths like a crawl produces them ("/home/user/project/d<i/32>/.../f<i>.dat", ~45 bytes).
+ *
+ *  index.build.<map>.tN  - N threads insert all the paths, split between them, into a fresh map
+ *      bytes_per_entry   - the tables and the entries; for the unordered_map the buckets and the
+ *                          nodes with the std::string (the heap part when it's longer than 15)
+ *  index.lookup.<map>.tN - N threads look up every path once plus as many missing ones,
+ *                          in the map built before (published)
+ *      ns_per_lookup     - the time one lookup takes one thread
+ *
+ *  index.crawl.<plain|indexed> - listAllFiles of the synthetic tree without / with a FileIndex,
+ *                                what the inserts add to a crawl
+ */
+
+constexpr std::size_t NUM_PATHS = 2000000;
+
+class LockedMap
+{
+    std::unordered_map<std::string, std::uint64_t> _map;
+    mutable std::mutex _mutex;
+
+public:
+    explicit LockedMap(std::size_t expected) { _map.reserve(expected); }
+
+    bool insert(const std::string& path, std::uint64_t size)
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _map.emplace(path, size).second;
+    }
+
+    void publish() {}
+
+    bool find(const std::string& path, std::uint64_t& size) const
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        auto it = _map.find(path);
+        if (it == _map.end())
+            return false;
+        size = it->second;
+        return true;
+    }
+
+    std::size_t size() const { return _map.size(); }
+
+    std::size_t memoryBytes() const
+    {
+        // a bucket is a pointer, a node the next pointer, the pair and the cached hash
+        std::size_t n = _map.bucket_count() * sizeof(void*)
+                      + _map.size() * (sizeof(void*) + sizeof(std::pair<const std::string, std::uint64_t>) + sizeof(std::size_t));
+        for (const auto& kv : _map)
+            if (kv.first.size() > 15)
+                n += kv.first.capacity() + 1;
+        return n;
+    }
+};
+
+static std::string makePath(std::size_t i)
+{
+    return "/home/user/project/d" + std::to_string(i / 32 % 1024) + "/d" + std::to_string(i / 32768)
+         + "/f" + std::to_string(i) + ".dat";
+}
+
+template<typename Map>
+static void fill(Map& map, const std::vector<std::string>& paths, int threads)
+{
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.push_back(std::thread([&, t]
+        {
+            for (std::size_t i = t; i < paths.size(); i += threads)
+                map.insert(paths[i], i);
+        }));
+    }
+    for (std::thread& th : workers)
+        th.join();
+}
+
+template<typename Map>
+static void benchMap(BenchRunner& runner, const std::string& name, const std::vector<std::string>& paths,
+                     const std::vector<std::string>& missing)
+{
+    for (int threads = 1; threads <= 4; threads *= 4)
+    {
+        std::string suffix = name + ".t" + std::to_string(threads);
+
+        std::unique_ptr<Map> map;
+        if (runner.enabled("index.build." + suffix))
+        {
+            BenchResult* r = runner.run("index.build." + suffix, paths.size(), [&]
+            {
+                map.reset();
+                map.reset(new Map(0));
+            },
+            [&]
+            {
+                fill(*map, paths, threads);
+                if (map->size() != paths.size())
+                    throw std::runtime_error("index.build." + suffix + ": lost inserts");
+            });
+            if (r)
+                r->metrics["bytes_per_entry"] = double(map->memoryBytes()) / paths.size();
+        }
+
+        if (!runner.enabled("index.lookup." + suffix))
+            continue;
+        map.reset(new Map(paths.size()));
+        fill(*map, paths, 1);
+        map->publish();
+        BenchResult* r = runner.run("index.lookup." + suffix, 2 * paths.size(), [&]
+        {
+            std::vector<std::thread> readers;
+            std::vector<std::size_t> found(threads);
+            for (int t = 0; t < threads; ++t)
+            {
+                readers.push_back(std::thread([&, t]
+                {
+                    std::uint64_t size;
+                    for (std::size_t i = t; i < paths.size(); i += threads)
+                    {
+                        if (map->find(paths[i], size) && size == i)
+                            ++found[t];
+                        if (map->find(missing[i], size))
+                            --found[t];
+                    }
+                }));
+            }
+            std::size_t total = 0;
+            for (int t = 0; t < threads; ++t)
+            {
+                readers[t].join();
+                total += found[t];
+            }
+            if (total != paths.size())
+                throw std::runtime_error("index.lookup." + suffix + ": wrong answers");
+        });
+        if (r && r->itemsPerSec() > 0)
+            r->metrics["ns_per_lookup"] = 1e9 / r->itemsPerSec() * threads;
+    }
+}
+
+void benchIndex(BenchRunner& runner)
+{
+    std::vector<std::string> mapNames;
+    for (const char* map : { "file_index", "unordered_map_mutex" })
+        for (int threads = 1; threads <= 4; threads *= 4)
+            for (const char* kind : { "index.build.", "index.lookup." })
+                mapNames.push_back(kind + std::string(map) + ".t" + std::to_string(threads));
+    if (runner.anyEnabled(mapNames))
+    {
+        std::vector<std::string> paths, missing;
+        paths.reserve(NUM_PATHS);
+        missing.reserve(NUM_PATHS);
+        for (std::size_t i = 0; i < NUM_PATHS; ++i)
+        {
+            paths.push_back(makePath(i));
+            missing.push_back(makePath(i + NUM_PATHS));
+        }
+        benchMap<FileIndex>(runner, "file_index", paths, missing);
+        benchMap<LockedMap>(runner, "unordered_map_mutex", paths, missing);
+    }
+
+    if (!runner.anyEnabled({ "index.crawl.plain", "index.crawl.indexed" }))
+        return;
+
+    TreeShape shape = runner.config().tree;
+    shape.fileBytes = 0;
+    SyntheticTree tree(shape);
+    FixedThreadPool pool(4);
+    std::string root = tree.root().string();
+
+    BenchResult* plain = runner.run("index.crawl.plain", tree.files(), [&]
+    {
+        listAllFiles(root, 8, CancellationToken(), pool);
+    });
+    BenchResult* indexed = runner.run("index.crawl.indexed", tree.files(), [&]
+    {
+        FileIndex index;
+        CrawlHooks hooks;
+        hooks.index = &index;
+        listAllFiles(root, 8, CancellationToken(), pool, hooks);
+        index.publish();
+        if (index.size() != tree.files())
+            throw std::runtime_error("index.crawl.indexed: files missing in the index");
+    });
+    if (plain && indexed && plain->p50 > 0)
+        indexed->metrics["overhead_pct"] = (indexed->p50 / plain->p50 - 1.0) * 100.0;
+}
@@ -0,0 +1,84 @@
+#include "suites.h"
+
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "adaptive_mutex.h"
+#include "message_queue.h"
+
+/*
+ * std::mutex vs AdaptiveMutex (include/adaptive_mutex.h) on the critical sections of the crawls.
+ *
+ *  lock.<mutex>.push.tN       - N threads push_back into one vector, the MonitorResult::putDir case
+ *  lock.<mutex>.queue_send.tN - N producers send into one MessageQueue, a server recieves,
+ *                               the concurency7 fileQueue case
+ *
+ * context_switches (perf counters, when available) shows what the spinning saves.
+ */
+
+constexpr int NUM_LOCKS = 400000;   // per rep, split between the threads
+
+template<typename Mutex>
+static void pushFromThreads(int threads)
+{
+    std::vector<int> shared;
+    Mutex mutex;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.push_back(std::thread([&, t]
+        {
+            for (int i = t; i < NUM_LOCKS; i += threads)
+            {
+                std::lock_guard<Mutex> lck(mutex);
+                shared.push_back(i);
+            }
+        }));
+    }
+    for (std::thread& th : workers)
+        th.join();
+    if (shared.size() != static_cast<std::size_t>(NUM_LOCKS))
+        throw std::runtime_error("lock.push: lost push_backs");
+}
+
+template<typename Mutex>
+static void sendFromThreads(int threads)
+{
+    MessageQueue<int, Mutex> queue;
+    std::thread server([&queue]
+    {
+        for (int i = 0; i < NUM_LOCKS; ++i)
+            queue.recieve();
+    });
+    std::vector<std::thread> producers;
+    for (int t = 0; t < threads; ++t)
+    {
+        producers.push_back(std::thread([&queue, threads, t]
+        {
+            for (int i = t; i < NUM_LOCKS; i += threads)
+                queue.send(int(i));
+        }));
+    }
+    for (std::thread& th : producers)
+        th.join();
+    server.join();
+}
+
+template<typename Mutex>
+static void benchMutex(BenchRunner& runner, const std::string& name)
+{
+    for (int threads = 1; threads <= 16; threads *= 4)
+    {
+        std::string suffix = ".t" + std::to_string(threads);
+        runner.run("lock." + name + ".push" + suffix, NUM_LOCKS, [threads] { pushFromThreads<Mutex>(threads); });
+        runner.run("lock." + name + ".queue_send" + suffix, NUM_LOCKS, [threads] { sendFromThreads<Mutex>(threads); });
+    }
+}
+
+void benchLock(BenchRunner& runner)
+{
+    benchMutex<std::mutex>(runner, "std_mutex");
+    benchMutex<AdaptiveMutex>(runner, "adaptive");
+}
@@ -0,0 +1,41 @@
+#include "suites.h"
+
+#include <thread>
+#include <vector>
+#include <memory>
+#include <string>
+#include "filesystem.h"
+#include "log_file.h"
+
+constexpr int NUM_WRITERS = 4;
+constexpr int NUM_LINES = 1000; // per writer
+
+void benchLogger(BenchRunner& runner)
+{
+    std::string logPath = (fs::temp_directory_path() / "concurency_bench_log.txt").string();
+    std::unique_ptr<LogFile> log;
+
+    // concurency10: the first writer opens the file through call_once, all writers share it.
+    // A fresh LogFile is created for every rep so the call_once path is part of the measurement.
+    runner.run("logger.call_once", NUM_WRITERS * NUM_LINES,
+               [&log, &logPath] { log.reset(new LogFile(logPath)); },
+               [&log]
+    {
+        std::vector<std::thread> writers;
+        for (int w = 0; w < NUM_WRITERS; ++w)
+        {
+            writers.push_back(std::thread([&log, w]
+            {
+                std::string id = "writer" + std::to_string(w);
+                for (int i = 0; i < NUM_LINES; ++i)
+                    log->shared_print(id, i);
+            }));
+        }
+        for (std::thread& th : writers)
+            th.join();
+    });
+
+    log.reset();
+    std::error_code ec;
+    fs::remove(logPath, ec);
+}
@@ -0,0 +1,196 @@
+#include "suites.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "synthetic_tree.h"
+#include "filesystem.h"
+#include "message_queue.h"
+#include "priority_message_queue.h"
+
+/*
+ * Time to first result for the shallow levels while the servers are busy.
+ *
+ * concurency7 style servers take directories from a queue, list them and queue the subdirectories.
+ * A background crawl of a deep tree is running, then a user asks for the same tree.
+ * Measured: from the user's request until all of its directories down to SHALLOW_DEPTH are listed.
+ *
+ * Every listing costs LISTING_COST more (a slow disk), so the background crawl takes long
+ * enough that the user comes in when its backlog has waited longer than the queue's maxWait
+ * (BACKLOG_AGE) - the case where the starvation protection could undo the priorities.
+ *
+ *  fifo      - MessageQueue, the user's directories wait behind the background backlog
+ *  priority  - PriorityMessageQueue, lane = depth for the user, 4 + depth for the background
+ *      interactive_ms   - the user's wait (the p50)
+ *      backlog_age_ms   - how long the background crawl ran before the user came
+ *      background_left  - background directories not listed yet at that moment
+ */
+
+constexpr int PRIORITY_SERVERS = 4;
+constexpr int SHALLOW_DEPTH = 2;
+constexpr int BACKGROUND = 0;
+constexpr int INTERACTIVE = 1;
+constexpr std::chrono::microseconds LISTING_COST(400);
+constexpr std::chrono::milliseconds MAX_WAIT(100);                  // PriorityMessageQueue's default
+constexpr std::chrono::milliseconds BACKLOG_AGE(2 * MAX_WAIT);
+
+struct DirJob
+{
+    std::string dir;
+    int depth;      // -1 stops the server
+    int crawl;
+};
+
+struct FifoJobs
+{
+    MessageQueue<DirJob> queue;
+    void send(DirJob&& job, unsigned) { queue.send(std::move(job)); }
+    DirJob recieve() { return queue.recieve(); }
+};
+
+struct PriorityJobs
+{
+    PriorityMessageQueue<DirJob> queue;
+    PriorityJobs() : queue(8, MAX_WAIT) {}
+    void send(DirJob&& job, unsigned priority) { queue.send(std::move(job), priority); }
+    DirJob recieve() { return queue.recieve(); }
+};
+
+template<typename Jobs>
+class CrawlFarm
+{
+    Jobs _jobs;
+    std::vector<std::thread> _servers;
+    std::atomic<bool> _stop;
+    std::atomic<int> _listed[2];
+    std::atomic<int> _shallowLeft[2];
+    MessageQueue<int> _shallowDone;     // crawl id when its shallow levels are listed
+
+    static unsigned priority(const DirJob& job)
+    {
+        return job.crawl == INTERACTIVE ? job.depth : 4 + job.depth;
+    }
+
+    void serve()
+    {
+        for (;;)
+        {
+            DirJob job = _jobs.recieve();
+            if (job.depth < 0 || _stop.load(std::memory_order_relaxed))
+                return;
+
+            for (fs::directory_iterator it(job.dir); it != fs::directory_iterator(); ++it)
+            {
+                if (fs::is_directory(it->symlink_status()))
+                {
+                    DirJob sub = { it->path().string(), job.depth + 1, job.crawl };
+                    unsigned p = priority(sub);
+                    _jobs.send(std::move(sub), p);
+                }
+            }
+
+            std::this_thread::sleep_for(LISTING_COST);
+            _listed[job.crawl].fetch_add(1, std::memory_order_relaxed);
+            if (job.depth <= SHALLOW_DEPTH && _shallowLeft[job.crawl].fetch_sub(1) == 1)
+                _shallowDone.send(int(job.crawl));
+        }
+    }
+
+public:
+    CrawlFarm(int shallowDirs) : _stop(false)
+    {
+        for (int c = 0; c < 2; ++c)
+        {
+            _listed[c] = 0;
+            _shallowLeft[c] = shallowDirs;
+        }
+        for (int i = 0; i < PRIORITY_SERVERS; ++i)
+            _servers.push_back(std::thread(&CrawlFarm::serve, this));
+    }
+
+    ~CrawlFarm()
+    {
+        _stop = true;
+        for (int i = 0; i < PRIORITY_SERVERS; ++i)
+            _jobs.send(DirJob{ std::string(), -1, BACKGROUND }, 0);
+        for (std::thread& t : _servers)
+            t.join();
+    }
+
+    void start(const std::string& root, int crawl)
+    {
+        DirJob job = { root, 0, crawl };
+        unsigned p = priority(job);
+        _jobs.send(std::move(job), p);
+    }
+
+    int listed(int crawl) const { return _listed[crawl].load(std::memory_order_relaxed); }
+
+    void waitShallow(int crawl)
+    {
+        while (_shallowDone.recieve() != crawl)
+        {
+        }
+    }
+};
+
+template<typename Jobs>
+static void benchShallowFirst(BenchRunner& runner, const std::string& name,
+                              const std::string& root, int dirs, int shallowDirs)
+{
+    if (!runner.enabled(name))
+        return;
+
+    std::unique_ptr<CrawlFarm<Jobs>> farm;
+    double ageMs = 0, left = 0;
+    int setups = 0;
+    BenchResult* r = runner.run(name, shallowDirs, [&]
+    {
+        farm.reset();
+        farm.reset(new CrawlFarm<Jobs>(shallowDirs));
+        auto start = std::chrono::steady_clock::now();
+        farm->start(root, BACKGROUND);
+        // let the backlog of the background crawl get older than maxWait
+        std::this_thread::sleep_for(BACKLOG_AGE);
+        ageMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        left += dirs - farm->listed(BACKGROUND);
+        ++setups;
+    },
+    [&]
+    {
+        farm->start(root, INTERACTIVE);
+        farm->waitShallow(INTERACTIVE);
+    });
+    farm.reset();
+
+    if (r)
+    {
+        r->metrics["interactive_ms"] = r->p50 / 1000;
+        r->metrics["backlog_age_ms"] = ageMs / setups;
+        r->metrics["background_left"] = left / setups;
+    }
+}
+
+void benchPriority(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "priority.shallow_first.fifo", "priority.shallow_first.priority" }))
+        return;
+
+    // two levels deeper than the other suites
+    TreeShape shape = runner.config().tree;
+    shape.depth += 2;
+    SyntheticTree tree(shape);
+
+    int shallowDirs = 0;
+    for (int d = 0, n = 1; d <= std::min(SHALLOW_DEPTH, shape.depth); ++d, n *= shape.fanout)
+        shallowDirs += n;
+
+    std::string root = tree.root().string();
+    int dirs = static_cast<int>(tree.dirs());
+    benchShallowFirst<FifoJobs>(runner, "priority.shallow_first.fifo", root, dirs, shallowDirs);
+    benchShallowFirst<PriorityJobs>(runner, "priority.shallow_first.priority", root, dirs, shallowDirs);
+}
@@ -0,0 +1,135 @@
+#include "suites.h"
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "batched_crawl.h"
+#include "crawl_progress.h"
+#include "executor.h"
+#include "monitor_crawl.h"
+#include "synthetic_tree.h"
+
+/*
+ * What the progress counters (include/crawl_progress.h) cost.
+ *
+ *  progress.<crawl>.off        - listAllFiles / listAllFilesShared without a CrawlProgress
+ *  progress.<crawl>.counters   - with one
+ *  progress.<crawl>.reporter   - with one and a ProgressReporter printing every 10 ms
+ *      overhead_pct = p50 against the .off run, should stay below 1 (mostly noise)
+ *  progress.add.tN             - N threads calling add() as fast as they can
+ *  progress.shared_atomic.tN   - the same counts on five atomics shared by all threads
+ */
+
+constexpr int NUM_ADDS = 1000000;   // per rep, split between the threads
+
+template<typename Crawl>
+static void benchProgressCrawl(BenchRunner& runner, const std::string& name, std::size_t files, Crawl crawl)
+{
+    BenchResult* off = runner.run("progress." + name + ".off", files, [&]
+    {
+        if (crawl(nullptr) != files)
+            throw std::runtime_error("progress." + name + ": wrong number of files");
+    });
+
+    BenchResult* on = runner.run("progress." + name + ".counters", files, [&]
+    {
+        CrawlProgress progress;
+        if (crawl(&progress) != files || progress.snapshot().files != files)
+            throw std::runtime_error("progress." + name + ": wrong number of files");
+    });
+
+    BenchResult* reporting = runner.run("progress." + name + ".reporter", files, [&]
+    {
+        std::ostringstream out;
+        CrawlProgress progress;
+        ProgressReporter reporter(progress, std::chrono::milliseconds(10), out);
+        if (crawl(&progress) != files)
+            throw std::runtime_error("progress." + name + ": wrong number of files");
+    });
+
+    if (off && off->p50 > 0)
+    {
+        if (on)
+            on->metrics["overhead_pct"] = (on->p50 - off->p50) / off->p50 * 100.0;
+        if (reporting)
+            reporting->metrics["overhead_pct"] = (reporting->p50 - off->p50) / off->p50 * 100.0;
+    }
+}
+
+struct SharedCounters
+{
+    std::atomic<std::uint64_t> dirsFound, dirsListed, files, bytes, errors;
+
+    SharedCounters() : dirsFound(0), dirsListed(0), files(0), bytes(0), errors(0) {}
+
+    void add(std::uint64_t subdirs, std::uint64_t f)
+    {
+        dirsListed.fetch_add(1, std::memory_order_relaxed);
+        dirsFound.fetch_add(subdirs, std::memory_order_relaxed);
+        files.fetch_add(f, std::memory_order_relaxed);
+    }
+};
+
+template<typename Counters>
+static void addFromThreads(Counters& counters, int threads)
+{
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.push_back(std::thread([&counters, threads, t]
+        {
+            for (int i = t; i < NUM_ADDS; i += threads)
+                counters.add(4, 8);
+        }));
+    }
+    for (std::thread& th : workers)
+        th.join();
+}
+
+void benchProgress(BenchRunner& runner)
+{
+    for (int threads = 1; threads <= 16; threads *= 4)
+    {
+        std::string suffix = ".t" + std::to_string(threads);
+        runner.run("progress.add" + suffix, NUM_ADDS, [threads]
+        {
+            CrawlProgress progress;
+            addFromThreads(progress, threads);
+            if (progress.snapshot().files != 8ull * NUM_ADDS)
+                throw std::runtime_error("progress.add: lost adds");
+        });
+        runner.run("progress.shared_atomic" + suffix, NUM_ADDS, [threads]
+        {
+            SharedCounters counters;
+            addFromThreads(counters, threads);
+            if (counters.files != 8ull * NUM_ADDS)
+                throw std::runtime_error("progress.shared_atomic: lost adds");
+        });
+    }
+
+    if (!runner.anyEnabled({ "progress.batched.off", "progress.batched.counters", "progress.batched.reporter",
+                             "progress.monitor.off", "progress.monitor.counters", "progress.monitor.reporter" }))
+        return;
+
+    SyntheticTree tree(runner.config().tree);
+    std::string root = tree.root().string();
+    FixedThreadPool pool(4);
+
+    benchProgressCrawl(runner, "batched", tree.files(), [&](CrawlProgress* progress)
+    {
+        CrawlHooks hooks;
+        hooks.progress = progress;
+        return listAllFiles(root, 8, CancellationToken(), pool, hooks).size();
+    });
+
+    benchProgressCrawl(runner, "monitor", tree.files(), [&](CrawlProgress* progress)
+    {
+        CrawlHooks hooks;
+        hooks.progress = progress;
+        return listAllFilesShared(root, 16, CancellationToken(), pool, hooks).files.size();
+    });
+}
@@ -0,0 +1,118 @@
+#include "suites.h"
+
+#include <thread>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include "message_queue.h"
+#include "spsc_channel.h"
+
+constexpr int NUM_PRODUCERS = 10;   // the same number of servers as in concurency7
+constexpr int NUM_MESSAGES = 10000; // per producer
+
+void benchQueue(BenchRunner& runner)
+{
+    // concurency7: many dir servers send file names to one print server
+    runner.run("queue.message_queue.mpsc", NUM_PRODUCERS * NUM_MESSAGES, []
+    {
+        MessageQueue<std::string> fileQueue;
+
+        std::vector<std::thread> producers;
+        for (int p = 0; p < NUM_PRODUCERS; ++p)
+        {
+            producers.push_back(std::thread([&fileQueue]
+            {
+                for (int i = 0; i < NUM_MESSAGES; ++i)
+                    fileQueue.send(std::string("f") + std::to_string(i) + ".dat");
+            }));
+        }
+
+        for (int i = 0; i < NUM_PRODUCERS * NUM_MESSAGES; ++i)
+            fileQueue.recieve();
+
+        for (std::thread& th : producers)
+            th.join();
+    });
+
+    // the same traffic as above, every producer has its own lane (concurency13)
+    runner.run("queue.spsc_lanes.mpsc", NUM_PRODUCERS * NUM_MESSAGES, []
+    {
+        SpscLanes<std::string> lanes(NUM_PRODUCERS);
+
+        std::vector<std::thread> producers;
+        for (int p = 0; p < NUM_PRODUCERS; ++p)
+        {
+            SpscChannel<std::string>& lane = lanes.lane(p);
+            producers.push_back(std::thread([&lane]
+            {
+                for (int i = 0; i < NUM_MESSAGES; ++i)
+                    lane.send(std::string("f") + std::to_string(i) + ".dat");
+                lane.close();
+            }));
+        }
+
+        std::string name;
+        int received = 0;
+        while (lanes.receive(name))
+            ++received;
+        if (received != NUM_PRODUCERS * NUM_MESSAGES)
+            throw std::runtime_error("queue.spsc_lanes.mpsc: lost messages");
+
+        for (std::thread& th : producers)
+            th.join();
+    });
+
+    // one producer, one consumer: the shared queue against a single lane
+    runner.run("queue.message_queue.spsc", NUM_MESSAGES * 10, []
+    {
+        MessageQueue<int> queue;
+        std::thread producer([&queue]
+        {
+            for (int i = 0; i < NUM_MESSAGES * 10; ++i)
+                queue.send(int(i));
+        });
+        for (int i = 0; i < NUM_MESSAGES * 10; ++i)
+            queue.recieve();
+        producer.join();
+    });
+
+    runner.run("queue.spsc_channel.spsc", NUM_MESSAGES * 10, []
+    {
+        SpscChannel<int> channel;
+        std::thread producer([&channel]
+        {
+            for (int i = 0; i < NUM_MESSAGES * 10; ++i)
+                channel.send(int(i));
+            channel.close();
+        });
+        int value;
+        for (int i = 0; i < NUM_MESSAGES * 10;)
+        {
+            if (channel.try_receive(value))
+                ++i;
+            else
+                std::this_thread::yield();
+        }
+        producer.join();
+    });
+
+    // round trip between two servers - measures the wakeup through the condition_variable
+    runner.run("queue.message_queue.pingpong", NUM_MESSAGES, []
+    {
+        MessageQueue<int> ping;
+        MessageQueue<int> pong;
+
+        std::thread server([&ping, &pong]
+        {
+            for (int i = 0; i < NUM_MESSAGES; ++i)
+                pong.send(ping.recieve() + 1);
+        });
+
+        for (int i = 0; i < NUM_MESSAGES; ++i)
+        {
+            ping.send(int(i));
+            pong.recieve();
+        }
+        server.join();
+    });
+}
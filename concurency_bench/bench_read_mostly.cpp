@@ -0,0 +1,173 @@
+#include "suites.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "monitor_result.h"
+#include "read_mostly.h"
+
+/*
+ * Reads of status data while a writer keeps changing it (include/read_mostly.h).
+ *
+ *  read_mostly.<lock>.tN - N readers read a three-counter snapshot NUM_READS times in total,
+ *                          one writer updates it and yields, again and again until they are done
+ *      mutex       - std::mutex around the struct, how MonitorResult::isDirsEmpty read before
+ *      seqlock     - SeqLock<Snapshot>
+ *      shared_read - SharedReadMutex, the readers in per-core counters
+ *  read_mostly.monitor.is_dirs_empty.tN - MonitorResult itself, a writer doing putDir / getDirs
+ *
+ * writes = how many updates the writer got done meanwhile - a reader lock which starves the
+ * writer would look good on the reads alone.
+ */
+
+constexpr long NUM_READS = 2000000;   // per rep, split between the readers
+
+struct Snapshot
+{
+    long a;
+    long b;
+    long sum;   // a + b - a torn read shows up as a wrong sum
+};
+
+class MutexSnapshot
+{
+    Snapshot _value;
+    std::mutex _mutex;
+
+public:
+    MutexSnapshot() : _value() {}
+
+    Snapshot read()
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _value;
+    }
+
+    void write(const Snapshot& s)
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        _value = s;
+    }
+};
+
+class SeqLockSnapshot
+{
+    SeqLock<Snapshot> _value;
+
+public:
+    Snapshot read() { return _value.read(); }
+    void write(const Snapshot& s) { _value.write(s); }
+};
+
+class SharedReadSnapshot
+{
+    Snapshot _value;
+    SharedReadMutex _mutex;
+
+public:
+    SharedReadSnapshot() : _value() {}
+
+    Snapshot read()
+    {
+        SharedReadGuard g(_mutex);
+        return _value;
+    }
+
+    void write(const Snapshot& s)
+    {
+        std::lock_guard<SharedReadMutex> lck(_mutex);
+        _value = s;
+    }
+};
+
+/// readers(i) runs in reader thread i, write(n) is called by the writer until the readers are done.
+template<typename Read, typename Write>
+static long readWhileWriting(int readers, Read read, Write write)
+{
+    std::atomic<int> running(readers);
+    long writes = 0;
+    std::thread writer([&]
+    {
+        // rarely written: the writer gives the CPU away after every update
+        while (running.load(std::memory_order_relaxed) > 0)
+        {
+            write(++writes);
+            std::this_thread::yield();
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t)
+    {
+        threads.push_back(std::thread([&, t]
+        {
+            for (long i = t; i < NUM_READS; i += readers)
+                read();
+            --running;
+        }));
+    }
+    for (std::thread& th : threads)
+        th.join();
+    writer.join();
+    return writes;
+}
+
+template<typename Holder>
+static void benchSnapshot(BenchRunner& runner, const std::string& name, int readers)
+{
+    long writes = 0;
+    BenchResult* r = runner.run("read_mostly." + name + ".t" + std::to_string(readers), NUM_READS, [&]
+    {
+        Holder holder;
+        std::atomic<bool> torn(false);
+        writes = readWhileWriting(readers, [&]
+        {
+            Snapshot s = holder.read();
+            if (s.a + s.b != s.sum)
+                torn = true;
+        },
+        [&](long n)
+        {
+            Snapshot s = { n, 2 * n, 3 * n };
+            holder.write(s);
+        });
+        if (torn)
+            throw std::runtime_error("read_mostly." + name + ": torn read");
+    });
+    if (r)
+        r->metrics["writes"] = static_cast<double>(writes);
+}
+
+void benchReadMostly(BenchRunner& runner)
+{
+    for (int readers = 1; readers <= 16; readers *= 4)
+    {
+        benchSnapshot<MutexSnapshot>(runner, "mutex", readers);
+        benchSnapshot<SeqLockSnapshot>(runner, "seqlock", readers);
+        benchSnapshot<SharedReadSnapshot>(runner, "shared_read", readers);
+
+        long writes = 0;
+        BenchResult* r = runner.run("read_mostly.monitor.is_dirs_empty.t" + std::to_string(readers), NUM_READS, [&]
+        {
+            MonitorResult result;
+            result.putDir(fs::path("/"));
+            std::atomic<long> empty(0);
+            writes = readWhileWriting(readers, [&]
+            {
+                if (result.isDirsEmpty())
+                    ++empty;
+            },
+            [&](long)
+            {
+                result.putDir(fs::path("/tmp"));
+                result.getDirs(1);
+            });
+            if (empty != 0)
+                throw std::runtime_error("read_mostly.monitor: saw an empty queue");
+        });
+        if (r)
+            r->metrics["writes"] = static_cast<double>(writes);
+    }
+}
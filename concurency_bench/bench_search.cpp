@@ -0,0 +1,152 @@
+#include "suites.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "content_search.h"
+#include "filesystem.h"
+#include "synthetic_tree.h"
+
+/*
+ * The content search of concurency7 on a generated text tree with a known number of matches.
+ *
+ * SEARCH_FILES text files in SEARCH_DIRS directories, 4 KB .. 384 KB (both sides of the mmap
+ * threshold). About one line in 400 contains the needle. SEARCH_BINARY files have the needle
+ * too, but also zero bytes - they must be skipped.
+ */
+
+constexpr int SEARCH_FILES = 128;
+constexpr int SEARCH_BINARY = 8;
+constexpr int SEARCH_DIRS = 16;
+static const char* const SEARCH_NEEDLE = "concurency_needle";
+
+class TextTree
+{
+    SyntheticTree _tree;        // the temp dir, our files go into it
+    std::size_t _matches;
+    std::uint64_t _textBytes;
+
+public:
+    explicit TextTree(unsigned seed) : _tree(rootOnly(seed)), _matches(0), _textBytes(0)
+    {
+        static const char* const words[] = { "thread", "future", "mutex", "queue", "server", "directory",
+                                             "promise", "lock", "condition", "variable", "atomic", "crawl" };
+        const std::size_t sizes[] = { 4096, 16384, 131072, 393216 };
+        unsigned state = seed ? seed : 1;
+
+        for (int i = 0; i < SEARCH_FILES + SEARCH_BINARY; ++i)
+        {
+            bool binary = i >= SEARCH_FILES;
+            std::size_t size = binary ? 65536 : sizes[i % 4];
+            std::string text;
+            text.reserve(size + 128);
+            while (text.size() < size)
+            {
+                std::string line;
+                int n = 4 + nextRandom(state) % 8;
+                bool needle = nextRandom(state) % 400 == 0;
+                int at = needle ? static_cast<int>(nextRandom(state) % n) : -1;
+                for (int w = 0; w < n; ++w)
+                {
+                    if (w)
+                        line += ' ';
+                    line += w == at ? SEARCH_NEEDLE : words[nextRandom(state) % 12];
+                }
+                if (binary)
+                    line += '\0';
+                else if (needle)
+                    ++_matches;
+                text += line;
+                text += '\n';
+            }
+
+            fs::path dir = _tree.root() / ("d" + std::to_string(i % SEARCH_DIRS));
+            fs::create_directories(dir);
+            std::ofstream out((dir / ("f" + std::to_string(i) + (binary ? ".bin" : ".txt"))).string(),
+                              std::ios::binary);
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+            if (!binary)
+                _textBytes += text.size();
+        }
+    }
+
+    std::string root() const { return _tree.root().string(); }
+    std::size_t matches() const { return _matches; }
+    std::uint64_t textBytes() const { return _textBytes; }
+};
+
+/// The baseline: one thread walks the tree and scans the files one after another.
+static std::size_t searchSerial(const std::string& root, const LineMatcher& matcher, std::uint64_t& bytes)
+{
+    std::vector<char> buffer;
+    std::vector<LineMatch> lines;
+    for (fs::recursive_directory_iterator it(root), end; it != end; ++it)
+    {
+        if (!fs::is_regular_file(it->symlink_status()))
+            continue;
+        bool binary;
+        searchFile(it->path().string(), matcher, SearchOptions().mmapThreshold, buffer, lines, bytes, binary);
+    }
+    return lines.size();
+}
+
+void benchSearch(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "search.single_thread", "search.workers.t1", "search.workers.t2", "search.workers.t4",
+                             "search.workers.t8", "search.regex.t4" }))
+        return;
+
+    TextTree tree(runner.config().tree.seed);
+    std::string root = tree.root();
+    const double MB = 1024.0 * 1024.0;
+
+    LineMatcher matcher(SEARCH_NEEDLE);
+    std::uint64_t bytes = 0;
+    BenchResult* r = runner.run("search.single_thread", SEARCH_FILES, [&]
+    {
+        bytes = 0;
+        if (searchSerial(root, matcher, bytes) != tree.matches())
+            throw std::runtime_error("search.single_thread: wrong number of matches");
+    });
+    double serialMBps = r ? bytes / MB / (r->p50 * 1e-6) : 0.0;
+    if (r)
+        r->metrics["mb_per_s"] = serialMBps;
+
+    for (int workers : { 1, 2, 4, 8 })
+    {
+        std::string name = "search.workers.t" + std::to_string(workers);
+        SearchOptions opt;
+        opt.pattern = SEARCH_NEEDLE;
+        opt.dirThreads = 2;
+        opt.searchThreads = workers;
+        SearchReport report;
+        r = runner.run(name, SEARCH_FILES, [&]
+        {
+            report = searchTree(root, opt);
+            if (report.matches() != tree.matches() || report.binarySkipped != SEARCH_BINARY)
+                throw std::runtime_error(name + ": wrong number of matches");
+        });
+        if (r)
+        {
+            double mbps = report.bytesScanned / MB / (r->p50 * 1e-6);
+            r->metrics["mb_per_s"] = mbps;
+            if (serialMBps > 0)
+                r->metrics["speedup_vs_single"] = mbps / serialMBps;
+        }
+    }
+
+    // std::regex tries every line - the cost of the pattern language
+    SearchOptions opt;
+    opt.pattern = "conc[a-z]+_needle";
+    opt.regex = true;
+    SearchReport report;
+    r = runner.run("search.regex.t4", SEARCH_FILES, [&]
+    {
+        report = searchTree(root, opt);
+        if (report.matches() != tree.matches())
+            throw std::runtime_error("search.regex.t4: wrong number of matches");
+    });
+    if (r)
+        r->metrics["mb_per_s"] = report.bytesScanned / MB / (r->p50 * 1e-6);
+}
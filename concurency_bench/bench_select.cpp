@@ -0,0 +1,129 @@
+#include "suites.h"
+
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "message_queue.h"
+#include "select.h"
+
+/*
+ * An idle server farm: every server waits for work on its own queue and for a stop
+ * on the shared control queue. How much CPU does waiting cost, and how fast does
+ * a server wake up when a job comes?
+ *
+ *  select       - one wakeup for both queues (include/select.h)
+ *  receive_for  - waits on the work queue, looks at the control queue every 10 ms
+ *  poll_yield   - try_receive both queues in a loop, yield in between
+ *  poll_sleep   - try_receive both queues, sleep 1 ms in between
+ */
+
+constexpr int FARM_SERVERS = 8;
+
+typedef std::chrono::steady_clock Clock;
+
+static long long nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+enum class WaitMode { Select, ReceiveFor, PollYield, PollSleep };
+
+struct Farm
+{
+    MessageQueue<int> control;
+    std::vector<std::unique_ptr<MessageQueue<long long>>> work;   // send time of a job
+    MessageQueue<long long> replies;                             // wakeup latency of a job
+    std::vector<std::thread> servers;
+
+    explicit Farm(WaitMode mode)
+    {
+        for (int i = 0; i < FARM_SERVERS; ++i)
+            work.emplace_back(new MessageQueue<long long>);
+        for (int i = 0; i < FARM_SERVERS; ++i)
+            servers.push_back(std::thread(&Farm::serve, this, mode, std::ref(*work[i])));
+    }
+
+    ~Farm()
+    {
+        // every server takes one stop message
+        for (int i = 0; i < FARM_SERVERS; ++i)
+            control.send(0);
+        for (std::thread& t : servers)
+            t.join();
+    }
+
+    void serve(WaitMode mode, MessageQueue<long long>& jobs)
+    {
+        int cmd;
+        long long sent;
+        for (;;)
+        {
+            bool gotJob = false;
+            switch (mode)
+            {
+            case WaitMode::Select:
+                select({ &control, &jobs });
+                break;
+            case WaitMode::ReceiveFor:
+                gotJob = jobs.receive_for(sent, std::chrono::milliseconds(10));
+                break;
+            case WaitMode::PollYield:
+                std::this_thread::yield();
+                break;
+            case WaitMode::PollSleep:
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                break;
+            }
+
+            if (control.try_receive(cmd))
+                return;
+            if (gotJob || jobs.try_receive(sent))
+                replies.send(nowNs() - sent);
+        }
+    }
+};
+
+/// process CPU time of all threads in ms
+static double cpuMs()
+{
+    return 1000.0 * std::clock() / CLOCKS_PER_SEC;
+}
+
+static void benchFarm(BenchRunner& runner, const std::string& name, WaitMode mode)
+{
+    if (!runner.enabled(name))
+        return;
+
+    Farm farm(mode);
+
+    // what the idle farm costs
+    const auto idle = std::chrono::milliseconds(200);
+    double cpuStart = cpuMs();
+    std::this_thread::sleep_for(idle);
+    double idleCpu = cpuMs() - cpuStart;
+
+    double latencyUs = 0;
+    int jobs = 0;
+    BenchResult* r = runner.run(name, 1, [&]
+    {
+        farm.work[jobs % FARM_SERVERS]->send(nowNs());
+        latencyUs += farm.replies.recieve() / 1000.0;
+        ++jobs;
+    });
+    if (r)
+    {
+        r->metrics["idle_cpu_pct"] = 100.0 * idleCpu / idle.count();
+        r->metrics["wakeup_latency_us"] = latencyUs / jobs;
+    }
+}
+
+void benchSelect(BenchRunner& runner)
+{
+    benchFarm(runner, "select.farm.select", WaitMode::Select);
+    benchFarm(runner, "select.farm.receive_for", WaitMode::ReceiveFor);
+    benchFarm(runner, "select.farm.poll_yield", WaitMode::PollYield);
+    benchFarm(runner, "select.farm.poll_sleep", WaitMode::PollSleep);
+}
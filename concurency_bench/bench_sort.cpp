@@ -0,0 +1,196 @@
+#include "suites.h"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "batched_crawl.h"
+#include "executor.h"
+#include "monitor_crawl.h"
+#include "sorted_output.h"
+#include "synthetic_tree.h"
+
+/*
+ * Sorted crawl output: one std::sort of everything against sorted runs merged with loser trees
+ * (include/sorted_output.h).
+ *
+ * 2e6 paths like a crawl produces them, in random order. Every rep starts from a fresh copy (untimed).
+ *  sort.std_sort               - std::sort of the whole vector, what a caller would do after the crawl
+ *  sort.runs.workersN.merge    - N workers sort a quarter each and add() it, merge() on a 4-thread pool
+ *  sort.runs.per_dir.merge     - runs of 32 paths, what a run per directory of a crawl would give
+ *  sort.runs.workersN.for_each - the same runs, forEach() instead of merge()
+ *  sort.external.for_each      - memory budget of 1/8 of the paths: most runs go through the file
+ *      spilled                 - paths which were written to the spill file
+ *      peak_mem_kb             - most memory the runs held at once
+ *  sort.crawl.<crawl>          - listAllFiles / listAllFilesShared of the synthetic tree with
+ *                                CrawlHooks::sorted, then forEach()
+ *      runs                    - runs the crawl added: one per task slot and CRAWL_RUN_SIZE paths
+ *
+ * The result is checked with std::is_sorted in every case.
+ */
+
+constexpr std::size_t NUM_PATHS = 2000000;
+
+static std::vector<std::string> makePaths()
+{
+    std::vector<std::string> paths;
+    paths.reserve(NUM_PATHS);
+    for (std::size_t i = 0; i < NUM_PATHS; ++i)
+        paths.push_back("/home/user/project/d" + std::to_string(i / 32 % 1024) + "/d"
+                        + std::to_string(i / 32768) + "/f" + std::to_string(i) + ".dat");
+    std::mt19937 rng(42);
+    std::shuffle(paths.begin(), paths.end(), rng);
+    return paths;
+}
+
+/// Every worker adds its slice of the input in runs of runSize (0 - the whole slice at once).
+static void addRuns(SortedRuns& sorted, std::vector<std::string>& input, int workers, std::size_t runSize)
+{
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; ++w)
+    {
+        threads.push_back(std::thread([&, w]
+        {
+            std::size_t begin = input.size() * w / workers, end = input.size() * (w + 1) / workers;
+            std::size_t step = runSize ? runSize : end - begin;
+            for (std::size_t i = begin; i < end; i += step)
+            {
+                std::size_t last = std::min(end, i + step);
+                sorted.add(std::vector<std::string>(std::make_move_iterator(input.begin() + i),
+                                                    std::make_move_iterator(input.begin() + last)));
+            }
+        }));
+    }
+    for (std::thread& th : threads)
+        th.join();
+}
+
+static void checkSorted(const std::string& name, const std::vector<std::string>& out)
+{
+    if (out.size() != NUM_PATHS || !std::is_sorted(out.begin(), out.end()))
+        throw std::runtime_error(name + ": not sorted");
+}
+
+/// forEach into a counter and the order check - no second copy of the output
+static void checkForEach(const std::string& name, SortedRuns& sorted)
+{
+    std::size_t n = 0;
+    std::string last;
+    bool ordered = true;
+    sorted.forEach([&](const std::string& p)
+    {
+        if (p < last)
+            ordered = false;
+        last = p;
+        ++n;
+    });
+    if (n != NUM_PATHS || !ordered)
+        throw std::runtime_error(name + ": not sorted");
+}
+
+static void benchSortRuns(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "sort.std_sort", "sort.runs.workers1.merge", "sort.runs.workers1.for_each",
+                             "sort.runs.workers4.merge", "sort.runs.workers4.for_each", "sort.runs.per_dir.merge",
+                             "sort.external.for_each" }))
+        return;
+
+    const std::vector<std::string> paths = makePaths();
+    std::vector<std::string> input;
+    auto fresh = [&] { input = paths; };
+    FixedThreadPool pool(4);
+
+    runner.run("sort.std_sort", NUM_PATHS, fresh, [&]
+    {
+        std::sort(input.begin(), input.end());
+        checkSorted("sort.std_sort", input);
+    });
+
+    for (int workers = 1; workers <= 4; workers *= 4)
+    {
+        std::string name = "sort.runs.workers" + std::to_string(workers);
+        runner.run(name + ".merge", NUM_PATHS, fresh, [&]
+        {
+            SortedRuns sorted;
+            addRuns(sorted, input, workers, 0);
+            checkSorted(name + ".merge", sorted.merge(pool, 4));
+        });
+        runner.run(name + ".for_each", NUM_PATHS, fresh, [&]
+        {
+            SortedRuns sorted;
+            addRuns(sorted, input, workers, 0);
+            checkForEach(name + ".for_each", sorted);
+        });
+    }
+
+    runner.run("sort.runs.per_dir.merge", NUM_PATHS, fresh, [&]
+    {
+        SortedRuns sorted;
+        addRuns(sorted, input, 4, 32);
+        checkSorted("sort.runs.per_dir.merge", sorted.merge(pool, 4));
+    });
+
+    std::size_t spilled = 0, peak = 0;
+    BenchResult* r = runner.run("sort.external.for_each", NUM_PATHS, fresh, [&]
+    {
+        // ~80 bytes a path in memory, an eighth of them fits into the budget
+        SortedRuns sorted(NUM_PATHS / 8 * 80);
+        addRuns(sorted, input, 4, 65536);
+        checkForEach("sort.external.for_each", sorted);
+        spilled = sorted.spilled();
+        peak = sorted.peakMemoryBytes();
+    });
+    if (r)
+    {
+        r->metrics["spilled"] = double(spilled);
+        r->metrics["peak_mem_kb"] = double(peak) / 1024;
+    }
+
+}
+
+static void benchSortCrawl(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "sort.crawl.batched", "sort.crawl.monitor" }))
+        return;
+
+    SyntheticTree tree(runner.config().tree);
+    std::string root = tree.root().string();
+    FixedThreadPool pool(4);
+    for (const char* crawl : { "batched", "monitor" })
+    {
+        std::string name = std::string("sort.crawl.") + crawl;
+        std::size_t runs = 0;
+        BenchResult* r = runner.run(name, tree.files(), [&]
+        {
+            SortedRuns sorted;
+            CrawlHooks hooks;
+            hooks.sorted = &sorted;
+            if (name == "sort.crawl.batched")
+                listAllFiles(root, 8, CancellationToken(), pool, hooks);
+            else
+                listAllFilesShared(root, 16, CancellationToken(), pool, hooks);
+            runs = sorted.runs();
+            std::size_t n = 0;
+            std::string last;
+            sorted.forEach([&](const std::string& p)
+            {
+                if (p < last)
+                    throw std::runtime_error(name + ": not sorted");
+                last = p;
+                ++n;
+            });
+            if (n != tree.files())
+                throw std::runtime_error(name + ": files missing");
+        });
+        if (r)
+            r->metrics["runs"] = double(runs);
+    }
+}
+
+void benchSort(BenchRunner& runner)
+{
+    benchSortRuns(runner);
+    benchSortCrawl(runner);
+}
@@ -0,0 +1,127 @@
+#include "suites.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "batched_crawl.h"
+#include "crawl_stream.h"
+#include "list_directory.h"
+#include "process_stats.h"
+#include "synthetic_tree.h"
+
+/*
+ * Return everything vs. stream (include/crawl_stream.h).
+ *
+ * 1365 directories with 32 files each. The consumer only looks at the length of every path.
+ *  - first_entry_us  - median time from the start of the crawl to the first path in the consumer's hands
+ *  - peak_rss_kb     - VmHWM during the last rep above the RSS before it
+ *  - paths_held      - most paths in memory at once: all of them for the vector, the queue for the stream
+ */
+
+typedef std::chrono::steady_clock Clock;
+
+static double medianUs(std::vector<double> v)
+{
+    if (v.empty())
+        return 0.0;
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+template<typename F>
+static void benchStreamCase(BenchRunner& runner, const std::string& name, std::size_t files, F crawl)
+{
+    if (!runner.enabled(name))
+        return;
+
+    std::vector<double> firstEntryUs;
+    std::size_t held = 0;
+    long baseline = 0;
+    BenchResult* r = runner.run(name, files, [&]
+    {
+        resetPeakRss();
+        baseline = processStatus("VmRSS");
+    },
+    [&]
+    {
+        Clock::time_point start = Clock::now();
+        bool first = true;
+        std::size_t n = 0, bytes = 0;
+        // called with every piece of the result the consumer gets
+        auto consume = [&](const std::vector<std::string>& paths)
+        {
+            if (first && !paths.empty())
+            {
+                firstEntryUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+                first = false;
+            }
+            for (const std::string& p : paths)
+                bytes += p.size();
+            n += paths.size();
+        };
+        held = crawl(consume);
+        if (n != files || bytes == 0)
+            throw std::runtime_error(name + ": wrong number of files");
+    });
+    if (r)
+    {
+        r->metrics["first_entry_us"] = medianUs(firstEntryUs);
+        r->metrics["peak_rss_kb"] = static_cast<double>(processStatus("VmHWM") - baseline);
+        r->metrics["paths_held"] = static_cast<double>(held);
+    }
+}
+
+void benchStream(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "stream.return_all.list_all_files", "stream.pull.batches", "stream.pull.iterator",
+                             "stream.push" }))
+        return;
+
+    TreeShape shape;
+    shape.depth = 5;
+    shape.fanout = 4;
+    shape.filesPerDir = 32;
+    shape.fileBytes = 0;
+    shape.seed = runner.config().tree.seed;
+    SyntheticTree tree(shape);
+    std::string root = tree.root().string();
+    std::size_t files = tree.files();
+
+    benchStreamCase(runner, "stream.return_all.list_all_files", files, [&](std::function<void(const std::vector<std::string>&)> consume)
+    {
+        std::string dir = root;
+        std::vector<std::string> all = listAllFiles(dir);
+        consume(all);
+        return all.size();
+    });
+
+    benchStreamCase(runner, "stream.pull.batches", files, [&](std::function<void(const std::vector<std::string>&)> consume)
+    {
+        CrawlStream stream(root);
+        std::vector<std::string> batch;
+        while (stream.next(batch))
+            consume(batch);
+        return stream.peakBuffered();
+    });
+
+    benchStreamCase(runner, "stream.pull.iterator", files, [&](std::function<void(const std::vector<std::string>&)> consume)
+    {
+        CrawlStream stream(root);
+        std::vector<std::string> one(1);
+        for (const std::string& p : stream)
+        {
+            one[0] = p;
+            consume(one);
+        }
+        return stream.peakBuffered();
+    });
+
+    benchStreamCase(runner, "stream.push", files, [&](std::function<void(const std::vector<std::string>&)> consume)
+    {
+        crawlEach(root, [&](std::vector<std::string>& batch) { consume(batch); });
+        return StreamOptions().maxBatches * StreamOptions().batchSize;   // the bound, crawlEach keeps no stats
+    });
+}
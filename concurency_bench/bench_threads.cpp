@@ -0,0 +1,107 @@
+#include "suites.h"
+
+#include <thread>
+#include <future>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <stdexcept>
+#include "scoped_thread.h"
+
+constexpr int NUM_THREADS = 10;     // the same number of workers as in concurency1
+constexpr int NUM_HANDOFFS = 100;   // a single handoff is too short to be timed
+
+void benchThreads(BenchRunner& runner)
+{
+    // concurency1: vector of std::thread joined at the end
+    runner.run("thread.spawn_join.std_thread", NUM_THREADS, []
+    {
+        std::atomic<int> sink(0);
+        std::vector<std::thread> workers;
+        for (int i = 0; i < NUM_THREADS; ++i)
+            workers.push_back(std::thread([&sink, i] { sink += i; }));
+        for (std::thread& th : workers)
+            th.join();
+    });
+
+    // concurency8: the same with joining done by the scoped_thread destructor
+    runner.run("thread.spawn_join.scoped_thread", NUM_THREADS, []
+    {
+        std::atomic<int> sink(0);
+        std::vector<std::unique_ptr<scoped_thread>> workers;
+        for (int i = 0; i < NUM_THREADS; ++i)
+            workers.push_back(std::unique_ptr<scoped_thread>(new scoped_thread([&sink, i] { sink += i; })));
+    });
+}
+
+static int factorial(std::shared_future<int> f)
+{
+    int result = 1;
+    for (int i = f.get(); i > 1; --i)
+        result *= i;
+    return result;
+}
+
+void benchFutures(BenchRunner& runner)
+{
+    // concurency3 example1: promise moved to the thread, value taken from the future
+    runner.run("future.promise_handoff", NUM_HANDOFFS, []
+    {
+        for (int i = 0; i < NUM_HANDOFFS; ++i)
+        {
+            std::promise<std::string> prms;
+            std::future<std::string> ftr = prms.get_future();
+            std::thread th([](std::promise<std::string>&& p) { p.set_value("Hello from future move!"); },
+                           std::move(prms));
+            std::string str = ftr.get();
+            th.join();
+        }
+    });
+
+    // concurency3 example4: the same with the promise hidden by async
+    runner.run("future.async_get", NUM_HANDOFFS, []
+    {
+        for (int i = 0; i < NUM_HANDOFFS; ++i)
+        {
+            auto ftr = std::async(std::launch::async, [] { return std::string("Hello from Async!"); });
+            std::string str = ftr.get();
+        }
+    });
+
+    // concurency11: broken promise, the exception travels through the shared state
+    runner.run("future.broken_promise", NUM_HANDOFFS, []
+    {
+        for (int i = 0; i < NUM_HANDOFFS; ++i)
+        {
+            std::promise<int> p;
+            std::future<int> f = p.get_future();
+            std::future<int> fu = std::async(std::launch::async, [](std::future<int>& in)
+            {
+                return in.get();
+            }, std::ref(f));
+            p.set_exception(std::make_exception_ptr(std::runtime_error("Error from promise")));
+            try
+            {
+                fu.get();
+            }
+            catch (std::runtime_error&)
+            {
+            }
+        }
+    });
+
+    // concurency12: one value broadcast to four tasks through shared_future
+    runner.run("future.shared_future_broadcast", 4, []
+    {
+        std::promise<int> p;
+        std::shared_future<int> sf = p.get_future().share();
+
+        std::future<int> f1 = std::async(std::launch::async, factorial, sf);
+        std::future<int> f2 = std::async(std::launch::async, factorial, sf);
+        std::future<int> f3 = std::async(std::launch::async, factorial, sf);
+        std::future<int> f4 = std::async(std::launch::async, factorial, sf);
+
+        p.set_value(4);
+        f1.get(); f2.get(); f3.get(); f4.get();
+    });
+}
@@ -0,0 +1,38 @@
+#include "suites.h"
+
+#include "trace.h"
+
+constexpr int NUM_SCOPES = 1000000;
+
+//keeps the compiler from removing the loop body
+static volatile int sink = 0;
+
+void benchTrace(BenchRunner& runner)
+{
+    runner.run("trace.scope.baseline", NUM_SCOPES, []
+    {
+        for (int i = 0; i < NUM_SCOPES; ++i)
+            sink = i;
+    });
+
+    // tracing compiled in but not enabled - this is what every TRACE_SCOPE costs normally
+    runner.run("trace.scope.disabled", NUM_SCOPES, []
+    {
+        for (int i = 0; i < NUM_SCOPES; ++i)
+        {
+            TRACE_SCOPE("bench", "scope");
+            sink = i;
+        }
+    });
+
+    runner.run("trace.scope.enabled", NUM_SCOPES, [] { Tracer::enable(); }, []
+    {
+        for (int i = 0; i < NUM_SCOPES; ++i)
+        {
+            TRACE_SCOPE("bench", "scope");
+            sink = i;
+        }
+    });
+    Tracer::disable();
+    Tracer::clear();
+}
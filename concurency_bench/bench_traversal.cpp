@@ -0,0 +1,69 @@
+#include "suites.h"
+
+#include <stdexcept>
+#include <string>
+#include "synthetic_tree.h"
+#include "batched_crawl.h"
+#include "frontier.h"
+
+/*
+ * concurency5 crawl with the three frontier policies (include/frontier.h)
+ * on a wide and shallow tree and on a narrow and deep one.
+ * Reported: throughput, the peak frontier size, its peak memory and how much was spilled
+ * when the in-memory part is limited to SPILL_LIMIT paths.
+ */
+
+constexpr std::size_t SPILL_LIMIT = 256;
+
+static void benchPolicy(BenchRunner& runner, const std::string& name, const SyntheticTree& tree,
+                        TraversalPolicy policy, std::size_t maxInMemory)
+{
+    std::string root = tree.root().string();
+    std::size_t peak = 0, peakBytes = 0, spilled = 0;
+
+    BenchResult* r = runner.run(name, tree.files(), [&]
+    {
+        DirFrontier frontier(policy, maxInMemory);
+        if (listAllFiles(root, frontier).size() != tree.files())
+            throw std::runtime_error(name + ": wrong number of files");
+        peak = frontier.peakSize();
+        peakBytes = frontier.peakMemoryBytes();
+        spilled = frontier.spilled();
+    });
+    if (r)
+    {
+        r->metrics["peak_frontier"] = peak;
+        r->metrics["peak_frontier_bytes"] = peakBytes;
+        r->metrics["spilled"] = spilled;
+        r->metrics["dirs"] = tree.dirs();
+    }
+}
+
+static void benchTree(BenchRunner& runner, const std::string& prefix, const TreeShape& shape)
+{
+    if (!runner.anyEnabled({ prefix + "dfs", prefix + "bfs", prefix + "hybrid", prefix + "bfs_spill",
+                             prefix + "hybrid_spill" }))
+        return;
+
+    SyntheticTree tree(shape);
+    benchPolicy(runner, prefix + "dfs", tree, TraversalPolicy::DepthFirst, DirFrontier::UNLIMITED);
+    benchPolicy(runner, prefix + "bfs", tree, TraversalPolicy::BreadthFirst, DirFrontier::UNLIMITED);
+    benchPolicy(runner, prefix + "hybrid", tree, TraversalPolicy::Hybrid, DirFrontier::UNLIMITED);
+    benchPolicy(runner, prefix + "bfs_spill", tree, TraversalPolicy::BreadthFirst, SPILL_LIMIT);
+    benchPolicy(runner, prefix + "hybrid_spill", tree, TraversalPolicy::Hybrid, SPILL_LIMIT);
+}
+
+void benchTraversal(BenchRunner& runner)
+{
+    TreeShape wide = runner.config().tree;
+    wide.depth = 2;
+    wide.fanout = 48;
+    wide.filesPerDir = 2;
+    benchTree(runner, "traversal.wide.", wide);
+
+    TreeShape deep = runner.config().tree;
+    deep.depth = 10;
+    deep.fanout = 2;
+    deep.filesPerDir = 2;
+    benchTree(runner, "traversal.deep.", deep);
+}
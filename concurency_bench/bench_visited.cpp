@@ -0,0 +1,162 @@
+#include "suites.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "batched_crawl.h"
+#include "crawl_errors.h"
+#include "executor.h"
+#include "synthetic_tree.h"
+#include "visited_set.h"
+#include "walk_policy.h"
+
+/*
+ * The cost of following symlinks (include/walk_policy.h, include/visited_set.h).
+ *
+ *  visited.insert.<set>.tN - N threads insert 1e7 distinct (dev, inode) keys, split between them,
+ *                            the set is made fresh (untimed) for every rep
+ *      sharded             - VisitedSet, open addressing with a CAS per insert
+ *      unordered_set_mutex - std::unordered_set of the pairs under one std::mutex
+ *      bytes_per_entry     - the tables (VisitedSet::memoryBytes), the buckets and the nodes
+ *                            (estimated) of the unordered_set, divided by 1e7
+ *
+ *  visited.crawl.<walk> - listAllFiles of the synthetic tree where every directory below the root
+ *                         has a link to its parent ("up" -> "..") and every one a link to its first
+ *                         subdirectory ("alias" -> d0)
+ *      physical         - the links are files
+ *      follow           - the links are followed and every directory is listed once - checked:
+ *                         the crawl must find exactly the files of the tree
+ *      seen_again       - directories met again through a link and not listed
+ */
+
+constexpr std::size_t NUM_KEYS = 10000000;
+
+class UnorderedVisited
+{
+    struct Hash
+    {
+        std::size_t operator()(const std::pair<std::uint64_t, std::uint64_t>& k) const
+        {
+            return std::hash<std::uint64_t>()(k.second ^ (k.first * 0x9e3779b97f4a7c15ull));
+        }
+    };
+    std::unordered_set<std::pair<std::uint64_t, std::uint64_t>, Hash> _set;
+    std::mutex _mutex;
+
+public:
+    explicit UnorderedVisited(std::size_t expected) { _set.reserve(expected); }
+
+    bool insert(std::uint64_t dev, std::uint64_t ino)
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _set.insert(std::make_pair(dev, ino)).second;
+    }
+
+    std::size_t size() const { return _set.size(); }
+
+    std::size_t memoryBytes() const
+    {
+        // a bucket is a pointer, a node the next pointer, the key and the cached hash
+        return _set.bucket_count() * sizeof(void*)
+             + _set.size() * (sizeof(void*) + 2 * sizeof(std::uint64_t) + sizeof(std::size_t));
+    }
+};
+
+template<typename Set>
+static void benchInsert(BenchRunner& runner, const std::string& name)
+{
+    for (int threads = 1; threads <= 4; threads *= 4)
+    {
+        std::string full = "visited.insert." + name + ".t" + std::to_string(threads);
+        if (!runner.enabled(full))
+            continue;
+
+        std::unique_ptr<Set> set;
+        BenchResult* r = runner.run(full, NUM_KEYS, [&]
+        {
+            set.reset();
+            set.reset(new Set(NUM_KEYS));
+        },
+        [&]
+        {
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; ++t)
+            {
+                workers.push_back(std::thread([&, t]
+                {
+                    for (std::size_t i = t; i < NUM_KEYS; i += threads)
+                        set->insert(2049, i * 7 + 11);   // one device, inodes spread like on a disk
+                }));
+            }
+            for (std::thread& th : workers)
+                th.join();
+            if (set->size() != NUM_KEYS)
+                throw std::runtime_error(full + ": lost inserts");
+        });
+        if (r)
+            r->metrics["bytes_per_entry"] = double(set->memoryBytes()) / NUM_KEYS;
+    }
+}
+
+static void addLinks(const fs::path& root)
+{
+    std::vector<fs::path> dirs;
+    dirs.push_back(root);
+    for (fs::recursive_directory_iterator it(root), end; it != end; ++it)
+        if (fs::is_directory(it->symlink_status()))
+            dirs.push_back(it->path());
+    for (const fs::path& d : dirs)
+    {
+        if (d != root)  // the root's parent is outside the tree
+            fs::create_symlink("..", d / "up");
+        if (fs::exists(d / "d0"))
+            fs::create_symlink("d0", d / "alias");
+    }
+}
+
+void benchVisited(BenchRunner& runner)
+{
+    benchInsert<VisitedSet>(runner, "sharded");
+    benchInsert<UnorderedVisited>(runner, "unordered_set_mutex");
+
+    if (!runner.anyEnabled({ "visited.crawl.physical", "visited.crawl.follow" }))
+        return;
+
+    TreeShape shape = runner.config().tree;
+    shape.fileBytes = 0;
+    SyntheticTree tree(shape);
+    addLinks(tree.root());
+    FixedThreadPool pool(4);
+
+    for (bool follow : { false, true })
+    {
+        std::string name = std::string("visited.crawl.") + (follow ? "follow" : "physical");
+        std::size_t seenAgain = 0;
+        BenchResult* r = runner.run(name, tree.files(), [&]
+        {
+            std::string root = tree.root().string();
+            WalkOptions opt;
+            opt.followSymlinks = follow;
+            WalkPolicy walk(root, opt);
+            ErrorTable errors;
+            CrawlHooks hooks;
+            hooks.errors = &errors;
+            hooks.walk = &walk;
+            std::size_t files = listAllFiles(root, 8, CancellationToken(), pool, hooks).size();
+            if (follow && files != tree.files())
+                throw std::runtime_error(name + ": " + std::to_string(files) + " files, the tree has "
+                                         + std::to_string(tree.files()));
+            if (errors.total() != 0)
+                throw std::runtime_error(name + ": errors in the crawl");
+            seenAgain = walk.seenAgain();
+        });
+        if (r)
+            r->metrics["seen_again"] = double(seenAgain);
+    }
+}
@@ -0,0 +1,199 @@
+#include "suites.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <time.h>
+#include <vector>
+#include "synthetic_tree.h"
+#include "tree_watcher.h"
+
+/*
+ * Watch mode instead of periodic rescans.
+ *
+ *  - watch.initial_crawl    - crawl + a watch per directory, what a rescan would cost every time
+ *  - watch.latency.*        - from the syscall which changes the tree to the index showing it
+ *  - watch.idle             - CPU of the whole process while nothing changes (steady state)
+ *  - watch.churn            - create + delete a batch of files, event thread CPU per event
+ *  - watch.overflow         - the event thread suspended until the kernel queue overflows,
+ *                             then the full rescan which follows
+ */
+
+static double processCpuMs()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void touch(const fs::path& p)
+{
+    std::ofstream f(p.string());
+}
+
+static void waitIndex(TreeWatcher& watcher, const std::string& what, std::function<bool(const TreeWatcher::Index&)> pred)
+{
+    if (!watcher.waitFor(pred, std::chrono::milliseconds(10000)))
+        throw std::runtime_error(what + ": the index didn't catch up");
+}
+
+void benchWatch(BenchRunner& runner)
+{
+    if (!runner.anyEnabled({ "watch.initial_crawl", "watch.latency.create", "watch.latency.delete",
+                             "watch.latency.rename_dir", "watch.idle", "watch.churn", "watch.overflow" }))
+        return;
+
+    SyntheticTree tree(runner.config().tree);
+    std::string root = tree.root().string();
+    std::size_t entries = tree.files() + tree.dirs() - 1;
+
+    runner.run("watch.initial_crawl", entries, [&]
+    {
+        TreeWatcher watcher(root);
+        if (watcher.size() != entries)
+            throw std::runtime_error("watch.initial_crawl: wrong number of entries");
+    });
+
+    TreeWatcher watcher(root);
+    fs::path scratch = tree.root() / "watch";
+    fs::create_directories(scratch);
+    waitIndex(watcher, "watch", [&](const TreeWatcher::Index& ix) { return ix.count(scratch.string()) != 0; });
+
+    int serial = 0;
+    runner.run("watch.latency.create", 1, [&]
+    {
+        fs::path p = scratch / ("c" + std::to_string(serial++));
+        touch(p);
+        waitIndex(watcher, "watch.latency.create", [&](const TreeWatcher::Index& ix) { return ix.count(p.string()) != 0; });
+    });
+
+    fs::path victim;
+    runner.run("watch.latency.delete", 1, [&]
+    {
+        victim = scratch / ("d" + std::to_string(serial++));
+        touch(victim);
+        waitIndex(watcher, "watch.latency.delete", [&](const TreeWatcher::Index& ix) { return ix.count(victim.string()) != 0; });
+    },
+    [&]
+    {
+        fs::remove(victim);
+        waitIndex(watcher, "watch.latency.delete", [&](const TreeWatcher::Index& ix) { return ix.count(victim.string()) == 0; });
+    });
+
+    fs::path moved;
+    runner.run("watch.latency.rename_dir", 1, [&]
+    {
+        moved = scratch / ("r" + std::to_string(serial++));
+        fs::create_directories(moved / "inner");
+        touch(moved / "inner" / "f");
+        waitIndex(watcher, "watch.latency.rename_dir",
+                  [&](const TreeWatcher::Index& ix) { return ix.count((moved / "inner" / "f").string()) != 0; });
+    },
+    [&]
+    {
+        fs::path to = moved.string() + "_moved";
+        fs::rename(moved, to);
+        waitIndex(watcher, "watch.latency.rename_dir", [&](const TreeWatcher::Index& ix)
+        {
+            return ix.count((to / "inner" / "f").string()) != 0 && ix.count(moved.string()) == 0;
+        });
+    });
+
+    // nothing changes - the event thread sleeps in poll()
+    const int IDLE_MS = 50;
+    double cpuBefore = 0;
+    BenchResult* r = runner.run("watch.idle", 1, [&] { cpuBefore = processCpuMs(); }, [&]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_MS));
+    });
+    if (r)
+        r->metrics["process_cpu_pct"] = (processCpuMs() - cpuBefore) / IDLE_MS * 100.0;
+
+    const int CHURN = 1000;
+    fs::path churn = scratch / "churn";
+    fs::create_directories(churn);
+    std::uint64_t cpuStart = 0, eventsStart = 0;
+    double processCpuStart = 0;
+    int churnReps = 0;
+    r = runner.run("watch.churn", 2 * CHURN, [&]
+    {
+        if (!churnReps++)
+        {
+            WatchStats s = watcher.stats();
+            cpuStart = s.eventThreadCpuNs;
+            eventsStart = s.events;
+            processCpuStart = processCpuMs();
+        }
+    },
+    [&]
+    {
+        std::size_t before = watcher.size();
+        for (int i = 0; i < CHURN; ++i)
+            touch(churn / ("f" + std::to_string(i)));
+        for (int i = 0; i < CHURN; ++i)
+            fs::remove(churn / ("f" + std::to_string(i)));
+        fs::path marker = churn / "done";
+        touch(marker);
+        waitIndex(watcher, "watch.churn", [&](const TreeWatcher::Index& ix) { return ix.count(marker.string()) != 0; });
+        fs::remove(marker);
+        waitIndex(watcher, "watch.churn", [&](const TreeWatcher::Index& ix) { return ix.size() == before; });
+    });
+    if (r)
+    {
+        WatchStats s = watcher.stats();
+        double events = static_cast<double>(s.events - eventsStart);
+        double cpuMs = (s.eventThreadCpuNs - cpuStart) / 1e6;
+        r->metrics["event_thread_ns_per_event"] = events > 0 ? cpuMs * 1e6 / events : 0.0;
+        r->metrics["event_thread_cpu_share"] = cpuMs / (processCpuMs() - processCpuStart);
+    }
+
+    // more changes than fs.inotify.max_queued_events while the event thread doesn't read.
+    // The flood directory is created and in the index - watched - before suspend(), so its
+    // creates are events; every rep has to overflow the queue.
+    const int FLOOD = 20000;
+    int flood = 0;
+    std::uint64_t overflows = watcher.stats().overflows;
+    std::vector<double> perRep;
+    r = runner.run("watch.overflow", entries + FLOOD, [&]
+    {
+        fs::remove_all(scratch);
+        waitIndex(watcher, "watch.overflow", [&](const TreeWatcher::Index& ix) { return ix.size() == entries; });
+        fs::path dir = tree.root() / ("flood" + std::to_string(flood++));
+        fs::create_directories(dir);
+        waitIndex(watcher, "watch.overflow", [&](const TreeWatcher::Index& ix) { return ix.count(dir.string()) != 0; });
+        scratch = dir;
+        overflows = watcher.stats().overflows;
+
+        watcher.suspend();
+        for (int i = 0; i < FLOOD; ++i)
+            touch(dir / ("f" + std::to_string(i)));
+    },
+    [&]
+    {
+        watcher.resume();
+        std::size_t expected = entries + 1 + FLOOD;
+        std::string last = (scratch / ("f" + std::to_string(FLOOD - 1))).string();
+        waitIndex(watcher, "watch.overflow", [&](const TreeWatcher::Index& ix)
+        {
+            return ix.count(last) != 0 && ix.size() == expected;
+        });
+        std::uint64_t now = watcher.stats().overflows;
+        if (now == overflows)
+            throw std::runtime_error("watch.overflow: the kernel queue didn't overflow");
+        perRep.push_back(static_cast<double>(now - overflows));
+    });
+    if (r)
+    {
+        // the timed reps only - the warmup ones are in front
+        std::size_t reps = static_cast<std::size_t>(runner.config().reps);
+        double sum = 0;
+        for (std::size_t i = perRep.size() - std::min(reps, perRep.size()); i < perRep.size(); ++i)
+            sum += perRep[i];
+        r->metrics["overflows_per_rep"] = sum / std::min(reps, perRep.size());
+    }
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include "bench.h"
+#include "suites.h"
+
+/*
+ * Benchmarks of the concurrency primitives used in the examples.
+ *
+ * Instead of the ad-hoc timing loop from concurency5 every benchmark is
+ * run with warmup and repetitions, reported with percentiles and written
+ * as JSON (--json) so the numbers can be compared between commits.
+ * Directory crawls run on a synthetic tree generated in the temp dir.
+ *
+ * Example:
+ *   concurency_bench --filter crawl. --depth 5 --fanout 3 --reps 20
+ */
+
+static void usage(const char* prog)
+{
+    std::cout << "usage: " << prog << " [options]\n"
+              << "  --filter <str>     run only benchmarks which names contain <str>\n"
+              << "  --warmup <n>       untimed runs before measuring (default 2)\n"
+              << "  --reps <n>         timed runs (default 10)\n"
+              << "  --json <file>      machine readable output, '' to disable (default bench_output.json)\n"
+              << "  --depth <n>        synthetic tree: directory levels (default 4)\n"
+              << "  --fanout <n>       synthetic tree: subdirectories per directory (default 4)\n"
+              << "  --files <n>        synthetic tree: files per directory (default 8)\n"
+              << "  --file-bytes <n>   synthetic tree: average file size (default 64)\n"
+              << "  --seed <n>         synthetic tree: random seed (default 42)\n"
+              << "  --factorial-max <n> biggest n for the factorial.* benchmarks (default 100000)\n";
+}
+
+int main(int argc, char *argv[])
+{
+    BenchConfig cfg;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h")
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "missing value for " << arg << std::endl;
+            usage(argv[0]);
+            return 1;
+        }
+
+        std::string value(argv[++i]);
+        if (arg == "--filter")          cfg.filter = value;
+        else if (arg == "--warmup")     cfg.warmup = std::atoi(value.c_str());
+        else if (arg == "--reps")       cfg.reps = std::atoi(value.c_str());
+        else if (arg == "--json")       cfg.jsonPath = value;
+        else if (arg == "--depth")      cfg.tree.depth = std::atoi(value.c_str());
+        else if (arg == "--fanout")     cfg.tree.fanout = std::atoi(value.c_str());
+        else if (arg == "--files")      cfg.tree.filesPerDir = std::atoi(value.c_str());
+        else if (arg == "--file-bytes") cfg.tree.fileBytes = std::atoi(value.c_str());
+        else if (arg == "--seed")       cfg.tree.seed = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--factorial-max") cfg.factorialMax = std::strtoul(value.c_str(), nullptr, 10);
+        else
+        {
+            std::cerr << "unknown option " << arg << std::endl;
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    BenchRunner runner(cfg);
+
+    try
+    {
+        benchThreads(runner);
+        benchFutures(runner);
+        benchExecutors(runner);
+        benchCrawl(runner);
+        benchProgress(runner);
+        benchErrors(runner);
+        benchVisited(runner);
+        benchIndex(runner);
+        benchSort(runner);
+        benchGraph(runner);
+        benchTraversal(runner);
+        benchCoro(runner);
+        benchStream(runner);
+        benchDedup(runner);
+        benchSearch(runner);
+        benchWatch(runner);
+        benchQueue(runner);
+        benchLock(runner);
+        benchReadMostly(runner);
+        benchSelect(runner);
+        benchPriority(runner);
+        benchCollector(runner);
+        benchForkJoin(runner);
+        benchFactorial(runner);
+        benchCancel(runner);
+        benchLogger(runner);
+        benchTrace(runner);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << std::endl;
+    runner.printTable(std::cout);
+
+    if (!cfg.jsonPath.empty())
+    {
+        std::ofstream json(cfg.jsonPath);
+        runner.writeJson(json);
+        std::cout << "\nResults written to " << cfg.jsonPath << std::endl;
+    }
+
+    return 0;
+}
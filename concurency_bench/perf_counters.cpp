@@ -0,0 +1,72 @@
+#include "perf_counters.h"
+
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static int openCounter(std::uint32_t type, std::uint64_t config)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = 1;          // count the threads spawned by the benchmark too
+    // context switches happen in the kernel, hardware counters are about our code
+    attr.exclude_kernel = type == PERF_TYPE_HARDWARE ? 1 : 0;
+    attr.exclude_hv = 1;
+
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+PerfCounters::PerfCounters()
+{
+    struct { const char* name; std::uint32_t type; std::uint64_t config; } wanted[] =
+    {
+        { "cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { "context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+    };
+
+    for (auto& w : wanted)
+    {
+        int fd = openCounter(w.type, w.config);
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            _counters.push_back(Counter{ w.name, fd, 0 });
+        }
+    }
+}
+
+static std::uint64_t readCounter(int fd)
+{
+    std::uint64_t value = 0;
+    if (read(fd, &value, sizeof(value)) != sizeof(value))
+        return 0;
+    return value;
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (Counter& c : _counters)
+        close(c.fd);
+}
+
+void PerfCounters::start()
+{
+    // counts of inherited threads are added when they exit and RESET does not clear them,
+    // so we keep counting all the time and report the difference
+    for (Counter& c : _counters)
+        c.startValue = readCounter(c.fd);
+}
+
+std::map<std::string, double> PerfCounters::stop()
+{
+    std::map<std::string, double> values;
+    for (Counter& c : _counters)
+        values[c.name] = static_cast<double>(readCounter(c.fd) - c.startValue);
+    return values;
+}
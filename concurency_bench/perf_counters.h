@@ -0,0 +1,36 @@
+#ifndef CONCURENCY_BENCH_PERF_COUNTERS_H
+#define CONCURENCY_BENCH_PERF_COUNTERS_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/// Hardware / software counters of the calling thread and the threads it creates
+/// (perf_event_open with inherit). Counters which the kernel refuses to open
+/// (no PMU in a VM, perf_event_paranoid, ...) are silently left out.
+class PerfCounters
+{
+    struct Counter
+    {
+        std::string name;
+        int fd;
+        std::uint64_t startValue;
+    };
+    std::vector<Counter> _counters;
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return !_counters.empty(); }
+
+    void start();
+    /// Values since start(). Threads are counted only after they were joined.
+    std::map<std::string, double> stop();
+};
+
+#endif // CONCURENCY_BENCH_PERF_COUNTERS_H
@@ -0,0 +1,27 @@
+#ifndef CONCURENCY_BENCH_PROCESS_STATS_H
+#define CONCURENCY_BENCH_PROCESS_STATS_H
+
+#include <fstream>
+#include <string>
+
+/// A value of /proc/self/status - "VmRSS", "VmHWM" (kB), "Threads", ... 0 if not there.
+inline long processStatus(const char* key)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    std::string prefix = std::string(key) + ":";
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, prefix.size(), prefix) == 0)
+            return std::stol(line.substr(prefix.size()));
+    }
+    return 0;
+}
+
+/// Resets VmHWM to the current RSS, so it shows the peak from now on.
+inline void resetPeakRss()
+{
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+#endif // CONCURENCY_BENCH_PROCESS_STATS_H
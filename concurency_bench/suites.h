@@ -0,0 +1,37 @@
+#ifndef CONCURENCY_BENCH_SUITES_H
+#define CONCURENCY_BENCH_SUITES_H
+
+#include "bench.h"
+
+/// Every suite registers its benchmarks on the runner. Suites which need
+/// a directory tree generate their own SyntheticTree from config().tree.
+
+void benchThreads(BenchRunner& runner);     // concurency1, concurency8
+void benchFutures(BenchRunner& runner);     // concurency3, concurency11, concurency12
+void benchExecutors(BenchRunner& runner);   // include/executor.h
+void benchCrawl(BenchRunner& runner);       // concurency4, concurency5, concurency6
+void benchProgress(BenchRunner& runner);    // concurency5, concurency6 progress, include/crawl_progress.h
+void benchErrors(BenchRunner& runner);      // concurency5, 6, 7 error accounting, include/crawl_errors.h
+void benchVisited(BenchRunner& runner);     // include/walk_policy.h, include/visited_set.h
+void benchIndex(BenchRunner& runner);       // concurency5, concurency6 lookups, include/file_index.h
+void benchSort(BenchRunner& runner);        // concurency6, concurency7 sorted output, include/sorted_output.h
+void benchGraph(BenchRunner& runner);       // concurency2, include/sin_graph.h
+void benchTraversal(BenchRunner& runner);   // concurency5, include/frontier.h
+void benchCoro(BenchRunner& runner);        // concurency18, include/coro_task.h (C++20)
+void benchStream(BenchRunner& runner);      // include/crawl_stream.h
+void benchDedup(BenchRunner& runner);       // concurency16, include/duplicate_finder.h
+void benchSearch(BenchRunner& runner);      // concurency7 search mode, include/content_search.h
+void benchWatch(BenchRunner& runner);       // concurency17, include/tree_watcher.h
+void benchQueue(BenchRunner& runner);       // concurency7, concurency13
+void benchLock(BenchRunner& runner);        // MonitorResult, MessageQueue::send, include/adaptive_mutex.h
+void benchReadMostly(BenchRunner& runner);  // MonitorResult::isDirsEmpty, include/read_mostly.h
+void benchSelect(BenchRunner& runner);      // MessageQueue try_receive / receive_for, include/select.h
+void benchPriority(BenchRunner& runner);    // include/priority_message_queue.h
+void benchCollector(BenchRunner& runner);   // MonitorResult::putFile, include/chunked_collector.h
+void benchForkJoin(BenchRunner& runner);    // concurency14, include/fork_join.h
+void benchFactorial(BenchRunner& runner);   // concurency15, include/big_factorial.h
+void benchCancel(BenchRunner& runner);      // include/cancellation.h
+void benchLogger(BenchRunner& runner);      // concurency10
+void benchTrace(BenchRunner& runner);       // include/trace.h
+
+#endif // CONCURENCY_BENCH_SUITES_H
@@ -0,0 +1,51 @@
+#include "synthetic_tree.h"
+
+#include <fstream>
+#include <vector>
+#include <atomic>
+#include <unistd.h>
+
+SyntheticTree::SyntheticTree(const TreeShape& shape) : _dirs(0), _files(0), _bytes(0)
+{
+    static std::atomic<int> counter(0);
+
+    _root = fs::temp_directory_path() /
+            ("concurency_bench_" + std::to_string(::getpid()) + "_" + std::to_string(counter++));
+    fs::remove_all(_root);
+
+    unsigned state = shape.seed ? shape.seed : 1;
+    build(_root, 0, shape, state);
+}
+
+SyntheticTree::~SyntheticTree()
+{
+    std::error_code ec;
+    fs::remove_all(_root, ec);
+}
+
+void SyntheticTree::build(const fs::path& dir, int level, const TreeShape& shape, unsigned& state)
+{
+    fs::create_directories(dir);
+    ++_dirs;
+
+    std::vector<char> buffer;
+    for (int i = 0; i < shape.filesPerDir; ++i)
+    {
+        std::size_t size = shape.fileBytes > 0 ? nextRandom(state) % (2 * shape.fileBytes + 1) : 0;
+        buffer.resize(size);
+        for (char& c : buffer)
+            c = static_cast<char>('a' + nextRandom(state) % 26);
+
+        std::ofstream f((dir / ("f" + std::to_string(i) + ".dat")).string(), std::ios::binary);
+        f.write(buffer.data(), buffer.size());
+
+        ++_files;
+        _bytes += size;
+    }
+
+    if (level < shape.depth)
+    {
+        for (int i = 0; i < shape.fanout; ++i)
+            build(dir / ("d" + std::to_string(i)), level + 1, shape, state);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef CONCURENCY_SYNTHETIC_TREE_H
+#define CONCURENCY_SYNTHETIC_TREE_H
+
+#include <string>
+#include <cstddef>
+#include "filesystem.h"
+#include "bench.h"
+
+/// xorshift32 - we only need something cheap and reproducible for a given seed
+inline unsigned nextRandom(unsigned& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/// Directory tree generated in the temp dir so the crawls can be benchmarked
+/// without depending on somebody's /home. The tree is removed in the destructor.
+///
+/// Layout: every directory has shape.fanout subdirectories "d<i>" (down to shape.depth levels)
+/// and shape.filesPerDir files "f<i>.dat".
+class SyntheticTree
+{
+    fs::path _root;
+    std::size_t _dirs;
+    std::size_t _files;
+    std::size_t _bytes;
+
+    void build(const fs::path& dir, int level, const TreeShape& shape, unsigned& state);
+
+public:
+    explicit SyntheticTree(const TreeShape& shape);
+    ~SyntheticTree();
+
+    SyntheticTree(const SyntheticTree&) = delete;
+    SyntheticTree& operator=(const SyntheticTree&) = delete;
+
+    const fs::path& root() const { return _root; }
+    std::size_t dirs() const { return _dirs; }      // including the root
+    std::size_t files() const { return _files; }
+    std::size_t bytes() const { return _bytes; }
+};
+
+/// Just the root directory: for the suites which write their own files into it and leave
+/// the temp dir and its removal to SyntheticTree.
+inline TreeShape rootOnly(unsigned seed)
+{
+    TreeShape shape;
+    shape.depth = 0;
+    shape.fanout = 0;
+    shape.filesPerDir = 0;
+    shape.seed = seed;
+    return shape;
+}
+
+#endif // CONCURENCY_SYNTHETIC_TREE_H
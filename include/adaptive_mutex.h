@@ -0,0 +1,117 @@
+#ifndef CONCURENCY_ADAPTIVE_MUTEX_H
+#define CONCURENCY_ADAPTIVE_MUTEX_H
+
+#include <atomic>
+#include <thread>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+ * Spin first, then sleep.
+ *
+ * The critical sections of MonitorResult (concurency6) and MessageQueue::send (concurency7)
+ * are a push_back. When std::mutex is taken the thread goes to sleep in the kernel right
+ * away - two syscalls and two context switches for a lock which would be free again after
+ * a few hundred cycles. AdaptiveMutex spins first, with a pause instruction and a backoff
+ * which doubles every round, and only then sleeps on a futex:
+ *
+ *   _state   0 - free, 1 - locked, 2 - locked and somebody may sleep on it
+ *
+ * unlock() makes the futex syscall only in state 2, so a lock which is never slept on
+ * never enters the kernel. How long to spin adapts like glibc's PTHREAD_MUTEX_ADAPTIVE_NP:
+ * _spinLimit moves towards the number of rounds the last acquisitions really needed, so a
+ * lock whose holders stay long stops wasting time in spinning. With a single CPU the holder
+ * can't run while we spin, so there is no spinning at all.
+ *
+ * It has lock / try_lock / unlock - std::lock_guard and std::unique_lock take it as they are.
+ * std::condition_variable wants std::mutex, with this one use std::condition_variable_any.
+ */
+
+class AdaptiveMutex
+{
+    static const int MAX_SPIN = 64;         // rounds, a round waits 1, 2, 4 ... 64 pauses
+
+    std::atomic<int> _state;
+    std::atomic<int> _spinLimit;            // a hint only, races on it are harmless
+
+    static void pause()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#else
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+
+    static bool multiCore()
+    {
+        static const bool multi = std::thread::hardware_concurrency() > 1;
+        return multi;
+    }
+
+    int futex(int op, int value)
+    {
+        return static_cast<int>(syscall(SYS_futex, reinterpret_cast<int*>(&_state), op | FUTEX_PRIVATE_FLAG, value, nullptr, nullptr, 0));
+    }
+
+    void lockSlow()
+    {
+        int limit = multiCore() ? _spinLimit.load(std::memory_order_relaxed) * 2 + 8 : 0;
+        if (limit > MAX_SPIN)
+            limit = MAX_SPIN;
+
+        int backoff = 1;
+        for (int round = 0; round < limit; ++round)
+        {
+            for (int i = 0; i < backoff; ++i)
+                pause();
+            if (backoff < 64)
+                backoff *= 2;
+
+            int expected = 0;
+            if (_state.load(std::memory_order_relaxed) == 0 &&
+                _state.compare_exchange_weak(expected, 1, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                int spin = _spinLimit.load(std::memory_order_relaxed);
+                _spinLimit.store(spin + (round - spin) / 8, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        // sleep; whoever locks from here on marks the lock as slept on (2), so unlock wakes somebody
+        int spin = _spinLimit.load(std::memory_order_relaxed);
+        _spinLimit.store(spin + (MAX_SPIN - spin) / 8, std::memory_order_relaxed);
+        while (_state.exchange(2, std::memory_order_acquire) != 0)
+            futex(FUTEX_WAIT, 2);
+    }
+
+public:
+    AdaptiveMutex() : _state(0), _spinLimit(MAX_SPIN / 4) {}
+
+    AdaptiveMutex(const AdaptiveMutex&) = delete;
+    AdaptiveMutex& operator=(const AdaptiveMutex&) = delete;
+
+    void lock()
+    {
+        int expected = 0;
+        if (!_state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed))
+            lockSlow();
+    }
+
+    bool try_lock()
+    {
+        int expected = 0;
+        return _state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock()
+    {
+        if (_state.exchange(0, std::memory_order_release) == 2)
+            futex(FUTEX_WAKE, 1);
+    }
+};
+
+#endif // CONCURENCY_ADAPTIVE_MUTEX_H
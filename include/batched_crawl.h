@@ -0,0 +1,159 @@
+#ifndef CONCURENCY_BATCHED_CRAWL_H
+#define CONCURENCY_BATCHED_CRAWL_H
+
+#include <iostream>
+#include <string>
+#include <future>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <system_error>
+#include "cancellation.h"
+#include "crawl_hooks.h"
+#include "executor.h"
+#include "filesystem.h"
+#include "frontier.h"
+#include "result.h"
+#include "trace.h"
+
+/*
+ * Directory listing from concurency5. This time we
+ * limit the number of tasks which are
+ * spawn during the execution. In concurency4 we were
+ * spawning each task for each subdirectory and again for any within it.
+ * That will flood the processor. We would like to limit it i.e. up to 8 threads
+ *
+ * The token stops a crawl: every task checks it between the entries, and listAllFiles
+ * throws OperationCancelled once all the tasks of the current batch are finished.
+ * The tasks run on the executor, a new thread each by default (see include/executor.h).
+ *
+ * A directory or an entry which can't be read doesn't throw: it ends up in Result::errors
+ * and, when the caller passes one in the hooks, in an ErrorTable (see include/crawl_errors.h).
+ * Symlinks are entries like files unless the hooks have a WalkPolicy. The progress, the index
+ * and the sorted runs are hooks too (see include/crawl_hooks.h).
+ */
+
+/// run - where the full paths go with hooks.sorted; without one they are a run of this directory.
+inline Result listDir (fs::path && dir, const CancellationToken& token, const CrawlHooks& hooks = CrawlHooks(),
+                       RunBuffer* run = nullptr)
+{
+    TRACE_SCOPE("task", "listDir");
+    Result result;
+    RunBuffer own(hooks.sorted);
+    if (hooks.sorted && !run)
+        run = &own;
+    forEachEntry(dir, result.errors, token, hooks.walk,
+                 [&result](fs::path&& d) { result.dirs.push_back(std::move(d)); },
+                 [&](const fs::path& f, const struct stat& st)
+                 {
+                     result.files.push_back(f.filename());
+                     if (hooks.index)
+                         hooks.index->insert(f.string(), st.st_size);
+                     if (run)
+                         run->push(f.string());
+                 });
+
+    own.flush();
+    if (hooks.progress)
+        hooks.progress->add(result.dirs.size(), result.files.size(), 0, result.errors.size());
+    return result; //RVO;
+}
+
+/// The crawl with an explicit frontier - its policy decides the order of the directories
+/// (see include/frontier.h) and its memory limit how many of them are kept in memory.
+inline std::vector<std::string> listAllFiles(std::string& root, DirFrontier& dirsToDo, int maxTasks = 8,
+                                             const CancellationToken& token = CancellationToken(),
+                                             Executor& executor = defaultExecutor(),
+                                             const CrawlHooks& hooks = CrawlHooks())
+{
+    dirsToDo.push(fs::path(root));
+    if (hooks.progress)
+        hooks.progress->addRoot();
+
+    //accumulator for list of files;
+    std::vector<std::string> files;
+    //with hooks.sorted the i-th task of every batch collects into runs[i]
+    std::vector<RunBuffer> runs;
+    if (hooks.sorted)
+        runs.resize(maxTasks, RunBuffer(hooks.sorted));
+
+    //we don't want to create unbounded number of tasks
+    while(!dirsToDo.empty())
+    {
+        token.throwIfCancelled();
+        std::vector<std::future<Result>> futures;
+
+        //limit the number of tasks to maxTasks
+        fs::path dir;
+        for (int i = 0; i < maxTasks && dirsToDo.pop(dir); ++i)
+        {
+            /* The frontier gives us the next directory to do.
+            *  With the DepthFirst policy it is the last one pushed - a typical stack operation,
+            *  what the vector with pop_back used to do here.
+            */
+            auto ftr = spawn(executor,
+                             static_cast<Result (*)(fs::path&&, const CancellationToken&, const CrawlHooks&, RunBuffer*)>(&listDir),
+                             std::move(dir), token, hooks, runs.empty() ? nullptr : &runs[i]);
+            futures.push_back(std::move(ftr));
+        }
+
+        TRACE_SCOPE("barrier", "listAllFiles batch barrier");
+        //here we are creating barrier
+        while(!futures.empty())
+        {
+            auto ftr = std::move(futures.back());
+            futures.pop_back();
+            // one failed task must not drop the results of the others - the try is per task
+            try
+            {
+                Result result = awaitFuture(executor, ftr); //Get the result;
+                //back inserter will do push backs - which means it will add the elements to the end of the vector
+                std::move(result.files.begin(), result.files.end(), std::back_inserter(files));
+                //add (sub)directories to be parsed
+                for (fs::path& d : result.dirs)
+                    dirsToDo.push(std::move(d));
+                if (hooks.errors)
+                    hooks.errors->add(result.errors);
+            }
+            catch (OperationCancelled&)
+            {
+                //wait for the tasks left in the vector,
+                //so nothing is running anymore when the exception leaves listAllFiles
+                waitAll(executor, futures);
+                throw;
+            }
+            catch (std::system_error& e)
+            {
+                // listDir reports the filesystem errors in Result::errors, this is something else
+                std::cout << "System error: " << e.code().message() << std::endl;
+            }
+
+            catch (std::exception& e)
+            {
+                std::cout << "Exception: " << e.what() << std::endl;
+            }
+
+            catch (...)
+            {
+                std::cout <<"Unknown Exception" << std::endl;
+            }
+        }
+    }
+
+    for (RunBuffer& run : runs)
+        run.flush();
+    return files;
+
+}
+
+inline std::vector<std::string> listAllFiles(std::string& root, int maxTasks = 8,
+                                             const CancellationToken& token = CancellationToken(),
+                                             Executor& executor = defaultExecutor(),
+                                             const CrawlHooks& hooks = CrawlHooks())
+{
+    // a stack in memory, like the vector with pop_back in concurency5
+    DirFrontier dirsToDo(TraversalPolicy::DepthFirst);
+    return listAllFiles(root, dirsToDo, maxTasks, token, executor, hooks);
+}
+
+#endif // CONCURENCY_BATCHED_CRAWL_H
@@ -0,0 +1,142 @@
+#ifndef CONCURENCY_BIG_FACTORIAL_H
+#define CONCURENCY_BIG_FACTORIAL_H
+
+#include <cstdint>
+#include <future>
+#include <vector>
+#include "big_integer.h"
+#include "fork_join.h"
+
+/*
+ * Factorials and binomials which don't overflow (the int factorial from concurency11/12
+ * is wrong from 13! on).
+ *
+ * Binary splitting: n! = product(1..n/2) * product(n/2+1..n), recursively.
+ * Both halves have similar size, so the big multiplications are balanced and Karatsuba
+ * pays off - multiplying 2, 3, ..., n one by one into the result is quadratic.
+ * The two halves are fork/join tasks, and the big multiplications near the root
+ * are parallel too (see multiply in big_integer.h).
+ *
+ * Binomials avoid division: C(n, k) = product of p^e over primes p <= n, where the exponent
+ * e = sum over p^i of floor(n/p^i) - floor(k/p^i) - floor((n-k)/p^i) (Legendre's formula).
+ */
+
+constexpr std::size_t PRODUCT_LEAF = 64;   // factors multiplied one by one at the leaves
+
+/// Product of get(i) for i in [lo, hi). get returns 32 bit factors.
+template<typename Get>
+BigInteger productRange(ForkJoinPool* pool, std::uint64_t lo, std::uint64_t hi, const Get& get)
+{
+    if (hi - lo <= PRODUCT_LEAF)
+    {
+        BigInteger result(1);
+        std::uint64_t acc = 1;
+        for (std::uint64_t i = lo; i < hi; ++i)
+        {
+            std::uint64_t f = get(i);
+            // pack small factors into one word before touching the big number
+            if (acc * f > 0xffffffffull)
+            {
+                result.mulSmall(static_cast<std::uint32_t>(acc));
+                acc = 1;
+            }
+            acc *= f;
+        }
+        return result.mulSmall(static_cast<std::uint32_t>(acc));
+    }
+
+    std::uint64_t mid = lo + (hi - lo) / 2;
+    BigInteger left, right;
+    if (pool && !pool->sequential(hi - lo))
+    {
+        TaskGroup group(*pool);
+        group.spawn([&] { left = productRange(pool, lo, mid, get); });
+        pool->runInline([&] { right = productRange(pool, mid, hi, get); });
+        group.sync();
+    }
+    else
+    {
+        left = productRange(pool, lo, mid, get);
+        right = productRange(pool, mid, hi, get);
+    }
+    return multiply(left, right, pool);
+}
+
+struct Identity
+{
+    std::uint64_t operator()(std::uint64_t i) const { return i; }
+};
+
+/// n! by binary splitting. Without pool it runs serially.
+inline BigInteger factorial(std::uint32_t n, ForkJoinPool* pool = nullptr)
+{
+    if (n < 2)
+        return BigInteger(1);
+    return productRange(pool, 2, static_cast<std::uint64_t>(n) + 1, Identity());
+}
+
+/// n! the simple way: multiply the result by 2, 3, ..., n (like concurency11, but without overflow).
+inline BigInteger factorialNaive(std::uint32_t n)
+{
+    BigInteger result(1);
+    for (std::uint32_t i = 2; i <= n; ++i)
+        result.mulSmall(i);
+    return result;
+}
+
+/// Exponent of prime p in m!
+inline std::uint64_t legendre(std::uint64_t m, std::uint64_t p)
+{
+    std::uint64_t e = 0;
+    while (m)
+    {
+        m /= p;
+        e += m;
+    }
+    return e;
+}
+
+/// n choose k through its prime factorization.
+inline BigInteger binomial(std::uint32_t n, std::uint32_t k, ForkJoinPool* pool = nullptr)
+{
+    if (k > n)
+        return BigInteger(0);
+
+    // sieve of Eratosthenes
+    std::vector<bool> composite(static_cast<std::size_t>(n) + 1, false);
+    std::vector<std::uint32_t> factors;
+    for (std::uint64_t p = 2; p <= n; ++p)
+    {
+        if (composite[p])
+            continue;
+        for (std::uint64_t q = p * p; q <= n; q += p)
+            composite[q] = true;
+
+        std::uint64_t e = legendre(n, p) - legendre(k, p) - legendre(n - k, p);
+        for (std::uint64_t i = 0; i < e; ++i)
+            factors.push_back(static_cast<std::uint32_t>(p));
+    }
+
+    if (factors.empty())
+        return BigInteger(1);
+    return productRange(pool, 0, factors.size(), [&factors](std::uint64_t i) -> std::uint64_t
+    {
+        return factors[i];
+    });
+}
+
+/// Future returning versions. The computation runs as a task on the pool;
+/// get() the future from outside of the pool's threads.
+inline std::future<BigInteger> factorialAsync(ForkJoinPool& pool, std::uint32_t n)
+{
+    ForkJoinPool* p = &pool;
+    return pool.submit([p, n] { return factorial(n, p); });
+}
+
+inline std::future<BigInteger> binomialAsync(ForkJoinPool& pool, std::uint32_t n, std::uint32_t k)
+{
+    ForkJoinPool* p = &pool;
+    return pool.submit([p, n, k] { return binomial(n, k, p); });
+}
+
+#endif // CONCURENCY_BIG_FACTORIAL_H
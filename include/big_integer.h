@@ -0,0 +1,263 @@
+#ifndef CONCURENCY_BIG_INTEGER_H
+#define CONCURENCY_BIG_INTEGER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "fork_join.h"
+
+/*
+ * Non-negative arbitrary precision integer - just enough for factorials and binomials.
+ *
+ * The number is a vector of 32 bit limbs, least significant first, without leading zeros
+ * (zero is an empty vector). Two limbs multiply into 64 bits without overflow.
+ *
+ * Multiplication is schoolbook for small numbers and Karatsuba above KARATSUBA_THRESHOLD limbs:
+ *   a = a1*B^m + a0, b = b1*B^m + b0
+ *   a*b = z2*B^2m + z1*B^m + z0, z0 = a0*b0, z2 = a1*b1, z1 = (a0+a1)(b0+b1) - z0 - z2
+ * three half size products instead of four. When a ForkJoinPool is given, the three
+ * products of the big levels are computed as parallel tasks.
+ */
+
+typedef std::vector<std::uint32_t> Limbs;
+
+constexpr std::size_t KARATSUBA_THRESHOLD = 40;
+
+namespace big_integer_detail
+{
+    inline void trim(Limbs& v)
+    {
+        while (!v.empty() && v.back() == 0)
+            v.pop_back();
+    }
+
+    inline Limbs add(const std::uint32_t* a, std::size_t na, const std::uint32_t* b, std::size_t nb)
+    {
+        if (na < nb)
+        {
+            std::swap(a, b);
+            std::swap(na, nb);
+        }
+        Limbs out(na + 1);
+        std::uint64_t carry = 0;
+        for (std::size_t i = 0; i < na; ++i)
+        {
+            std::uint64_t s = carry + a[i] + (i < nb ? b[i] : 0);
+            out[i] = static_cast<std::uint32_t>(s);
+            carry = s >> 32;
+        }
+        out[na] = static_cast<std::uint32_t>(carry);
+        return out;
+    }
+
+    /// a -= b, requires a >= b
+    inline void subInPlace(Limbs& a, Limbs b)
+    {
+        trim(b);
+        std::int64_t borrow = 0;
+        for (std::size_t i = 0; i < a.size() && (i < b.size() || borrow); ++i)
+        {
+            std::int64_t d = static_cast<std::int64_t>(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+            borrow = d < 0 ? 1 : 0;
+            a[i] = static_cast<std::uint32_t>(d + (borrow << 32));
+        }
+    }
+
+    /// out += v * B^shift. The sum has to fit into out.
+    inline void addShifted(Limbs& out, const Limbs& v, std::size_t shift)
+    {
+        std::uint64_t carry = 0;
+        std::size_t i = 0;
+        for (; i < v.size() && shift + i < out.size(); ++i)
+        {
+            std::uint64_t s = carry + out[shift + i] + v[i];
+            out[shift + i] = static_cast<std::uint32_t>(s);
+            carry = s >> 32;
+        }
+        for (std::size_t j = shift + i; carry && j < out.size(); ++j)
+        {
+            std::uint64_t s = carry + out[j];
+            out[j] = static_cast<std::uint32_t>(s);
+            carry = s >> 32;
+        }
+    }
+
+    inline Limbs mulSchool(const std::uint32_t* a, std::size_t na, const std::uint32_t* b, std::size_t nb)
+    {
+        Limbs out(na + nb);
+        for (std::size_t i = 0; i < na; ++i)
+        {
+            std::uint64_t carry = 0;
+            std::uint64_t ai = a[i];
+            for (std::size_t j = 0; j < nb; ++j)
+            {
+                std::uint64_t t = ai * b[j] + out[i + j] + carry;
+                out[i + j] = static_cast<std::uint32_t>(t);
+                carry = t >> 32;
+            }
+            out[i + nb] = static_cast<std::uint32_t>(carry);
+        }
+        return out;
+    }
+
+    /// Result has na + nb limbs (not trimmed).
+    inline Limbs mulKaratsuba(const std::uint32_t* a, std::size_t na,
+                              const std::uint32_t* b, std::size_t nb, ForkJoinPool* pool)
+    {
+        if (na < nb)
+        {
+            std::swap(a, b);
+            std::swap(na, nb);
+        }
+        if (nb == 0)
+            return Limbs(na);
+        if (nb < KARATSUBA_THRESHOLD)
+            return mulSchool(a, na, b, nb);
+
+        Limbs out(na + nb);
+
+        // very unbalanced - multiply b by nb sized slices of a
+        if (na >= 2 * nb)
+        {
+            for (std::size_t off = 0; off < na; off += nb)
+            {
+                std::size_t len = std::min(nb, na - off);
+                addShifted(out, mulKaratsuba(a + off, len, b, nb, pool), off);
+            }
+            return out;
+        }
+
+        // here nb > m, so both numbers have a high part
+        std::size_t m = na / 2;
+        Limbs sa = add(a, m, a + m, na - m);
+        Limbs sb = add(b, m, b + m, nb - m);
+
+        Limbs z0, z1, z2;
+        if (pool && !pool->sequential(na))
+        {
+            TaskGroup group(*pool);
+            group.spawn([&] { z0 = mulKaratsuba(a, m, b, m, pool); });
+            group.spawn([&] { z2 = mulKaratsuba(a + m, na - m, b + m, nb - m, pool); });
+            pool->runInline([&] { z1 = mulKaratsuba(sa.data(), sa.size(), sb.data(), sb.size(), pool); });
+            group.sync();
+        }
+        else
+        {
+            z0 = mulKaratsuba(a, m, b, m, pool);
+            z2 = mulKaratsuba(a + m, na - m, b + m, nb - m, pool);
+            z1 = mulKaratsuba(sa.data(), sa.size(), sb.data(), sb.size(), pool);
+        }
+
+        subInPlace(z1, z0);
+        subInPlace(z1, z2);
+        trim(z0);
+        trim(z1);
+        trim(z2);
+
+        addShifted(out, z0, 0);
+        addShifted(out, z1, m);
+        addShifted(out, z2, 2 * m);
+        return out;
+    }
+}
+
+class BigInteger
+{
+    Limbs _limbs;
+
+public:
+    BigInteger(std::uint64_t value = 0)
+    {
+        while (value)
+        {
+            _limbs.push_back(static_cast<std::uint32_t>(value));
+            value >>= 32;
+        }
+    }
+
+    explicit BigInteger(Limbs&& limbs) : _limbs(std::move(limbs))
+    {
+        big_integer_detail::trim(_limbs);
+    }
+
+    bool isZero() const { return _limbs.empty(); }
+    const Limbs& limbs() const { return _limbs; }
+
+    std::size_t bits() const
+    {
+        if (_limbs.empty())
+            return 0;
+        std::size_t b = 32 * (_limbs.size() - 1);
+        for (std::uint32_t top = _limbs.back(); top; top >>= 1)
+            ++b;
+        return b;
+    }
+
+    BigInteger& mulSmall(std::uint32_t m)
+    {
+        std::uint64_t carry = 0;
+        for (std::uint32_t& limb : _limbs)
+        {
+            std::uint64_t t = static_cast<std::uint64_t>(limb) * m + carry;
+            limb = static_cast<std::uint32_t>(t);
+            carry = t >> 32;
+        }
+        if (carry)
+            _limbs.push_back(static_cast<std::uint32_t>(carry));
+        big_integer_detail::trim(_limbs);
+        return *this;
+    }
+
+    /// Divides in place and returns the remainder.
+    std::uint32_t divSmall(std::uint32_t d)
+    {
+        std::uint64_t rem = 0;
+        for (std::size_t i = _limbs.size(); i-- > 0;)
+        {
+            std::uint64_t cur = (rem << 32) | _limbs[i];
+            _limbs[i] = static_cast<std::uint32_t>(cur / d);
+            rem = cur % d;
+        }
+        big_integer_detail::trim(_limbs);
+        return static_cast<std::uint32_t>(rem);
+    }
+
+    /// Decimal representation. Quadratic - fine for printing, not for million digit numbers.
+    std::string toString() const
+    {
+        if (isZero())
+            return "0";
+
+        BigInteger tmp(*this);
+        std::vector<std::uint32_t> chunks; // base 1e9, least significant first
+        while (!tmp.isZero())
+            chunks.push_back(tmp.divSmall(1000000000u));
+
+        std::string s = std::to_string(chunks.back());
+        for (std::size_t i = chunks.size() - 1; i-- > 0;)
+        {
+            std::string part = std::to_string(chunks[i]);
+            s += std::string(9 - part.size(), '0') + part;
+        }
+        return s;
+    }
+
+    friend bool operator==(const BigInteger& a, const BigInteger& b) { return a._limbs == b._limbs; }
+    friend bool operator!=(const BigInteger& a, const BigInteger& b) { return !(a == b); }
+};
+
+/// Karatsuba product. With a pool the big levels run in parallel.
+inline BigInteger multiply(const BigInteger& a, const BigInteger& b, ForkJoinPool* pool = nullptr)
+{
+    return BigInteger(big_integer_detail::mulKaratsuba(a.limbs().data(), a.limbs().size(),
+                                                       b.limbs().data(), b.limbs().size(), pool));
+}
+
+inline BigInteger operator*(const BigInteger& a, const BigInteger& b)
+{
+    return multiply(a, b);
+}
+
+#endif // CONCURENCY_BIG_INTEGER_H
@@ -0,0 +1,80 @@
+#ifndef CONCURENCY_BOUNDED_QUEUE_H
+#define CONCURENCY_BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include "trace.h"
+
+/// MessageQueue with a capacity and an end.
+///
+/// Between the stages of a pipeline the queue must not grow without limit - when
+/// the next stage is slower, send blocks until there is room again (back pressure).
+/// When the producers are done, close() lets the consumers drain the queue
+/// and then recieve returns false instead of waiting forever.
+template<typename T>
+class BoundedQueue
+{
+    std::deque<T> _queue;
+    std::size_t _capacity;
+    bool _closed;
+    std::mutex _mutex;
+    std::condition_variable _notEmpty;
+    std::condition_variable _notFull;
+
+public:
+    explicit BoundedQueue(std::size_t capacity = 1024) : _capacity(capacity ? capacity : 1), _closed(false) {}
+
+    /// Waits for room. false (and the message is dropped) when the queue is closed.
+    bool send(T&& message)
+    {
+        {
+            std::unique_lock<std::mutex> lck(_mutex, std::defer_lock);
+            traceLock(lck, "BoundedQueue::send lock");
+            if (_queue.size() >= _capacity && !_closed)
+            {
+                TRACE_SCOPE("queue", "BoundedQueue::full");
+                _notFull.wait(lck, [this] { return _queue.size() < _capacity || _closed; });
+            }
+            if (_closed)
+                return false;
+            _queue.push_front(std::move(message));
+        }
+        _notEmpty.notify_one();
+        return true;
+    }
+
+    /// Waits for a message. false when the queue is closed and empty.
+    bool recieve(T& out)
+    {
+        {
+            std::unique_lock<std::mutex> lck(_mutex, std::defer_lock);
+            traceLock(lck, "BoundedQueue::recieve lock");
+            if (_queue.empty() && !_closed)
+            {
+                TRACE_SCOPE("queue", "BoundedQueue::wait");
+                _notEmpty.wait(lck, [this] { return !_queue.empty() || _closed; });
+            }
+            if (_queue.empty())
+                return false;
+            out = std::move(_queue.back());
+            _queue.pop_back();
+        }
+        _notFull.notify_one();
+        return true;
+    }
+
+    /// No more messages. The ones already queued are still delivered.
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            _closed = true;
+        }
+        _notEmpty.notify_all();
+        _notFull.notify_all();
+    }
+};
+
+#endif // CONCURENCY_BOUNDED_QUEUE_H
@@ -0,0 +1,10 @@
+#ifndef CONCURENCY_CACHE_LINE_H
+#define CONCURENCY_CACHE_LINE_H
+
+#include <cstddef>
+
+/// Data written by different threads is kept this far apart, otherwise every write
+/// takes the cache line away from the other cores (false sharing).
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+#endif // CONCURENCY_CACHE_LINE_H
@@ -0,0 +1,220 @@
+#ifndef CONCURENCY_CANCELLATION_H
+#define CONCURENCY_CANCELLATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Cooperative cancellation.
+ *
+ * In concurency11 the only way to give up on a pending factorial is to break the promise
+ * (set_exception) - and the task keeps running anyway. A crawl started by listAllFiles
+ * can't be stopped at all. Threads can't be killed safely, so the work has to stop itself:
+ *
+ *   CancellationSource source;                           // owned by whoever may cancel
+ *   auto ftr = std::async(std::launch::async, [token]    // copies of the token go to the workers
+ *   {
+ *       while (...)
+ *       {
+ *           token.throwIfCancelled();                    // checked between small pieces of work
+ *           ...
+ *       }
+ *   });
+ *   source.cancel();
+ *
+ * A token can also carry a deadline: token.withTimeout(100ms) returns a child token which is
+ * cancelled when the parent is, or when the time is up - pass it down and every level of
+ * the work respects the tightest deadline. A default constructed token is never cancelled.
+ *
+ * Blocking waits (MessageQueue::recieve) register a callback which wakes them on cancel(),
+ * and wait no longer than the deadline.
+ */
+
+typedef std::chrono::steady_clock CancelClock;
+
+/// Thrown by the cancelled work, travels through futures like any other exception.
+class OperationCancelled : public std::runtime_error
+{
+public:
+    explicit OperationCancelled(const std::string& what = "operation cancelled") : std::runtime_error(what) {}
+};
+
+class CancellationToken
+{
+    struct State
+    {
+        std::atomic<bool> cancelled;
+        CancelClock::time_point deadline;           // already the min with the parent's one
+        bool hasDeadline;
+        std::shared_ptr<State> parent;
+
+        std::mutex mutex;                           // guards callbacks
+        std::uint64_t nextId;
+        std::vector<std::pair<std::uint64_t, std::function<void()>>> callbacks;
+
+        State() : cancelled(false), deadline(CancelClock::time_point::max()), hasDeadline(false), nextId(0) {}
+    };
+
+    std::shared_ptr<State> _state;    // nullptr - never cancelled
+
+    explicit CancellationToken(std::shared_ptr<State> state) : _state(std::move(state)) {}
+
+    static std::shared_ptr<State> child(const std::shared_ptr<State>& parent)
+    {
+        std::shared_ptr<State> s = std::make_shared<State>();
+        s->parent = parent;
+        if (parent)
+        {
+            s->deadline = parent->deadline;
+            s->hasDeadline = parent->hasDeadline;
+        }
+        return s;
+    }
+
+    friend class CancellationSource;
+    friend class CancelRegistration;
+
+public:
+    CancellationToken() {}
+
+    /// cancel() was called on this token's source or on any of its parents
+    bool cancelRequested() const
+    {
+        for (State* s = _state.get(); s; s = s->parent.get())
+            if (s->cancelled.load(std::memory_order_acquire))
+                return true;
+        return false;
+    }
+
+    bool hasDeadline() const { return _state && _state->hasDeadline; }
+
+    /// CancelClock::time_point::max() without a deadline
+    CancelClock::time_point deadline() const
+    {
+        return _state ? _state->deadline : CancelClock::time_point::max();
+    }
+
+    bool isCancelled() const
+    {
+        if (!_state)
+            return false;
+        return cancelRequested() || (_state->hasDeadline && CancelClock::now() >= _state->deadline);
+    }
+
+    void throwIfCancelled() const
+    {
+        if (isCancelled())
+            throw OperationCancelled(cancelRequested() ? "operation cancelled" : "deadline exceeded");
+    }
+
+    /// Child token: cancelled with this one or at the deadline, whichever comes first.
+    CancellationToken withDeadline(CancelClock::time_point deadline) const
+    {
+        std::shared_ptr<State> s = child(_state);
+        if (deadline < s->deadline)
+            s->deadline = deadline;
+        s->hasDeadline = true;
+        return CancellationToken(s);
+    }
+
+    template<typename Rep, typename Period>
+    CancellationToken withTimeout(std::chrono::duration<Rep, Period> timeout) const
+    {
+        return withDeadline(CancelClock::now() + std::chrono::duration_cast<CancelClock::duration>(timeout));
+    }
+};
+
+/// Owns the right to cancel. The tokens it hands out see the cancel().
+class CancellationSource
+{
+    std::shared_ptr<CancellationToken::State> _state;
+
+public:
+    /// A source linked to parent is cancelled together with it.
+    explicit CancellationSource(const CancellationToken& parent = CancellationToken())
+        : _state(CancellationToken::child(parent._state))
+    {
+    }
+
+    CancellationToken token() const { return CancellationToken(_state); }
+
+    /// Sets the flag and runs the registered callbacks. Only the first call does anything.
+    void cancel()
+    {
+        if (_state->cancelled.exchange(true, std::memory_order_acq_rel))
+            return;
+        // callbacks run under the mutex, so a CancelRegistration being destroyed
+        // waits for its callback to finish
+        std::lock_guard<std::mutex> lck(_state->mutex);
+        for (auto& cb : _state->callbacks)
+            cb.second();
+    }
+
+    bool cancelRequested() const { return _state->cancelled.load(std::memory_order_acquire); }
+};
+
+/// RAII callback registration: fn is called when the token (or any of its parents) gets cancelled,
+/// as long as the registration is alive. The deadline does not call it - waits use wait_until.
+/// fn must not register or unregister callbacks itself.
+class CancelRegistration
+{
+    std::vector<std::pair<std::shared_ptr<CancellationToken::State>, std::uint64_t>> _entries;
+
+public:
+    CancelRegistration(const CancellationToken& token, std::function<void()> fn)
+    {
+        for (std::shared_ptr<CancellationToken::State> s = token._state; s; s = s->parent)
+        {
+            std::lock_guard<std::mutex> lck(s->mutex);
+            std::uint64_t id = s->nextId++;
+            s->callbacks.emplace_back(id, fn);
+            _entries.emplace_back(s, id);
+        }
+    }
+
+    CancelRegistration(const CancelRegistration&) = delete;
+    CancelRegistration& operator=(const CancelRegistration&) = delete;
+
+    ~CancelRegistration()
+    {
+        for (auto& e : _entries)
+        {
+            std::lock_guard<std::mutex> lck(e.first->mutex);
+            auto& cbs = e.first->callbacks;
+            for (auto it = cbs.begin(); it != cbs.end(); ++it)
+            {
+                if (it->first == e.second)
+                {
+                    cbs.erase(it);
+                    break;
+                }
+            }
+        }
+    }
+};
+
+/// std::async which passes the token on as the first argument of f and
+/// doesn't start f at all when the token is already cancelled.
+template<typename F, typename... Args>
+std::future<typename std::result_of<F(CancellationToken, Args...)>::type>
+asyncCancellable(const CancellationToken& token, F f, Args... args)
+{
+    typedef typename std::result_of<F(CancellationToken, Args...)>::type R;
+    return std::async(std::launch::async, [token, f](Args... a) mutable -> R
+    {
+        token.throwIfCancelled();
+        return f(token, std::move(a)...);
+    }, std::move(args)...);
+}
+
+#endif // CONCURENCY_CANCELLATION_H
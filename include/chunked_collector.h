@@ -0,0 +1,142 @@
+#ifndef CONCURENCY_CHUNKED_COLLECTOR_H
+#define CONCURENCY_CHUNKED_COLLECTOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Append-only collection which many threads can fill without a lock.
+ *
+ * Elements live in chunks of fixed size linked into a list. A writer claims
+ * a slot in the current chunk with one fetch_add and moves its element there.
+ * The writer which claims the first slot past the end links the next chunk
+ * with compare_exchange (losers of the race delete their chunk) and everybody
+ * moves to it.
+ *
+ * Reading (size, forEach, takeAll) is allowed only when the writers are done,
+ * e.g. after their threads/futures were joined. Then it's a plain walk over
+ * the chunks, no synchronization at all.
+ */
+template<typename T>
+class ChunkedCollector
+{
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+    struct Chunk
+    {
+        std::atomic<std::size_t> claimed;
+        std::atomic<Chunk*> next;
+        std::size_t capacity;
+        Storage* slots;
+
+        explicit Chunk(std::size_t cap) : claimed(0), next(nullptr), capacity(cap), slots(new Storage[cap]) {}
+        ~Chunk() { delete [] slots; }
+
+        std::size_t used() const
+        {
+            std::size_t n = claimed.load(std::memory_order_relaxed);
+            return n < capacity ? n : capacity;
+        }
+
+        T* at(std::size_t i) { return reinterpret_cast<T*>(&slots[i]); }
+    };
+
+    std::size_t _chunkSize;
+    Chunk* _head;
+    std::atomic<Chunk*> _current;
+
+    void destroy()
+    {
+        Chunk* c = _head;
+        while (c)
+        {
+            for (std::size_t i = 0; i < c->used(); ++i)
+                c->at(i)->~T();
+            Chunk* next = c->next.load(std::memory_order_relaxed);
+            delete c;
+            c = next;
+        }
+        _head = nullptr;
+    }
+
+public:
+    explicit ChunkedCollector(std::size_t chunkSize = 4096)
+        : _chunkSize(chunkSize ? chunkSize : 1), _head(new Chunk(_chunkSize)), _current(_head)
+    {
+    }
+
+    ~ChunkedCollector()
+    {
+        destroy();
+    }
+
+    ChunkedCollector(const ChunkedCollector&) = delete;
+    ChunkedCollector& operator=(const ChunkedCollector&) = delete;
+
+    /// Lock free. Elements are only moved in - copying is not allowed on purpose.
+    void append(T&& value)
+    {
+        Chunk* c = _current.load(std::memory_order_acquire);
+        for (;;)
+        {
+            std::size_t idx = c->claimed.fetch_add(1, std::memory_order_relaxed);
+            if (idx < c->capacity)
+            {
+                new (c->at(idx)) T(std::move(value));
+                return;
+            }
+
+            //chunk is full - make sure there is next one and move the current pointer
+            Chunk* next = c->next.load(std::memory_order_acquire);
+            if (!next)
+            {
+                Chunk* fresh = new Chunk(_chunkSize);
+                if (c->next.compare_exchange_strong(next, fresh, std::memory_order_acq_rel))
+                    next = fresh;
+                else
+                    delete fresh; //somebody was faster, next holds his chunk
+            }
+            _current.compare_exchange_strong(c, next, std::memory_order_acq_rel);
+            c = _current.load(std::memory_order_acquire);
+        }
+    }
+
+    void append(const T&) = delete;
+
+    // ---- only when the writers are done ----
+
+    std::size_t size() const
+    {
+        std::size_t n = 0;
+        for (Chunk* c = _head; c; c = c->next.load(std::memory_order_acquire))
+            n += c->used();
+        return n;
+    }
+
+    template<typename F>
+    void forEach(F f)
+    {
+        for (Chunk* c = _head; c; c = c->next.load(std::memory_order_acquire))
+            for (std::size_t i = 0; i < c->used(); ++i)
+                f(*c->at(i));
+    }
+
+    /// Moves everything to a vector and leaves the collector empty.
+    std::vector<T> takeAll()
+    {
+        std::vector<T> out;
+        out.reserve(size());
+        forEach([&out](T& value) { out.push_back(std::move(value)); });
+
+        destroy();
+        _head = new Chunk(_chunkSize);
+        _current.store(_head, std::memory_order_release);
+        return out;
+    }
+};
+
+#endif // CONCURENCY_CHUNKED_COLLECTOR_H
@@ -0,0 +1,312 @@
+#ifndef CONCURENCY_CONTENT_SEARCH_H
+#define CONCURENCY_CONTENT_SEARCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cancellation.h"
+#include "crawl_errors.h"
+#include "filesystem.h"
+#include "message_queue.h"
+#include "trace.h"
+
+/*
+ * grep: the lines of the files under a directory which contain a pattern.
+ *
+ * The concurency7 design with a different consumer: dir servers list the directories and
+ * send the file paths to the search servers, which open the files and scan them.
+ *
+ *  - literal patterns are found with memmem on the whole file and memchr for the line ends.
+ *    glibc implements both with SIMD, so the scan doesn't look at the bytes one by one.
+ *    Lines are numbered by counting '\n' between the matches (std::count - vectorized too).
+ *  - regex patterns (std::regex, ECMAScript) are tried line by line.
+ *  - files of mmapThreshold and more are mmap'ed, smaller ones read() into a buffer
+ *    which every search server reuses.
+ *  - a file with a zero byte in its first 8 KB is binary and skipped (like grep does).
+ *  - the order of the crawl depends on the scheduling, so the results are sorted by path
+ *    at the end - the same tree always gives the same output.
+ */
+
+struct SearchOptions
+{
+    std::string pattern;
+    bool regex;
+    int dirThreads;
+    int searchThreads;
+    std::size_t mmapThreshold;
+
+    SearchOptions() : regex(false), dirThreads(4), searchThreads(4), mmapThreshold(64 * 1024) {}
+};
+
+struct LineMatch
+{
+    std::size_t line;       // 1 based
+    std::string text;       // without the '\n'
+};
+
+struct FileMatches
+{
+    std::string path;
+    std::vector<LineMatch> lines;
+};
+
+struct SearchReport
+{
+    std::vector<FileMatches> files;     // sorted by path
+    std::size_t filesScanned;
+    std::size_t binarySkipped;
+    std::size_t errors;
+    std::uint64_t bytesScanned;
+
+    SearchReport() : filesScanned(0), binarySkipped(0), errors(0), bytesScanned(0) {}
+
+    std::size_t matches() const
+    {
+        std::size_t n = 0;
+        for (const FileMatches& f : files)
+            n += f.lines.size();
+        return n;
+    }
+};
+
+constexpr std::size_t BINARY_PROBE = 8192;
+
+inline bool looksBinary(const char* data, std::size_t len)
+{
+    return std::memchr(data, 0, std::min(len, BINARY_PROBE)) != nullptr;
+}
+
+/// Finds the matching lines of one buffer.
+class LineMatcher
+{
+    std::string _literal;
+    bool _isRegex;
+    std::regex _regex;
+
+public:
+    explicit LineMatcher(const std::string& pattern, bool isRegex = false)
+        : _literal(pattern), _isRegex(isRegex)
+    {
+        if (_isRegex)
+            _regex = std::regex(pattern, std::regex::ECMAScript | std::regex::optimize);
+    }
+
+    void scan(const char* data, std::size_t len, std::vector<LineMatch>& out) const
+    {
+        const char* end = data + len;
+        const char* pos = data;         // where to search from
+        const char* counted = data;     // newlines counted up to here
+        std::size_t line = 1;
+
+        while (pos < end)
+        {
+            const char* lineBegin;
+            const char* lineEnd;
+            if (_isRegex)
+            {
+                lineBegin = pos;
+                lineEnd = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+                if (!lineEnd)
+                    lineEnd = end;
+                if (std::regex_search(lineBegin, lineEnd, _regex))
+                    out.push_back(LineMatch{ line, std::string(lineBegin, lineEnd) });
+                ++line;
+                pos = lineEnd + 1;
+                continue;
+            }
+
+            const char* hit = static_cast<const char*>(
+                ::memmem(pos, end - pos, _literal.data(), _literal.size()));
+            if (!hit)
+                break;
+
+            // the line around the hit
+            lineBegin = hit;
+            while (lineBegin > pos && lineBegin[-1] != '\n')
+                --lineBegin;
+            lineEnd = static_cast<const char*>(std::memchr(hit, '\n', end - hit));
+            if (!lineEnd)
+                lineEnd = end;
+
+            line += std::count(counted, lineBegin, '\n');
+            counted = lineBegin;
+            out.push_back(LineMatch{ line, std::string(lineBegin, lineEnd) });
+            pos = lineEnd + 1;
+        }
+    }
+};
+
+/// Scans one file. Returns false if it can't be read. binary is set for skipped binary files.
+inline bool searchFile(const std::string& path, const LineMatcher& matcher, std::size_t mmapThreshold,
+                       std::vector<char>& buffer, std::vector<LineMatch>& out, std::uint64_t& bytes, bool& binary)
+{
+    binary = false;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+    if (size == 0)
+    {
+        ::close(fd);
+        return true;
+    }
+
+    if (size >= mmapThreshold)
+    {
+        void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+            return false;
+        ::madvise(map, size, MADV_SEQUENTIAL);
+        const char* data = static_cast<const char*>(map);
+        binary = looksBinary(data, size);
+        if (!binary)
+        {
+            matcher.scan(data, size, out);
+            bytes += size;
+        }
+        ::munmap(map, size);
+        return true;
+    }
+
+    if (buffer.size() < size)
+        buffer.resize(size);
+    std::size_t got = 0;
+    while (got < size)
+    {
+        ssize_t n = ::read(fd, buffer.data() + got, size - got);
+        if (n <= 0)
+            break;
+        got += static_cast<std::size_t>(n);
+    }
+    ::close(fd);
+    binary = looksBinary(buffer.data(), got);
+    if (!binary)
+    {
+        matcher.scan(buffer.data(), got, out);
+        bytes += got;
+    }
+    return true;
+}
+
+/// The concurency7 servers: dirThreads list, searchThreads scan.
+inline SearchReport searchTree(const std::string& root, const SearchOptions& opt)
+{
+    LineMatcher matcher(opt.pattern, opt.regex);
+    MessageQueue<std::string> dirQueue;
+    MessageQueue<std::string> fileQueue;
+    std::atomic<int> pending(1);
+    dirQueue.send(std::string(root));
+
+    // every search server keeps its own results, merged at the end - no lock on the hot path
+    std::vector<SearchReport> partial(opt.searchThreads);
+    std::atomic<std::size_t> dirErrors(0);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < opt.dirThreads; ++i)
+    {
+        threads.push_back(std::thread([&]
+        {
+            Tracer::setThreadName("search dirServer");
+            std::vector<CrawlError> errors;     // only counted
+            for (;;)
+            {
+                std::string dir = dirQueue.recieve();
+                if (dir.empty())
+                    break;
+
+                TRACE_SCOPE("task", "search list dir");
+                // an entry which can't be stat'ed is counted and skipped, the rest of the directory is listed
+                forEachEntry(fs::path(dir), errors, CancellationToken(),
+                             [&](fs::path&& d)
+                             {
+                                 ++pending;
+                                 dirQueue.send(d.string());
+                             },
+                             [&](const fs::path& f, const struct stat& st)
+                             {
+                                 if (S_ISREG(st.st_mode))
+                                     fileQueue.send(f.string());
+                             });
+                dirErrors += errors.size();
+                errors.clear();
+
+                if (--pending == 0)
+                {
+                    for (int k = 0; k < opt.dirThreads; ++k)
+                        dirQueue.send(std::string());
+                    for (int k = 0; k < opt.searchThreads; ++k)
+                        fileQueue.send(std::string());
+                }
+            }
+        }));
+    }
+
+    for (int i = 0; i < opt.searchThreads; ++i)
+    {
+        threads.push_back(std::thread([&, i]
+        {
+            Tracer::setThreadName("search server");
+            SearchReport& mine = partial[i];
+            std::vector<char> buffer;
+            for (;;)
+            {
+                std::string file = fileQueue.recieve();
+                if (file.empty())
+                    break;
+
+                TRACE_SCOPE("task", "search file");
+                FileMatches fm;
+                bool binary;
+                if (!searchFile(file, matcher, opt.mmapThreshold, buffer, fm.lines, mine.bytesScanned, binary))
+                {
+                    ++mine.errors;
+                    continue;
+                }
+                ++mine.filesScanned;
+                if (binary)
+                    ++mine.binarySkipped;
+                if (!fm.lines.empty())
+                {
+                    fm.path = std::move(file);
+                    mine.files.push_back(std::move(fm));
+                }
+            }
+        }));
+    }
+
+    for (std::thread& t : threads)
+        t.join();
+
+    SearchReport report;
+    report.errors = dirErrors;
+    for (SearchReport& p : partial)
+    {
+        std::move(p.files.begin(), p.files.end(), std::back_inserter(report.files));
+        report.filesScanned += p.filesScanned;
+        report.binarySkipped += p.binarySkipped;
+        report.errors += p.errors;
+        report.bytesScanned += p.bytesScanned;
+    }
+    std::sort(report.files.begin(), report.files.end(),
+              [](const FileMatches& a, const FileMatches& b) { return a.path < b.path; });
+    return report;
+}
+
+#endif // CONCURENCY_CONTENT_SEARCH_H
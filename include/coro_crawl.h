@@ -0,0 +1,67 @@
+#ifndef CONCURENCY_CORO_CRAWL_H
+#define CONCURENCY_CORO_CRAWL_H
+
+#include <iterator>
+#include <string>
+#include <vector>
+#include "coro_task.h"
+#include "filesystem.h"
+#include "list_directory.h"
+
+/*
+ * The crawls of concurency4 and concurency5 as coroutines (include/coro_task.h).
+ *
+ * listDirectoryCoro is listDirectory with co_await instead of std::async + get(): every
+ * subdirectory is a child task, and while the children run the parent is a suspended frame,
+ * not a blocked thread. The whole tree runs on the few threads of the pool.
+ *
+ * walkTree streams the entries of a tree one by one - nothing is collected, the caller
+ * can stop after the first few.
+ */
+
+inline Task<string_vector> listDirectoryCoro(CoroPool& pool, std::string dir)
+{
+    string_vector listing;
+    std::string dirStr("\n> ");
+    dirStr += dir;
+    dirStr += ":\n\t ";
+    listing.push_back(dirStr);
+
+    std::vector<Task<string_vector>> children;
+    for (fs::directory_iterator it(dir); it != fs::directory_iterator(); ++it)
+    {
+        if (fs::is_directory(it->symlink_status()))
+            children.push_back(listDirectoryCoro(pool, it->path().string()));
+        else
+            listing.push_back(it->path().filename());
+    }
+
+    std::vector<string_vector> lists = co_await whenAll(pool, std::move(children));
+    for (string_vector& lst : lists)
+    {
+        std::copy(std::make_move_iterator(std::begin(lst)),
+                  std::make_move_iterator(std::end(lst)),
+                  std::back_inserter(listing));
+    }
+    co_return listing;
+}
+
+/// Every entry (files and directories) below root, depth first. Symlinks are not followed.
+inline Generator<fs::path> walkTree(std::string root)
+{
+    std::vector<fs::path> stack(1, fs::path(root));
+    while (!stack.empty())
+    {
+        fs::path dir = std::move(stack.back());
+        stack.pop_back();
+        for (fs::directory_iterator it(dir); it != fs::directory_iterator(); ++it)
+        {
+            fs::path p = it->path();
+            if (fs::is_directory(it->symlink_status()))
+                stack.push_back(p);
+            co_yield p;
+        }
+    }
+}
+
+#endif // CONCURENCY_CORO_CRAWL_H
@@ -0,0 +1,442 @@
+#ifndef CONCURENCY_CORO_TASK_H
+#define CONCURENCY_CORO_TASK_H
+
+#if __cplusplus < 202002L
+#error "coro_task.h needs C++20 coroutines - compile the target with -std=c++20"
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Coroutines instead of threads + futures.
+ *
+ * A task of concurency4 which waits for its children holds a whole thread (and its stack)
+ * while it does nothing. A coroutine which waits is just its frame on the heap - the
+ * locals, some hundred bytes - and the thread goes on with another one.
+ *
+ *   Task<T>       - a lazy coroutine: starts when it's co_awaited, the awaiting coroutine
+ *                   continues when it's done (symmetric transfer, no thread switch)
+ *   CoroPool      - N threads running the coroutines which are ready
+ *   whenAll       - runs tasks on the pool in parallel, resumes the caller after the last one
+ *   syncWait      - the bridge from a normal thread: runs a task on the pool and waits
+ *   Generator<T>  - co_yield values one by one to a range-for, e.g. to stream directory entries
+ *
+ *   Task<int> child(CoroPool& pool);
+ *   Task<int> parent(CoroPool& pool)
+ *   {
+ *       std::vector<Task<int>> children;
+ *       children.push_back(child(pool));
+ *       children.push_back(child(pool));
+ *       std::vector<int> r = co_await whenAll(pool, std::move(children));
+ *       co_return r[0] + r[1];
+ *   }
+ *   int x = syncWait(pool, parent(pool));
+ */
+
+class CoroPool
+{
+    std::deque<std::coroutine_handle<>> _ready;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    bool _stop;
+    std::vector<std::thread> _threads;
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::coroutine_handle<> h;
+            {
+                std::unique_lock<std::mutex> lck(_mutex);
+                _cond.wait(lck, [this] { return _stop || !_ready.empty(); });
+                if (_ready.empty())
+                    return;
+                h = _ready.front();
+                _ready.pop_front();
+            }
+            h.resume();
+        }
+    }
+
+public:
+    explicit CoroPool(unsigned threads = std::thread::hardware_concurrency()) : _stop(false)
+    {
+        if (threads == 0)
+            threads = 1;
+        for (unsigned i = 0; i < threads; ++i)
+            _threads.push_back(std::thread(&CoroPool::workerLoop, this));
+    }
+
+    ~CoroPool()
+    {
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            _stop = true;
+        }
+        _cond.notify_all();
+        for (std::thread& th : _threads)
+            th.join();
+    }
+
+    CoroPool(const CoroPool&) = delete;
+    CoroPool& operator=(const CoroPool&) = delete;
+
+    std::size_t threads() const { return _threads.size(); }
+
+    void post(std::coroutine_handle<> h)
+    {
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            _ready.push_back(h);
+        }
+        _cond.notify_one();
+    }
+
+    /// co_await pool.schedule() - continue on a thread of the pool.
+    auto schedule()
+    {
+        struct Awaiter
+        {
+            CoroPool& pool;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { pool.post(h); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{ *this };
+    }
+};
+
+namespace coro_detail
+{
+    /// When the task is done the awaiting coroutine continues on the same thread.
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            std::coroutine_handle<> next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    struct PromiseBase
+    {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() { error = std::current_exception(); }
+
+        void rethrow() const
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    };
+
+    /// A coroutine nobody waits for - starts right away and frees itself at the end.
+    struct Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object() const noexcept { return {}; }
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+    };
+}
+
+template<typename T = void>
+class Task
+{
+public:
+    struct promise_type : coro_detail::PromiseBase
+    {
+        std::optional<T> value;
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        void return_value(T v) { value.emplace(std::move(v)); }
+
+        T result()
+        {
+            rethrow();
+            return std::move(*value);
+        }
+    };
+
+private:
+    std::coroutine_handle<promise_type> _h;
+
+public:
+    explicit Task(std::coroutine_handle<promise_type> h) : _h(h) {}
+    Task(Task&& other) noexcept : _h(std::exchange(other._h, nullptr)) {}
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (_h)
+                _h.destroy();
+            _h = std::exchange(other._h, nullptr);
+        }
+        return *this;
+    }
+    ~Task()
+    {
+        if (_h)
+            _h.destroy();
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            std::coroutine_handle<promise_type> h;
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                h.promise().continuation = awaiting;
+                return h;
+            }
+            T await_resume() { return h.promise().result(); }
+        };
+        return Awaiter{ _h };
+    }
+};
+
+template<>
+class Task<void>
+{
+public:
+    struct promise_type : coro_detail::PromiseBase
+    {
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        void return_void() const noexcept {}
+        void result() const { rethrow(); }
+    };
+
+private:
+    std::coroutine_handle<promise_type> _h;
+
+public:
+    explicit Task(std::coroutine_handle<promise_type> h) : _h(h) {}
+    Task(Task&& other) noexcept : _h(std::exchange(other._h, nullptr)) {}
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (_h)
+                _h.destroy();
+            _h = std::exchange(other._h, nullptr);
+        }
+        return *this;
+    }
+    ~Task()
+    {
+        if (_h)
+            _h.destroy();
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            std::coroutine_handle<promise_type> h;
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                h.promise().continuation = awaiting;
+                return h;
+            }
+            void await_resume() { h.promise().result(); }
+        };
+        return Awaiter{ _h };
+    }
+};
+
+/// Counts the children of whenAll down, the last one resumes the waiting coroutine.
+class CoroLatch
+{
+    std::atomic<std::size_t> _count;    // children + the waiter
+    std::coroutine_handle<> _waiter;
+
+public:
+    explicit CoroLatch(std::size_t children) : _count(children + 1) {}
+
+    void arrive()
+    {
+        if (_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            _waiter.resume();
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    /// false - all the children are done already, don't suspend
+    bool await_suspend(std::coroutine_handle<> h) noexcept
+    {
+        _waiter = h;
+        return _count.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+
+    void await_resume() const noexcept {}
+};
+
+namespace coro_detail
+{
+    template<typename T>
+    Detached runChild(CoroPool& pool, Task<T> task, std::optional<T>& slot,
+                      std::exception_ptr& error, CoroLatch& latch)
+    {
+        co_await pool.schedule();
+        try
+        {
+            slot.emplace(co_await std::move(task));
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        latch.arrive();
+    }
+}
+
+/// Runs the tasks on the pool in parallel. The results in the order of the tasks,
+/// the first exception (by position) is rethrown when all of them are done.
+template<typename T>
+Task<std::vector<T>> whenAll(CoroPool& pool, std::vector<Task<T>> tasks)
+{
+    std::vector<std::optional<T>> slots(tasks.size());
+    std::vector<std::exception_ptr> errors(tasks.size());
+    if (!tasks.empty())
+    {
+        CoroLatch latch(tasks.size());
+        for (std::size_t i = 0; i < tasks.size(); ++i)
+            coro_detail::runChild(pool, std::move(tasks[i]), slots[i], errors[i], latch);
+        co_await latch;
+    }
+
+    for (std::exception_ptr& e : errors)
+    {
+        if (e)
+            std::rethrow_exception(e);
+    }
+    std::vector<T> results;
+    results.reserve(slots.size());
+    for (std::optional<T>& s : slots)
+        results.push_back(std::move(*s));
+    co_return results;
+}
+
+/// Runs the task on the pool, blocks the calling thread until it's done.
+/// Never call it on a thread of the pool.
+template<typename T>
+T syncWait(CoroPool& pool, Task<T> task)
+{
+    std::promise<T> prms;
+    std::future<T> ftr = prms.get_future();
+    // the promise lives in the coroutine frame - nothing of ours is touched after set_value
+    [](CoroPool& pool, Task<T> task, std::promise<T> prms) -> coro_detail::Detached
+    {
+        co_await pool.schedule();
+        try
+        {
+            if constexpr (std::is_void<T>::value)
+            {
+                co_await std::move(task);
+                prms.set_value();
+            }
+            else
+                prms.set_value(co_await std::move(task));
+        }
+        catch (...)
+        {
+            prms.set_exception(std::current_exception());
+        }
+    }(pool, std::move(task), std::move(prms));
+    return ftr.get();
+}
+
+/// Lazy sequence: the coroutine runs until its next co_yield whenever the loop wants a value.
+template<typename T>
+class Generator
+{
+public:
+    struct promise_type
+    {
+        T* current = nullptr;
+        std::exception_ptr error;
+
+        Generator get_return_object() { return Generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        std::suspend_always final_suspend() const noexcept { return {}; }
+        std::suspend_always yield_value(T& v) noexcept { current = &v; return {}; }
+        std::suspend_always yield_value(T&& v) noexcept { current = &v; return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    struct Sentinel {};
+
+    class Iterator
+    {
+        std::coroutine_handle<promise_type> _h;
+
+    public:
+        explicit Iterator(std::coroutine_handle<promise_type> h) : _h(h) {}
+
+        T& operator*() const { return *_h.promise().current; }
+
+        Iterator& operator++()
+        {
+            _h.resume();
+            if (_h.done() && _h.promise().error)
+                std::rethrow_exception(_h.promise().error);
+            return *this;
+        }
+
+        bool operator==(Sentinel) const { return _h.done(); }
+        bool operator!=(Sentinel) const { return !_h.done(); }
+    };
+
+private:
+    std::coroutine_handle<promise_type> _h;
+
+public:
+    explicit Generator(std::coroutine_handle<promise_type> h) : _h(h) {}
+    Generator(Generator&& other) noexcept : _h(std::exchange(other._h, nullptr)) {}
+    Generator(const Generator&) = delete;
+    ~Generator()
+    {
+        if (_h)
+            _h.destroy();
+    }
+
+    Iterator begin()
+    {
+        Iterator it(_h);
+        ++it;
+        return it;
+    }
+
+    Sentinel end() const { return {}; }
+};
+
+#endif // CONCURENCY_CORO_TASK_H
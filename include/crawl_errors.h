@@ -0,0 +1,176 @@
+#ifndef CONCURENCY_CRAWL_ERRORS_H
+#define CONCURENCY_CRAWL_ERRORS_H
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <cerrno>
+#include <sys/stat.h>
+#include "cancellation.h"
+#include "filesystem.h"
+#include "walk_policy.h"
+
+/*
+ * Errors of a crawl are data, not exceptions.
+ *
+ * A directory we may not read (EACCES), an entry deleted between readdir and stat (ENOENT)
+ * or a symlink loop (ELOOP) is normal on a real disk. When they were thrown, a std::system_error
+ * from one task left the barrier of concurency5 and the results of the rest of the batch were
+ * dropped; in concurency7 it ended a server loop for good and the crawl never finished.
+ *
+ * forEachEntry lists a directory with the error_code overloads and lstat: an entry which
+ * fails is recorded and skipped, the listing goes on. The errors of a directory are collected in a
+ * vector and merged into an ErrorTable once - per error code a count, and the first paths
+ * as examples, so a tree with a million unreadable directories doesn't need a million strings.
+ */
+
+struct CrawlError
+{
+    std::string path;
+    std::error_code code;
+};
+
+class ErrorTable
+{
+    std::map<std::error_code, std::size_t> _counts;
+    std::vector<CrawlError> _samples;
+    std::size_t _maxSamples;
+    std::size_t _total;
+    mutable std::mutex _mutex;
+
+public:
+    explicit ErrorTable(std::size_t maxSamples = 64) : _maxSamples(maxSamples), _total(0) {}
+
+    ErrorTable(const ErrorTable&) = delete;
+    ErrorTable& operator=(const ErrorTable&) = delete;
+
+    void add(CrawlError&& error)
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        ++_counts[error.code];
+        ++_total;
+        if (_samples.size() < _maxSamples)
+            _samples.push_back(std::move(error));
+    }
+
+    /// All the errors of one directory at once, the vector is left empty.
+    void add(std::vector<CrawlError>& errors)
+    {
+        if (errors.empty())
+            return;
+        std::lock_guard<std::mutex> lck(_mutex);
+        for (CrawlError& e : errors)
+        {
+            ++_counts[e.code];
+            ++_total;
+            if (_samples.size() < _maxSamples)
+                _samples.push_back(std::move(e));
+        }
+        errors.clear();
+    }
+
+    std::size_t total() const
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _total;
+    }
+
+    std::size_t count(std::errc code) const
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        auto it = _counts.find(std::make_error_code(code));
+        return it == _counts.end() ? 0 : it->second;
+    }
+
+    std::map<std::error_code, std::size_t> counts() const
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _counts;
+    }
+
+    /// The first maxSamples errors with their paths.
+    std::vector<CrawlError> samples() const
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _samples;
+    }
+
+    /// count  error, then the example paths
+    void print(std::ostream& os) const
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        if (_total == 0)
+            return;
+        os << _total << " errors:\n";
+        for (const auto& c : _counts)
+            os << "  " << c.second << "\t" << c.first.message() << "\n";
+        for (const CrawlError& e : _samples)
+            os << "    " << e.path << ": " << e.code.message() << "\n";
+        if (_total > _samples.size())
+            os << "    ... " << _total - _samples.size() << " more\n";
+    }
+};
+
+/// Lists dir: onDir(fs::path&&) for the subdirectories, onFile(const fs::path&, const struct stat&)
+/// for the rest - the stat is there already, the size costs nothing.
+/// Errors are appended to errors, only OperationCancelled is thrown.
+///  - the directory can't be opened or read (EACCES, ENOENT when it's gone) - one error for it
+///  - an entry which disappeared meanwhile (ENOENT) is an error and skipped
+///  - a symlink is a file, unless walk follows symlinks: then a link to a directory is the
+///    directory, a dangling link is still a file and a link loop (ELOOP) an error
+///  - with a walk policy a directory is listed only when walk->enter() lets it (include/walk_policy.h)
+template<typename OnDir, typename OnFile>
+void forEachEntry(const fs::path& dir, std::vector<CrawlError>& errors, const CancellationToken& token,
+                  WalkPolicy* walk, OnDir onDir, OnFile onFile)
+{
+    bool follow = walk && walk->followSymlinks();
+    std::error_code ec;
+    fs::directory_iterator it(dir, ec), end;
+    for (; !ec && it != end; it.increment(ec))
+    {
+        token.throwIfCancelled();
+        const fs::path& p = it->path();
+        struct stat st;
+        if (::lstat(p.c_str(), &st) != 0)
+        {
+            errors.push_back(CrawlError{ p.string(), std::error_code(errno, std::generic_category()) });
+            continue;
+        }
+        struct stat target;
+        if (S_ISLNK(st.st_mode) && follow)
+        {
+            if (::stat(p.c_str(), &target) == 0)
+                st = target;
+            else if (errno != ENOENT)
+            {
+                errors.push_back(CrawlError{ p.string(), std::error_code(errno, std::generic_category()) });
+                continue;
+            }
+            // else a dangling symlink - the link itself is the file
+        }
+        if (S_ISDIR(st.st_mode))
+        {
+            if (!walk || walk->enter(st))
+                onDir(fs::path(p));
+        }
+        else
+            onFile(p, st);
+    }
+    if (ec)
+        errors.push_back(CrawlError{ dir.string(), ec });
+}
+
+/// Physical walk - symlinks are files.
+template<typename OnDir, typename OnFile>
+void forEachEntry(const fs::path& dir, std::vector<CrawlError>& errors, const CancellationToken& token,
+                  OnDir onDir, OnFile onFile)
+{
+    forEachEntry(dir, errors, token, nullptr, onDir, onFile);
+}
+
+#endif // CONCURENCY_CRAWL_ERRORS_H
@@ -0,0 +1,39 @@
+#ifndef CONCURENCY_CRAWL_HOOKS_H
+#define CONCURENCY_CRAWL_HOOKS_H
+
+#include "crawl_errors.h"
+#include "crawl_progress.h"
+#include "file_index.h"
+#include "sorted_output.h"
+#include "walk_policy.h"
+
+/*
+ * What a crawl reports into besides the list of files, for listAllFiles (include/batched_crawl.h)
+ * and listAllFilesShared (include/monitor_crawl.h) alike. Every hook is optional - a null
+ * pointer is not used - and belongs to the caller, shared by all the tasks of the crawl:
+ *
+ *  progress - every task adds its directory (include/crawl_progress.h)
+ *  errors   - what couldn't be read, merged per error code (include/crawl_errors.h)
+ *  walk     - follow symlinks, stay on one file system (include/walk_policy.h)
+ *  index    - path -> size of every file (include/file_index.h)
+ *  sorted   - the full paths as sorted runs, merged after the crawl: the i-th task of a batch
+ *             collects into the i-th RunBuffer of the crawl (include/sorted_output.h)
+ *
+ *   CrawlHooks hooks;
+ *   hooks.errors = &errors;
+ *   hooks.index = &index;
+ *   listAllFiles(root, 8, token, executor, hooks);
+ */
+
+struct CrawlHooks
+{
+    CrawlProgress* progress;
+    ErrorTable* errors;
+    WalkPolicy* walk;
+    FileIndex* index;
+    SortedRuns* sorted;
+
+    CrawlHooks() : progress(nullptr), errors(nullptr), walk(nullptr), index(nullptr), sorted(nullptr) {}
+};
+
+#endif // CONCURENCY_CRAWL_HOOKS_H
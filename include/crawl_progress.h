@@ -0,0 +1,236 @@
+#ifndef CONCURENCY_CRAWL_PROGRESS_H
+#define CONCURENCY_CRAWL_PROGRESS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "cache_line.h"
+
+/*
+ * Progress of a long crawl while it runs.
+ *
+ * concurency5 and concurency6 print one number at the end. For a crawl of hours we'd like to
+ * see how far it got. The counters must cost (next to) nothing:
+ *
+ *  - every thread adds to its own slot - a cache line of its own, so the threads never
+ *    take the line away from each other. The atomics are relaxed and in practice uncontended.
+ *  - a task counts a directory locally and adds the whole directory at once (add()), not
+ *    every file - a handful of adds per directory.
+ *  - snapshot() sums the slots on demand, only the reader pays for it.
+ *
+ * ProgressReporter is a thread which prints the snapshot, the rate and an ETA every interval.
+ * Nobody knows the size of the tree in advance; the ETA is the time to list the directories
+ * found but not listed yet at the current directory rate - it grows while new subtrees turn up.
+ *
+ *   CrawlProgress progress;
+ *   ProgressReporter reporter(progress, std::chrono::seconds(1), std::cerr);
+ *   CrawlHooks hooks;
+ *   hooks.progress = &progress;
+ *   auto files = listAllFiles(root, 8, token, executor, hooks);
+ */
+
+struct ProgressCounts
+{
+    std::uint64_t dirsFound;     // root + every subdirectory seen
+    std::uint64_t dirsListed;
+    std::uint64_t files;
+    std::uint64_t bytes;         // only the crawls which read the files fill it
+    std::uint64_t errors;
+
+    ProgressCounts() : dirsFound(0), dirsListed(0), files(0), bytes(0), errors(0) {}
+};
+
+class CrawlProgress
+{
+    struct Slot
+    {
+        std::atomic<std::uint64_t> dirsFound;
+        std::atomic<std::uint64_t> dirsListed;
+        std::atomic<std::uint64_t> files;
+        std::atomic<std::uint64_t> bytes;
+        std::atomic<std::uint64_t> errors;
+        // two lines: std::vector doesn't align the slots to a line, with the padding the
+        // counters of two slots are still more than a line apart
+        char pad[2 * CACHE_LINE_SIZE - 5 * sizeof(std::atomic<std::uint64_t>)];
+    };
+
+    std::vector<Slot> _slots;
+
+    /// The threads are dealt out round robin. With more threads than slots two of them share
+    /// a slot - still correct, just not free of sharing anymore.
+    Slot& mySlot()
+    {
+        static std::atomic<unsigned> nextThread(0);
+        static thread_local unsigned thread = nextThread++;
+        return _slots[thread % _slots.size()];
+    }
+
+    static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t n)
+    {
+        if (n)
+            counter.fetch_add(n, std::memory_order_relaxed);
+    }
+
+public:
+    explicit CrawlProgress(unsigned slots = 64) : _slots(slots ? slots : 1)
+    {
+        for (Slot& s : _slots)
+        {
+            s.dirsFound.store(0, std::memory_order_relaxed);
+            s.dirsListed.store(0, std::memory_order_relaxed);
+            s.files.store(0, std::memory_order_relaxed);
+            s.bytes.store(0, std::memory_order_relaxed);
+            s.errors.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    CrawlProgress(const CrawlProgress&) = delete;
+    CrawlProgress& operator=(const CrawlProgress&) = delete;
+
+    /// A directory is listed: subdirs found in it, files, bytes of them and errors.
+    void add(std::uint64_t subdirs, std::uint64_t files, std::uint64_t bytes = 0, std::uint64_t errors = 0)
+    {
+        Slot& s = mySlot();
+        s.dirsListed.fetch_add(1, std::memory_order_relaxed);
+        bump(s.dirsFound, subdirs);
+        bump(s.files, files);
+        bump(s.bytes, bytes);
+        bump(s.errors, errors);
+    }
+
+    /// The crawl starts at a directory (or finds one some other way).
+    void addRoot()
+    {
+        mySlot().dirsFound.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void addError()
+    {
+        mySlot().errors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// The sum of the slots. Taken while the crawl runs it is a moment of every slot,
+    /// not of the crawl as a whole - good enough for a progress line.
+    ProgressCounts snapshot() const
+    {
+        ProgressCounts c;
+        for (const Slot& s : _slots)
+        {
+            c.dirsFound += s.dirsFound.load(std::memory_order_relaxed);
+            c.dirsListed += s.dirsListed.load(std::memory_order_relaxed);
+            c.files += s.files.load(std::memory_order_relaxed);
+            c.bytes += s.bytes.load(std::memory_order_relaxed);
+            c.errors += s.errors.load(std::memory_order_relaxed);
+        }
+        return c;
+    }
+};
+
+/// Prints a progress line every interval (at least 1 ms) until it is destroyed, then the final one.
+class ProgressReporter
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const CrawlProgress& _progress;
+    std::chrono::milliseconds _interval;
+    std::ostream& _os;
+    Clock::time_point _start;
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    bool _stop;
+    std::thread _thread;
+
+    void print(const ProgressCounts& now, const ProgressCounts& before, double seconds, double total, bool last)
+    {
+        double dirRate = seconds > 0 ? (now.dirsListed - before.dirsListed) / seconds : 0.0;
+        double fileRate = seconds > 0 ? (now.files - before.files) / seconds : 0.0;
+        std::uint64_t left = now.dirsFound > now.dirsListed ? now.dirsFound - now.dirsListed : 0;
+
+        // formatted aside - the stream's own flags stay as they are
+        std::ostringstream line;
+        line << "\r" << std::fixed << std::setprecision(1) << total << " s: "
+             << now.dirsListed << "/" << now.dirsFound << " dirs, " << now.files << " files, ";
+        if (now.bytes)
+            line << now.bytes / (1024 * 1024) << " MiB, ";
+        line << now.errors << " errors | " << std::setprecision(0) << dirRate << " dirs/s "
+             << fileRate << " files/s";
+        if (!last)
+        {
+            if (dirRate > 0)
+                line << ", ETA " << std::setprecision(1) << left / dirRate << " s  ";
+            else
+                line << ", ETA ?  ";
+        }
+        else
+            line << "\n";
+        _os << line.str();
+        _os.flush();
+    }
+
+    void loop()
+    {
+        ProgressCounts before = _progress.snapshot();
+        Clock::time_point last = _start;
+        std::unique_lock<std::mutex> lck(_mutex);
+        while (!_cond.wait_for(lck, _interval, [this] { return _stop; }))
+        {
+            Clock::time_point t = Clock::now();
+            ProgressCounts now = _progress.snapshot();
+            print(now, before, std::chrono::duration<double>(t - last).count(),
+                  std::chrono::duration<double>(t - _start).count(), false);
+            before = now;
+            last = t;
+        }
+        // the last line shows the average over the whole crawl
+        double total = std::chrono::duration<double>(Clock::now() - _start).count();
+        print(_progress.snapshot(), ProgressCounts(), total, total, true);
+    }
+
+public:
+    ProgressReporter(const CrawlProgress& progress, std::chrono::milliseconds interval, std::ostream& os)
+        : _progress(progress), _interval(std::max(interval, std::chrono::milliseconds(1))),
+          _os(os), _start(Clock::now()), _stop(false)
+    {
+        _thread = std::thread(&ProgressReporter::loop, this);
+    }
+
+    ~ProgressReporter()
+    {
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            _stop = true;
+        }
+        _cond.notify_all();
+        _thread.join();
+    }
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+};
+
+/// The interval of a ProgressReporter in ms (CONCURENCY_PROGRESS of concurency5 / concurency6).
+/// False for anything but a positive number - atol would make "0" or "abc" an interval of 0,
+/// a line after line on stderr.
+inline bool parseProgressInterval(const char* text, std::chrono::milliseconds& interval)
+{
+    char* end = nullptr;
+    errno = 0;
+    long long value = std::strtoll(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || value <= 0)
+        return false;
+    interval = std::chrono::milliseconds(value);
+    return true;
+}
+
+#endif // CONCURENCY_CRAWL_PROGRESS_H
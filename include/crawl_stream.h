@@ -0,0 +1,254 @@
+#ifndef CONCURENCY_CRAWL_STREAM_H
+#define CONCURENCY_CRAWL_STREAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "bounded_queue.h"
+#include "cancellation.h"
+#include "crawl_errors.h"
+#include "filesystem.h"
+#include "message_queue.h"
+#include "trace.h"
+
+/*
+ * Crawl results as a stream.
+ *
+ * listDirectory (concurency4) and listAllFiles (concurency5) hand over the files when the
+ * whole tree is done - the consumer waits for the slowest directory and the complete
+ * vector sits in memory. CrawlStream gives the files out while the workers still crawl:
+ *
+ *   pull, batch by batch          pull, file by file             push
+ *   CrawlStream s(root);          CrawlStream s(root);           crawlEach(root, [](std::vector<std::string>& b)
+ *   std::vector<std::string> b;   for (const std::string& f : s)  {
+ *   while (s.next(b))                 use(f);                         use(b);
+ *       use(b);                                                   });
+ *
+ * The workers are concurency7 style dir servers. Every directory's files go out as soon as it
+ * is listed, in batches of at most batchSize. Between the workers and the consumer there is
+ * a BoundedQueue of maxBatches batches: a slow consumer holds the workers back, so no more
+ * than maxBatches * batchSize paths wait in memory however big the tree is.
+ *
+ * The consumer can leave early - the destructor cancels the crawl and joins the workers.
+ * A cancelled token (or a deadline) ends the stream with OperationCancelled from next().
+ */
+
+struct StreamOptions
+{
+    int workers;
+    std::size_t batchSize;
+    std::size_t maxBatches;
+
+    StreamOptions() : workers(4), batchSize(256), maxBatches(16) {}
+};
+
+class CrawlStream
+{
+    typedef std::vector<std::string> Batch;
+
+    StreamOptions _opt;
+    CancellationToken _userToken;
+    CancellationSource _source;         // child of the user's token, cancelled by the destructor
+    MessageQueue<std::string> _dirs;
+    BoundedQueue<Batch> _out;
+
+    std::atomic<int> _pending;          // directories sent but not listed yet
+    std::atomic<int> _running;          // workers; the last one closes _out
+    std::atomic<std::size_t> _buffered; // paths in _out
+    std::atomic<std::size_t> _peakBuffered;
+    std::atomic<std::size_t> _errors;
+    std::vector<std::thread> _workers;
+
+    bool flush(Batch& batch)
+    {
+        if (batch.empty())
+            return true;
+        std::size_t n = batch.size();
+        std::size_t now = _buffered.fetch_add(n) + n;
+        std::size_t peak = _peakBuffered.load();
+        while (now > peak && !_peakBuffered.compare_exchange_weak(peak, now))
+        {
+        }
+        bool sent = _out.send(std::move(batch));
+        batch = Batch();
+        batch.reserve(_opt.batchSize);
+        return sent;
+    }
+
+    void worker(CancellationToken token)
+    {
+        Tracer::setThreadName("CrawlStream worker");
+        Batch batch;
+        batch.reserve(_opt.batchSize);
+        std::vector<CrawlError> errors;     // only counted
+        bool stop = false;
+        while (!stop)
+        {
+            std::string dir;
+            try
+            {
+                dir = _dirs.recieve(token);
+            }
+            catch (OperationCancelled&)
+            {
+                break;
+            }
+            if (dir.empty())
+                break;
+
+            {
+                TRACE_SCOPE("task", "CrawlStream list dir");
+                // an entry which can't be stat'ed is counted and skipped, the rest of the directory is listed
+                try
+                {
+                    forEachEntry(fs::path(dir), errors, token,
+                                 [&](fs::path&& d)
+                                 {
+                                     ++_pending;
+                                     _dirs.send(d.string());
+                                 },
+                                 [&](const fs::path& f, const struct stat&)
+                                 {
+                                     batch.push_back(f.string());
+                                     // the consumer is gone - the rest of the directory isn't needed
+                                     if (batch.size() >= _opt.batchSize && !flush(batch))
+                                         throw OperationCancelled();
+                                 });
+                }
+                catch (OperationCancelled&)
+                {
+                    stop = true;
+                }
+                _errors += errors.size();
+                errors.clear();
+                // the files of this directory go out now, not when some batch happens to be full
+                if (!stop)
+                    stop = !flush(batch);
+            }
+
+            if (--_pending == 0)
+            {
+                for (int i = 0; i < _opt.workers; ++i)
+                    _dirs.send(std::string());
+            }
+        }
+        if (--_running == 0)
+            _out.close();
+    }
+
+public:
+    explicit CrawlStream(const std::string& root, const StreamOptions& opt = StreamOptions(),
+                         const CancellationToken& token = CancellationToken())
+        : _opt(opt), _userToken(token), _source(token), _out(opt.maxBatches),
+          _pending(1), _running(0), _buffered(0), _peakBuffered(0), _errors(0)
+    {
+        if (_opt.workers < 1)
+            _opt.workers = 1;
+        if (_opt.batchSize < 1)
+            _opt.batchSize = 1;
+        _running = _opt.workers;
+        _dirs.send(std::string(root));
+        for (int i = 0; i < _opt.workers; ++i)
+            _workers.push_back(std::thread(&CrawlStream::worker, this, _source.token()));
+    }
+
+    /// Leaving early stops the crawl.
+    ~CrawlStream()
+    {
+        _source.cancel();
+        _out.close();
+        for (std::thread& t : _workers)
+            t.join();
+    }
+
+    CrawlStream(const CrawlStream&) = delete;
+    CrawlStream& operator=(const CrawlStream&) = delete;
+
+    /// The next batch of paths, waits for one. false at the end of the tree.
+    bool next(Batch& batch)
+    {
+        if (!_out.recieve(batch))
+        {
+            _userToken.throwIfCancelled();
+            return false;
+        }
+        _buffered -= batch.size();
+        return true;
+    }
+
+    /// Most paths which waited for the consumer at once.
+    std::size_t peakBuffered() const { return _peakBuffered; }
+    /// Directories which couldn't be listed (completely).
+    std::size_t errors() const { return _errors; }
+
+    /// Input iterator over the single paths.
+    class Iterator
+    {
+        CrawlStream* _stream;
+        Batch _batch;
+        std::size_t _pos;
+
+        /// Replaces the consumed batch with the next one.
+        void fill()
+        {
+            _pos = 0;
+            _batch.clear();
+            while (_stream && _batch.empty())
+            {
+                if (!_stream->next(_batch))
+                    _stream = nullptr;
+            }
+        }
+
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef std::string value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const std::string* pointer;
+        typedef const std::string& reference;
+
+        Iterator() : _stream(nullptr), _pos(0) {}
+        explicit Iterator(CrawlStream* stream) : _stream(stream), _pos(0) { fill(); }
+
+        const std::string& operator*() const { return _batch[_pos]; }
+        const std::string* operator->() const { return &_batch[_pos]; }
+
+        Iterator& operator++()
+        {
+            if (++_pos >= _batch.size())
+                fill();
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const { return _stream == other._stream && (!_stream || _pos == other._pos); }
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+    };
+
+    /// One pass only - the stream is consumed.
+    Iterator begin() { return Iterator(this); }
+    Iterator end() { return Iterator(); }
+};
+
+/// Push: onBatch(std::vector<std::string>&) is called in the calling thread for every batch.
+/// Returns the number of paths.
+template<typename F>
+std::size_t crawlEach(const std::string& root, F onBatch, const StreamOptions& opt = StreamOptions(),
+                      const CancellationToken& token = CancellationToken())
+{
+    CrawlStream stream(root, opt, token);
+    std::vector<std::string> batch;
+    std::size_t n = 0;
+    while (stream.next(batch))
+    {
+        n += batch.size();
+        onBatch(batch);
+    }
+    return n;
+}
+
+#endif // CONCURENCY_CRAWL_STREAM_H
@@ -0,0 +1,304 @@
+#ifndef CONCURENCY_DUPLICATE_FINDER_H
+#define CONCURENCY_DUPLICATE_FINDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bounded_queue.h"
+#include "cancellation.h"
+#include "crawl_errors.h"
+#include "filesystem.h"
+#include "hash64.h"
+#include "message_queue.h"
+#include "trace.h"
+
+/*
+ * Duplicate files - a pipeline on top of the crawl.
+ *
+ * Hashing every file of a big tree is the expensive part, so each stage throws away
+ * what can't be a duplicate before the next, more expensive one:
+ *
+ *   crawl ---> by size ---> prefix hash ---> by prefix ---> full hash ---> groups
+ *  (N threads)  (1 thread)  (N threads)      (1 thread)     (N threads)    (caller)
+ *
+ *  1. crawl        - concurency7 style dir servers, emit every regular file with its size
+ *  2. by size      - a file with a size nobody else has is unique. A size group is passed on
+ *                    once it has a second member (then every further member right away)
+ *  3. prefix hash  - hash of the first 4 KB (one pread)
+ *  4. by prefix    - the same for (size, prefix hash). Files no bigger than the prefix
+ *                    are already fully hashed and skip stage 5
+ *  5. full hash    - mmap the file and hash it all
+ *  6. groups       - (size, full hash) with two or more files are the duplicates
+ *
+ * The stages are connected by BoundedQueues: a slow stage holds the ones before it back
+ * instead of letting the queues eat the memory. Every stage closes its output queue
+ * when the last of its threads is done, so the end of the crawl flows down the pipe.
+ */
+
+struct DuplicateOptions
+{
+    int crawlThreads;
+    int prefixThreads;
+    int hashThreads;
+    std::size_t queueCapacity;
+    std::size_t prefixBytes;
+
+    DuplicateOptions() : crawlThreads(4), prefixThreads(4), hashThreads(4), queueCapacity(1024), prefixBytes(4096) {}
+};
+
+struct DuplicateReport
+{
+    std::vector<std::vector<std::string>> groups;   // files with the same content
+
+    std::size_t files;              // regular files found
+    std::size_t sizeCandidates;     // passed the size stage
+    std::size_t prefixCandidates;   // passed the prefix stage
+    std::uint64_t bytesHashed;      // prefix + full hashing
+    std::size_t errors;             // files which couldn't be read
+
+    DuplicateReport() : files(0), sizeCandidates(0), prefixCandidates(0), bytesHashed(0), errors(0) {}
+
+    std::size_t duplicateFiles() const
+    {
+        std::size_t n = 0;
+        for (const auto& g : groups)
+            n += g.size();
+        return n;
+    }
+};
+
+class DuplicateFinder
+{
+    struct FileEntry
+    {
+        std::string path;
+        std::uint64_t size;
+        std::uint64_t hash;     // prefix hash, then full hash
+    };
+
+    typedef std::pair<std::uint64_t, std::uint64_t> Key;   // (size, hash)
+
+    DuplicateOptions _opt;
+    BoundedQueue<FileEntry> _sized;     // crawl -> by size
+    BoundedQueue<FileEntry> _toPrefix;  // by size -> prefix hash
+    BoundedQueue<FileEntry> _prefixed;  // prefix hash -> by prefix
+    BoundedQueue<FileEntry> _toHash;    // by prefix -> full hash
+    BoundedQueue<FileEntry> _hashed;    // full hash (and small files) -> groups
+
+    std::atomic<std::size_t> _files;
+    std::atomic<std::uint64_t> _bytesHashed;
+    std::atomic<std::size_t> _errors;
+    std::size_t _sizeCandidates;
+    std::size_t _prefixCandidates;
+
+    /// Runs n threads of a stage, the last one to finish calls done (closes the stage's output).
+    template<typename Done, typename F>
+    static void stage(std::vector<std::thread>& threads, int n, Done done, F body)
+    {
+        std::shared_ptr<std::atomic<int>> running = std::make_shared<std::atomic<int>>(n);
+        for (int i = 0; i < n; ++i)
+        {
+            threads.push_back(std::thread([running, done, body]
+            {
+                body();
+                if (running->fetch_sub(1) == 1)
+                    done();
+            }));
+        }
+    }
+
+    // ---- 1. crawl ----
+    void crawl(MessageQueue<std::string>& dirs, std::atomic<int>& pending)
+    {
+        std::vector<CrawlError> errors;     // only counted
+        for (;;)
+        {
+            std::string dir = dirs.recieve();
+            if (dir.empty())
+                return;
+            {
+                TRACE_SCOPE("task", "DuplicateFinder crawl");
+                // an entry which can't be stat'ed is counted and skipped, the rest of the directory is listed
+                forEachEntry(fs::path(dir), errors, CancellationToken(),
+                             [&](fs::path&& d)
+                             {
+                                 pending.fetch_add(1);
+                                 dirs.send(d.string());
+                             },
+                             [&](const fs::path& f, const struct stat& st)
+                             {
+                                 if (!S_ISREG(st.st_mode))
+                                     return;
+                                 ++_files;
+                                 _sized.send(FileEntry{ f.string(), static_cast<std::uint64_t>(st.st_size), 0 });
+                             });
+                _errors += errors.size();
+                errors.clear();
+            }
+            // the last directory stops all the crawlers
+            if (pending.fetch_sub(1) == 1)
+            {
+                for (int i = 0; i < _opt.crawlThreads; ++i)
+                    dirs.send(std::string());
+            }
+        }
+    }
+
+    /// Stages 2 and 4: pass on the members of groups with two or more files.
+    void groupBy(BoundedQueue<FileEntry>& in, BoundedQueue<FileEntry>& out,
+                 BoundedQueue<FileEntry>* done, bool useHash, std::size_t& candidates)
+    {
+        std::map<Key, FileEntry> firstOfGroup;   // groups with a single file so far
+        std::set<Key> seenTwice;
+        FileEntry e;
+        while (in.recieve(e))
+        {
+            Key key(e.size, useHash ? e.hash : 0);
+            // small files are fully hashed already
+            BoundedQueue<FileEntry>& to = (done && e.size <= _opt.prefixBytes) ? *done : out;
+
+            if (seenTwice.count(key))
+            {
+                ++candidates;
+                to.send(std::move(e));
+                continue;
+            }
+            auto it = firstOfGroup.find(key);
+            if (it == firstOfGroup.end())
+            {
+                firstOfGroup.insert(std::make_pair(key, std::move(e)));
+                continue;
+            }
+            candidates += 2;
+            to.send(std::move(it->second));
+            to.send(std::move(e));
+            firstOfGroup.erase(it);
+            seenTwice.insert(key);
+        }
+    }
+
+    bool readPrefix(FileEntry& e)
+    {
+        int fd = ::open(e.path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        std::vector<unsigned char> buffer(_opt.prefixBytes);
+        ssize_t n = ::pread(fd, buffer.data(), buffer.size(), 0);
+        ::close(fd);
+        if (n < 0)
+            return false;
+        e.hash = hash64(buffer.data(), static_cast<std::size_t>(n));
+        _bytesHashed += static_cast<std::uint64_t>(n);
+        return true;
+    }
+
+    bool readFull(FileEntry& e)
+    {
+        int fd = ::open(e.path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        std::size_t len = static_cast<std::size_t>(st.st_size);
+        void* data = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+            return false;
+        ::madvise(data, len, MADV_SEQUENTIAL);
+        e.hash = hash64(data, len);
+        ::munmap(data, len);
+        _bytesHashed += len;
+        return true;
+    }
+
+    void hashStage(BoundedQueue<FileEntry>& in, BoundedQueue<FileEntry>& out, bool full)
+    {
+        FileEntry e;
+        while (in.recieve(e))
+        {
+            TRACE_SCOPE("task", full ? "DuplicateFinder full hash" : "DuplicateFinder prefix hash");
+            if (full ? readFull(e) : readPrefix(e))
+                out.send(std::move(e));
+            else
+                ++_errors;
+        }
+    }
+
+public:
+    explicit DuplicateFinder(const DuplicateOptions& opt = DuplicateOptions())
+        : _opt(opt), _sized(opt.queueCapacity), _toPrefix(opt.queueCapacity), _prefixed(opt.queueCapacity),
+          _toHash(opt.queueCapacity), _hashed(opt.queueCapacity),
+          _files(0), _bytesHashed(0), _errors(0), _sizeCandidates(0), _prefixCandidates(0)
+    {
+    }
+
+    /// Runs the whole pipeline once. A finder is good for one run.
+    DuplicateReport run(const std::string& root)
+    {
+        std::vector<std::thread> threads;
+
+        MessageQueue<std::string> dirs;
+        std::atomic<int> pending(1);
+        dirs.send(std::string(root));
+
+        stage(threads, _opt.crawlThreads, [this] { _sized.close(); },
+              [this, &dirs, &pending] { crawl(dirs, pending); });
+        stage(threads, 1, [this] { _toPrefix.close(); },
+              [this] { groupBy(_sized, _toPrefix, nullptr, false, _sizeCandidates); });
+        stage(threads, _opt.prefixThreads, [this] { _prefixed.close(); },
+              [this] { hashStage(_toPrefix, _prefixed, false); });
+
+        // stage 4 (small files) and stage 5 both feed the groups - closed when both are done
+        std::shared_ptr<std::atomic<int>> writers = std::make_shared<std::atomic<int>>(2);
+        auto writerDone = [this, writers] { if (writers->fetch_sub(1) == 1) _hashed.close(); };
+        stage(threads, 1, [this, writerDone] { _toHash.close(); writerDone(); },
+              [this] { groupBy(_prefixed, _toHash, &_hashed, true, _prefixCandidates); });
+        stage(threads, _opt.hashThreads, writerDone,
+              [this] { hashStage(_toHash, _hashed, true); });
+
+        // ---- 6. groups ----
+        std::map<Key, std::vector<std::string>> byContent;
+        FileEntry e;
+        while (_hashed.recieve(e))
+            byContent[Key(e.size, e.hash)].push_back(std::move(e.path));
+
+        for (std::thread& t : threads)
+            t.join();
+
+        DuplicateReport report;
+        for (auto& kv : byContent)
+        {
+            if (kv.second.size() > 1)
+                report.groups.push_back(std::move(kv.second));
+        }
+        report.files = _files;
+        report.sizeCandidates = _sizeCandidates;
+        report.prefixCandidates = _prefixCandidates;
+        report.bytesHashed = _bytesHashed;
+        report.errors = _errors;
+        return report;
+    }
+};
+
+inline DuplicateReport findDuplicates(const std::string& root, const DuplicateOptions& opt = DuplicateOptions())
+{
+    DuplicateFinder finder(opt);
+    return finder.run(root);
+}
+
+#endif // CONCURENCY_DUPLICATE_FINDER_H
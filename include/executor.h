@@ -0,0 +1,348 @@
+#ifndef CONCURENCY_EXECUTOR_H
+#define CONCURENCY_EXECUTOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "fork_join.h"
+
+/*
+ * Where a task runs.
+ *
+ * The examples start their work with std::thread or std::async(std::launch::async, ...):
+ * a new OS thread for every task. The crawls (include/list_directory.h, batched_crawl.h,
+ * monitor_crawl.h) take an Executor instead, so the strategy is picked by the caller:
+ *
+ *   InlineExecutor        - runs the task right away in the calling thread (serial, no overhead)
+ *   NewThreadExecutor     - a thread per task, what std::async(std::launch::async) does
+ *   FixedThreadPool       - N threads sharing one queue
+ *   WorkStealingExecutor  - N threads with a deque each, the ForkJoinPool of include/fork_join.h
+ *
+ *   std::future<Result> ftr = spawn(executor, &listDir, std::move(dir), token);
+ *   Result r = awaitFuture(executor, ftr);
+ *
+ * spawn() calls f like std::async does: the arguments are copied (moved) into the task and
+ * passed on as rvalues. Unlike the future of std::async, the future of spawn() doesn't wait
+ * for the task in its destructor - a task which references the caller's data has to be
+ * waited for (waitAll) before the caller leaves, also when it leaves with an exception.
+ *
+ * A task which waits for a future of another task blocks a pool thread. When all the threads
+ * of a pool wait like that, the tasks they wait for never get a thread - recursive crawls
+ * would deadlock. awaitFuture() therefore runs queued tasks of the pool while the future
+ * isn't ready (runPending()), the same as TaskGroup::sync() does.
+ */
+
+class Executor
+{
+public:
+    virtual ~Executor() {}
+
+    virtual void execute(std::function<void()> task) = 0;
+
+    /// Runs one queued task in the calling thread. false if there was none (or the
+    /// executor doesn't queue tasks).
+    virtual bool runPending() { return false; }
+
+    /// Whether a waiting thread should help with runPending() - only the pools queue tasks.
+    virtual bool queues() const { return false; }
+
+    virtual const char* name() const = 0;
+};
+
+class InlineExecutor : public Executor
+{
+public:
+    void execute(std::function<void()> task) override { task(); }
+    const char* name() const override { return "inline"; }
+};
+
+class NewThreadExecutor : public Executor
+{
+    std::mutex _mutex;
+    std::condition_variable _done;
+    std::map<std::thread::id, std::thread> _threads;
+    std::vector<std::thread::id> _finished;
+    std::size_t _running;   // started and not finished yet
+
+    /// Moves the threads which are done out of the map (called with the lock held),
+    /// the caller joins them after it unlocked. A thread which finished before execute()
+    /// put it into the map stays in _finished for the next time.
+    /// Joined, not detached: a detached thread may still be running - at least the lines
+    /// after task() which touch _mutex - when the executor is destroyed, and the default
+    /// executor is a static, destroyed at process exit while such threads are still around.
+    void collect(std::vector<std::thread>& done)
+    {
+        std::vector<std::thread::id> notYet;
+        for (std::thread::id id : _finished)
+        {
+            auto it = _threads.find(id);
+            if (it == _threads.end())
+            {
+                notYet.push_back(id);
+                continue;
+            }
+            done.push_back(std::move(it->second));
+            _threads.erase(it);
+        }
+        _finished.swap(notYet);
+    }
+
+public:
+    NewThreadExecutor() : _running(0) {}
+
+    ~NewThreadExecutor()
+    {
+        std::vector<std::thread> done;
+        {
+            std::unique_lock<std::mutex> lck(_mutex);
+            _done.wait(lck, [this] { return _running == 0; });
+            collect(done);
+        }
+        for (std::thread& th : done)
+            th.join();
+    }
+
+    void execute(std::function<void()> task) override
+    {
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            ++_running;
+        }
+        // creating the thread is a syscall - not under the lock all the spawning threads share
+        std::thread th;
+        try
+        {
+            th = std::thread([this, task]
+            {
+                task();
+                std::lock_guard<std::mutex> lck(_mutex);
+                _finished.push_back(std::this_thread::get_id());
+                --_running;
+                _done.notify_all();
+            });
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            --_running;
+            _done.notify_all();
+            throw;
+        }
+
+        std::vector<std::thread> done;
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            std::thread::id id = th.get_id();
+            _threads.emplace(id, std::move(th));
+            collect(done);
+        }
+        for (std::thread& t : done)
+            t.join();
+    }
+
+    const char* name() const override { return "new_thread"; }
+};
+
+class FixedThreadPool : public Executor
+{
+    std::deque<std::function<void()>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    bool _stop;
+    std::vector<std::thread> _threads;
+
+    bool take(std::function<void()>& task)
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        if (_tasks.empty())
+            return false;
+        task = std::move(_tasks.front());
+        _tasks.pop_front();
+        return true;
+    }
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lck(_mutex);
+                _cond.wait(lck, [this] { return _stop || !_tasks.empty(); });
+                if (_tasks.empty())
+                    return;     // stopped and drained
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit FixedThreadPool(unsigned threads = std::thread::hardware_concurrency()) : _stop(false)
+    {
+        if (threads == 0)
+            threads = 1;
+        for (unsigned i = 0; i < threads; ++i)
+            _threads.push_back(std::thread(&FixedThreadPool::workerLoop, this));
+    }
+
+    /// The tasks queued so far still run.
+    ~FixedThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            _stop = true;
+        }
+        _cond.notify_all();
+        for (std::thread& th : _threads)
+            th.join();
+    }
+
+    FixedThreadPool(const FixedThreadPool&) = delete;
+    FixedThreadPool& operator=(const FixedThreadPool&) = delete;
+
+    std::size_t threads() const { return _threads.size(); }
+
+    void execute(std::function<void()> task) override
+    {
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            _tasks.push_back(std::move(task));
+        }
+        _cond.notify_one();
+    }
+
+    bool runPending() override
+    {
+        std::function<void()> task;
+        if (!take(task))
+            return false;
+        task();
+        return true;
+    }
+
+    bool queues() const override { return true; }
+    const char* name() const override { return "fixed_pool"; }
+};
+
+class WorkStealingExecutor : public Executor
+{
+    ForkJoinPool _pool;
+
+public:
+    explicit WorkStealingExecutor(unsigned threads = std::thread::hardware_concurrency()) : _pool(threads) {}
+
+    std::size_t threads() const { return _pool.threads(); }
+
+    void execute(std::function<void()> task) override { _pool.push(std::move(task)); }
+    bool runPending() override { return _pool.runOne(); }
+    bool queues() const override { return true; }
+    const char* name() const override { return "work_stealing"; }
+};
+
+/// A thread per task - the behaviour of the std::async calls the crawls had before.
+inline Executor& defaultExecutor()
+{
+    static NewThreadExecutor executor;
+    return executor;
+}
+
+namespace executor_detail
+{
+    template<std::size_t... I>
+    struct Indices {};
+
+    template<std::size_t N, std::size_t... I>
+    struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+
+    template<std::size_t... I>
+    struct MakeIndices<0, I...>
+    {
+        typedef Indices<I...> type;
+    };
+
+    /// f and the copies of its arguments, called once with the arguments as rvalues.
+    template<typename F, typename... Args>
+    struct Invoker
+    {
+        typedef typename std::result_of<F(Args...)>::type Result;
+
+        F fn;
+        std::tuple<Args...> args;
+
+        template<std::size_t... I>
+        Result call(Indices<I...>)
+        {
+            return fn(std::move(std::get<I>(args))...);
+        }
+
+        Result operator()()
+        {
+            return call(typename MakeIndices<sizeof...(Args)>::type());
+        }
+    };
+}
+
+/// Runs f(args...) on the executor, the result (or the exception) comes through the future.
+template<typename F, typename... Args>
+std::future<typename executor_detail::Invoker<typename std::decay<F>::type, typename std::decay<Args>::type...>::Result>
+spawn(Executor& executor, F&& f, Args&&... args)
+{
+    typedef executor_detail::Invoker<typename std::decay<F>::type, typename std::decay<Args>::type...> Invoker;
+    typedef typename Invoker::Result R;
+
+    Invoker invoker = { std::forward<F>(f), std::make_tuple(std::forward<Args>(args)...) };
+    std::shared_ptr<std::packaged_task<R()>> task = std::make_shared<std::packaged_task<R()>>(std::move(invoker));
+    std::future<R> ftr = task->get_future();
+    executor.execute([task] { (*task)(); });
+    return ftr;
+}
+
+/// Waits until ftr is ready, running queued tasks of the executor meanwhile.
+template<typename T>
+void helpUntilReady(Executor& executor, std::future<T>& ftr)
+{
+    if (!executor.queues())
+    {
+        ftr.wait();
+        return;
+    }
+    while (ftr.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        if (!executor.runPending())
+            ftr.wait_for(std::chrono::microseconds(100));   // a task may be queued meanwhile
+    }
+}
+
+/// ftr.get() which doesn't block a pool thread.
+template<typename T>
+T awaitFuture(Executor& executor, std::future<T>& ftr)
+{
+    helpUntilReady(executor, ftr);
+    return ftr.get();
+}
+
+/// Waits for every valid future, the results and the exceptions are left in them.
+template<typename T>
+void waitAll(Executor& executor, std::vector<std::future<T>>& futures)
+{
+    for (std::future<T>& ftr : futures)
+    {
+        if (ftr.valid())
+            helpUntilReady(executor, ftr);
+    }
+}
+
+#endif // CONCURENCY_EXECUTOR_H
@@ -0,0 +1,269 @@
+#ifndef CONCURENCY_FILE_INDEX_H
+#define CONCURENCY_FILE_INDEX_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "read_mostly.h"
+
+/*
+ * Path -> size of the files of a crawl, to answer "is there X and how big is it" without
+ * going through the vector listAllFiles returns.
+ *
+ * The workers fill it while they crawl (CrawlHooks::index of listAllFiles / listAllFilesShared),
+ * then it is published and only read - by as many threads as like, without a lock.
+ *
+ * Like the VisitedSet (include/visited_set.h) it is 64 shards of open addressing tables with
+ * linear probing, but a slot is just an atomic pointer: an entry (hash, size, the path inline)
+ * is complete before an insert puts it into a free slot with one compare_exchange, so a reader
+ * never sees half of it. A shard doubles at 70 % load under its growLock held exclusive, the
+ * inserts hold it shared.
+ *
+ * publish() ends the building: from then on the tables never move and find() doesn't touch
+ * the growLock at all. A find() before it takes the growLock shared.
+ *
+ *   FileIndex index;
+ *   CrawlHooks hooks;
+ *   hooks.index = &index;
+ *   listAllFiles(root, 8, token, executor, hooks);
+ *   index.publish();
+ *   std::uint64_t size;
+ *   if (index.find("/home/jpola/OpenFOAM/README", size)) ...
+ */
+
+class FileIndex
+{
+    static const int SHARD_BITS = 6;
+    static const std::size_t SHARDS = std::size_t(1) << SHARD_BITS;
+
+    struct Entry
+    {
+        std::uint64_t hash;
+        std::uint64_t size;
+        std::uint32_t length;
+        char path[1];   // length + 1 bytes really
+
+        static std::size_t bytes(std::size_t length) { return offsetof(Entry, path) + length + 1; }
+    };
+
+    struct Shard
+    {
+        mutable SharedReadMutex growLock;
+        std::unique_ptr<std::atomic<Entry*>[]> slots;
+        std::size_t mask;
+        std::atomic<std::size_t> count;
+        std::atomic<std::size_t> entryBytes;
+
+        Shard() : growLock(4), mask(0), count(0), entryBytes(0) {}
+    };
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::atomic<bool> _published;
+
+    static std::uint64_t hash(const std::string& path)
+    {
+        // std::hash of the bytes, mixed so the low bits (the shard) are good too
+        std::uint64_t h = std::hash<std::string>()(path);
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+        return h ^ (h >> 31);
+    }
+
+    static std::size_t limit(std::size_t mask) { return (mask + 1) / 10 * 7; }
+
+    static bool same(const Entry* e, std::uint64_t h, const char* path, std::size_t length)
+    {
+        return e->hash == h && e->length == length && std::memcmp(e->path, path, length) == 0;
+    }
+
+    static void allocate(Shard& sh, std::size_t slots)
+    {
+        sh.slots.reset(new std::atomic<Entry*>[slots]);
+        for (std::size_t i = 0; i < slots; ++i)
+            sh.slots[i].store(nullptr, std::memory_order_relaxed);
+        sh.mask = slots - 1;
+    }
+
+    static const Entry* findIn(const Shard& sh, std::uint64_t h, const char* path, std::size_t length)
+    {
+        std::size_t mask = sh.mask;
+        std::size_t i = static_cast<std::size_t>(h >> SHARD_BITS) & mask;
+        for (std::size_t probes = 0; probes <= mask; ++probes, i = (i + 1) & mask)
+        {
+            const Entry* e = sh.slots[i].load(std::memory_order_acquire);
+            if (!e)
+                return nullptr;
+            if (same(e, h, path, length))
+                return e;
+        }
+        return nullptr;
+    }
+
+    /// With the growLock held shared. false when the table is full, e is then still ours.
+    static bool tryInsert(Shard& sh, Entry* e, bool& added)
+    {
+        std::size_t mask = sh.mask;
+        std::size_t i = static_cast<std::size_t>(e->hash >> SHARD_BITS) & mask;
+        for (std::size_t probes = 0; probes <= mask; ++probes, i = (i + 1) & mask)
+        {
+            Entry* cur = sh.slots[i].load(std::memory_order_acquire);
+            if (!cur && sh.slots[i].compare_exchange_strong(cur, e, std::memory_order_release,
+                                                            std::memory_order_acquire))
+            {
+                added = true;
+                return true;
+            }
+            // cur is whoever is in the slot now
+            if (same(cur, e->hash, e->path, e->length))
+            {
+                added = false;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void grow(Shard& sh, std::size_t seenMask)
+    {
+        std::lock_guard<SharedReadMutex> lck(sh.growLock);
+        if (sh.mask != seenMask)
+            return;
+        std::unique_ptr<std::atomic<Entry*>[]> old = std::move(sh.slots);
+        std::size_t oldSize = sh.mask + 1;
+        allocate(sh, oldSize * 2);
+        for (std::size_t j = 0; j < oldSize; ++j)
+        {
+            Entry* e = old[j].load(std::memory_order_relaxed);
+            if (!e)
+                continue;
+            std::size_t i = static_cast<std::size_t>(e->hash >> SHARD_BITS) & sh.mask;
+            while (sh.slots[i].load(std::memory_order_relaxed))
+                i = (i + 1) & sh.mask;
+            sh.slots[i].store(e, std::memory_order_relaxed);
+        }
+    }
+
+    static void release(Entry* e) { ::operator delete(e); }
+
+public:
+    /// expected - about how many files, the shards start big enough for them.
+    explicit FileIndex(std::size_t expected = 0) : _published(false)
+    {
+        std::size_t perShard = 64;
+        while (limit(perShard - 1) < expected / SHARDS + 1)
+            perShard *= 2;
+        for (std::size_t i = 0; i < SHARDS; ++i)
+        {
+            _shards.emplace_back(new Shard);
+            allocate(*_shards.back(), perShard);
+        }
+    }
+
+    ~FileIndex()
+    {
+        for (std::unique_ptr<Shard>& sh : _shards)
+            for (std::size_t i = 0; i <= sh->mask; ++i)
+                if (Entry* e = sh->slots[i].load(std::memory_order_relaxed))
+                    release(e);
+    }
+
+    FileIndex(const FileIndex&) = delete;
+    FileIndex& operator=(const FileIndex&) = delete;
+
+    /// From any number of threads while the index is built. false if path was there already
+    /// (the size stays the first one). After publish() it throws std::logic_error.
+    bool insert(const std::string& path, std::uint64_t size)
+    {
+        if (_published.load(std::memory_order_relaxed))
+            throw std::logic_error("FileIndex::insert after publish");
+
+        std::size_t bytes = Entry::bytes(path.size());
+        Entry* e = static_cast<Entry*>(::operator new(bytes));
+        e->hash = hash(path);
+        e->size = size;
+        e->length = static_cast<std::uint32_t>(path.size());
+        std::memcpy(e->path, path.c_str(), path.size() + 1);
+
+        Shard& sh = *_shards[e->hash & (SHARDS - 1)];
+        for (;;)
+        {
+            bool inserted, added = false, full = false;
+            std::size_t mask;
+            {
+                SharedReadGuard g(sh.growLock);
+                mask = sh.mask;
+                inserted = tryInsert(sh, e, added);
+                if (added)
+                {
+                    sh.entryBytes.fetch_add(bytes, std::memory_order_relaxed);
+                    full = sh.count.fetch_add(1, std::memory_order_relaxed) + 1 > limit(mask);
+                }
+            }
+            if (!inserted || full)
+                grow(sh, mask);
+            if (inserted)
+            {
+                if (!added)
+                    release(e);
+                return added;
+            }
+        }
+    }
+
+    /// The building is over - the inserts must have returned (the crawl is finished).
+    void publish() { _published.store(true, std::memory_order_release); }
+
+    bool published() const { return _published.load(std::memory_order_acquire); }
+
+    /// true and the size if path is in the index. Lock-free once published.
+    bool find(const std::string& path, std::uint64_t& size) const
+    {
+        std::uint64_t h = hash(path);
+        const Shard& sh = *_shards[h & (SHARDS - 1)];
+        const Entry* e;
+        if (published())
+            e = findIn(sh, h, path.data(), path.size());
+        else
+        {
+            SharedReadGuard g(sh.growLock);
+            e = findIn(sh, h, path.data(), path.size());
+        }
+        if (!e)
+            return false;
+        size = e->size;
+        return true;
+    }
+
+    bool contains(const std::string& path) const
+    {
+        std::uint64_t size;
+        return find(path, size);
+    }
+
+    std::size_t size() const
+    {
+        std::size_t n = 0;
+        for (const std::unique_ptr<Shard>& sh : _shards)
+            n += sh->count.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    /// Bytes of the tables and the entries (without the allocator's overhead).
+    std::size_t memoryBytes() const
+    {
+        std::size_t n = 0;
+        for (const std::unique_ptr<Shard>& sh : _shards)
+            n += (sh->mask + 1) * sizeof(std::atomic<Entry*>) + sh->entryBytes.load(std::memory_order_relaxed);
+        return n;
+    }
+};
+
+#endif // CONCURENCY_FILE_INDEX_H
@@ -0,0 +1,11 @@
+#ifndef CONCURENCY_FILESYSTEM_H
+#define CONCURENCY_FILESYSTEM_H
+
+//This header requires to link with stdc++fs // experimental filesystem
+#include <experimental/filesystem>
+
+/// Shared headers can't do "using namespace" like the examples do,
+/// so they refer to the filesystem through this short alias.
+namespace fs = std::experimental::filesystem;
+
+#endif // CONCURENCY_FILESYSTEM_H
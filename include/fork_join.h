@@ -0,0 +1,373 @@
+#ifndef CONCURENCY_FORK_JOIN_H
+#define CONCURENCY_FORK_JOIN_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Fork/join on a fixed set of threads.
+ *
+ * concurency4 listDirectory forks one std::async (= one OS thread) per subdirectory and joins
+ * by waiting on the futures. Here the forked pieces are tasks on a pool:
+ *
+ *   TaskGroup group(pool);
+ *   group.spawn([&] { left = solve(leftHalf); });   // fork
+ *   right = solve(rightHalf);                        // continue with the other half
+ *   group.sync();                                    // join
+ *
+ * Scheduling: every worker has its own deque. A spawned task goes to the back of the
+ * spawning worker's deque and the worker keeps taking its own work from the back, so it
+ * walks the tree depth first, the same order as serial recursion. Idle workers steal from
+ * the front of other deques - the oldest tasks, which are the biggest pieces of work.
+ * A thread waiting in sync() does not block: it runs its own or stolen tasks meanwhile.
+ *
+ * Sequential cutoff: below a recursion depth (Cutoff::maxDepth) or for a problem smaller than
+ * Cutoff::minSize, spawn() just calls the function - no task, no synchronization.
+ *
+ * Results are not returned through futures: the task writes into a slot owned by the parent
+ * (e.g. a vector element), and after sync() the parent moves the slots together.
+ * Spawned functions have to be copy-constructible (they are stored in std::function).
+ */
+
+class ForkJoinPool
+{
+public:
+    struct Cutoff
+    {
+        int maxDepth;           // deeper spawns run inline
+        std::size_t minSize;    // smaller problems run inline
+
+        Cutoff(int depth = 12, std::size_t size = 2048) : maxDepth(depth), minSize(size) {}
+    };
+
+    /// No size given to spawn - only the depth cutoff applies.
+    static constexpr std::size_t UNKNOWN_SIZE = std::numeric_limits<std::size_t>::max();
+
+private:
+    struct Task
+    {
+        std::function<void()> fn;
+        int depth;
+    };
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    /// What the calling thread is doing for which pool
+    struct Context
+    {
+        ForkJoinPool* pool;
+        std::size_t index;
+        int depth;
+    };
+
+    // one deque per worker thread plus the last one for threads from outside of the pool
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::vector<std::thread> _threads;
+    Cutoff _cutoff;
+
+    std::atomic<bool> _stop;
+    std::atomic<int> _sleeping;
+    std::mutex _idleMutex;
+    std::condition_variable _idle;
+
+    static Context& context()
+    {
+        static thread_local Context c = { nullptr, 0, 0 };
+        return c;
+    }
+
+    std::size_t externalIndex() const { return _workers.size() - 1; }
+
+    std::size_t ownIndex() const
+    {
+        Context& c = context();
+        return c.pool == this ? c.index : externalIndex();
+    }
+
+    bool takeOwn(std::size_t index, Task& task)
+    {
+        Worker& w = *_workers[index];
+        std::lock_guard<std::mutex> lck(w.mutex);
+        if (w.tasks.empty())
+            return false;
+        task = std::move(w.tasks.back());
+        w.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(std::size_t thief, Task& task)
+    {
+        std::size_t n = _workers.size();
+        for (std::size_t k = 1; k < n; ++k)
+        {
+            Worker& w = *_workers[(thief + k) % n];
+            std::lock_guard<std::mutex> lck(w.mutex);
+            if (!w.tasks.empty())
+            {
+                task = std::move(w.tasks.front());
+                w.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void execute(Task& task)
+    {
+        Context& c = context();
+        Context saved = c;
+        std::size_t index = ownIndex();
+        c.pool = this;
+        c.index = index;
+        c.depth = task.depth;
+        task.fn();
+        c = saved;
+    }
+
+    void workerLoop(std::size_t index)
+    {
+        Context& c = context();
+        c.pool = this;
+        c.index = index;
+        c.depth = 0;
+
+        while (!_stop.load(std::memory_order_acquire))
+        {
+            if (runOne())
+                continue;
+
+            // nothing to do - sleep a little. Spawn wakes us up, the timeout covers a missed wakeup.
+            std::unique_lock<std::mutex> lck(_idleMutex);
+            ++_sleeping;
+            _idle.wait_for(lck, std::chrono::milliseconds(1));
+            --_sleeping;
+        }
+    }
+
+public:
+    explicit ForkJoinPool(unsigned threads = std::thread::hardware_concurrency(), Cutoff cutoff = Cutoff())
+        : _cutoff(cutoff), _stop(false), _sleeping(0)
+    {
+        if (threads == 0)
+            threads = 1;
+        for (unsigned i = 0; i <= threads; ++i)
+            _workers.push_back(std::unique_ptr<Worker>(new Worker));
+        for (unsigned i = 0; i < threads; ++i)
+            _threads.push_back(std::thread(&ForkJoinPool::workerLoop, this, i));
+    }
+
+    ~ForkJoinPool()
+    {
+        _stop.store(true, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lck(_idleMutex);
+            _idle.notify_all();
+        }
+        for (std::thread& th : _threads)
+            th.join();
+    }
+
+    ForkJoinPool(const ForkJoinPool&) = delete;
+    ForkJoinPool& operator=(const ForkJoinPool&) = delete;
+
+    std::size_t threads() const { return _threads.size(); }
+    const Cutoff& cutoff() const { return _cutoff; }
+
+    /// Recursion depth of the task the calling thread runs right now.
+    int depth() const
+    {
+        Context& c = context();
+        return c.pool == this ? c.depth : 0;
+    }
+
+    /// True when a child of the current task with the given size should run serially.
+    bool sequential(std::size_t size = UNKNOWN_SIZE) const
+    {
+        return depth() + 1 > _cutoff.maxDepth || (size != UNKNOWN_SIZE && size <= _cutoff.minSize);
+    }
+
+    void push(std::function<void()> fn)
+    {
+        Task task = { std::move(fn), depth() + 1 };
+        {
+            Worker& w = *_workers[ownIndex()];
+            std::lock_guard<std::mutex> lck(w.mutex);
+            w.tasks.push_back(std::move(task));
+        }
+        if (_sleeping.load(std::memory_order_relaxed) > 0)
+            _idle.notify_one();
+    }
+
+    /// Pushes fn as a root task and returns the future of its result.
+    /// Don't wait for the future on a worker thread - use a TaskGroup there.
+    template<typename F>
+    std::future<typename std::result_of<F()>::type> submit(F fn)
+    {
+        typedef typename std::result_of<F()>::type R;
+        std::shared_ptr<std::packaged_task<R()>> task = std::make_shared<std::packaged_task<R()>>(std::move(fn));
+        std::future<R> ftr = task->get_future();
+        push([task] { (*task)(); });
+        return ftr;
+    }
+
+    /// Runs one queued task (own first, then stolen). Returns false if there was none.
+    bool runOne()
+    {
+        Task task;
+        std::size_t index = ownIndex();
+        if (takeOwn(index, task) || steal(index, task))
+        {
+            execute(task);
+            return true;
+        }
+        return false;
+    }
+
+    /// Calls fn one level deeper without making a task of it.
+    template<typename F>
+    void runInline(F&& fn)
+    {
+        Context& c = context();
+        Context saved = c;
+        if (c.pool != this)
+        {
+            c.pool = this;
+            c.index = externalIndex();
+            c.depth = 0;
+        }
+        ++c.depth;
+        try
+        {
+            fn();
+        }
+        catch (...)
+        {
+            c = saved;
+            throw;
+        }
+        c = saved;
+    }
+};
+
+/// Set of tasks forked by one parent. sync() joins them and rethrows the first exception.
+class TaskGroup
+{
+    ForkJoinPool& _pool;
+    std::atomic<int> _pending;
+    std::mutex _errorMutex;
+    std::exception_ptr _error;
+
+    void setError(std::exception_ptr e)
+    {
+        std::lock_guard<std::mutex> lck(_errorMutex);
+        if (!_error)
+            _error = e;
+    }
+
+    template<typename F>
+    struct GroupTask
+    {
+        TaskGroup* group;
+        F fn;
+
+        void operator()()
+        {
+            try
+            {
+                fn();
+            }
+            catch (...)
+            {
+                group->setError(std::current_exception());
+            }
+            group->_pending.fetch_sub(1, std::memory_order_release);
+        }
+    };
+
+    void wait()
+    {
+        while (_pending.load(std::memory_order_acquire) > 0)
+        {
+            //help instead of blocking
+            if (!_pool.runOne())
+                std::this_thread::yield();
+        }
+    }
+
+public:
+    explicit TaskGroup(ForkJoinPool& pool) : _pool(pool), _pending(0) {}
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    ~TaskGroup()
+    {
+        // the tasks reference the group - never leave before they are done
+        wait();
+    }
+
+    /// Fork fn. size is a hint for the sequential cutoff.
+    template<typename F>
+    void spawn(F&& fn, std::size_t size = ForkJoinPool::UNKNOWN_SIZE)
+    {
+        if (_pool.sequential(size))
+        {
+            try
+            {
+                _pool.runInline(fn);
+            }
+            catch (...)
+            {
+                setError(std::current_exception());
+            }
+            return;
+        }
+
+        _pending.fetch_add(1, std::memory_order_relaxed);
+        GroupTask<typename std::decay<F>::type> task = { this, std::forward<F>(fn) };
+        _pool.push(std::move(task));
+    }
+
+    /// Join all spawned tasks.
+    void sync()
+    {
+        wait();
+        std::exception_ptr e;
+        {
+            std::lock_guard<std::mutex> lck(_errorMutex);
+            std::swap(e, _error);
+        }
+        if (e)
+            std::rethrow_exception(e);
+    }
+};
+
+/// Runs both functions in parallel and returns when both are done.
+/// f2 is forked, f1 runs right away in the calling thread.
+template<typename F1, typename F2>
+void parallel_invoke(ForkJoinPool& pool, F1&& f1, F2&& f2)
+{
+    TaskGroup group(pool);
+    group.spawn(std::forward<F2>(f2));
+    pool.runInline(std::forward<F1>(f1));
+    group.sync();
+}
+
+#endif // CONCURENCY_FORK_JOIN_H
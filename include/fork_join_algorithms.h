@@ -0,0 +1,76 @@
+#ifndef CONCURENCY_FORK_JOIN_ALGORITHMS_H
+#define CONCURENCY_FORK_JOIN_ALGORITHMS_H
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <utility>
+#include "fork_join.h"
+
+/*
+ * Divide and conquer algorithms on top of ForkJoinPool.
+ * Both follow the same shape as listDirectoryForkJoin: split, fork one part,
+ * do the other part in the current thread, sync, combine.
+ */
+
+/// Quicksort: partition around median of three, fork the left part.
+/// Below the pool's cutoff the rest is done by std::sort.
+template<typename RandomIt, typename Compare>
+void parallelQuicksort(ForkJoinPool& pool, RandomIt first, RandomIt last, Compare comp)
+{
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+
+    std::size_t n = static_cast<std::size_t>(last - first);
+    if (n < 2 || pool.sequential(n))
+    {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    RandomIt mid = first + n / 2;
+    T a = *first, b = *mid, c = *(last - 1);
+    // median of three
+    T pivot = comp(a, b) ? (comp(b, c) ? b : (comp(a, c) ? c : a))
+                         : (comp(a, c) ? a : (comp(b, c) ? c : b));
+
+    // three way split: [< pivot) [== pivot) [> pivot) - duplicates of the pivot are not sorted again
+    RandomIt lower = std::partition(first, last, [&](const T& x) { return comp(x, pivot); });
+    RandomIt upper = std::partition(lower, last, [&](const T& x) { return !comp(pivot, x); });
+
+    TaskGroup group(pool);
+    group.spawn([&pool, first, lower, comp] { parallelQuicksort(pool, first, lower, comp); },
+                static_cast<std::size_t>(lower - first));
+    pool.runInline([&pool, upper, last, comp] { parallelQuicksort(pool, upper, last, comp); });
+    group.sync();
+}
+
+template<typename RandomIt>
+void parallelQuicksort(ForkJoinPool& pool, RandomIt first, RandomIt last)
+{
+    parallelQuicksort(pool, first, last, std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+/// Reduce [first, last) with an associative op. identity is the neutral element of op
+/// (0 for +, 1 for *, ...) - every half starts from it.
+/// The partial results are moved into op, not copied.
+template<typename RandomIt, typename T, typename Op>
+T parallelReduce(ForkJoinPool& pool, RandomIt first, RandomIt last, T identity, Op op)
+{
+    std::size_t n = static_cast<std::size_t>(last - first);
+    if (pool.sequential(n))
+        return std::accumulate(first, last, std::move(identity), op);
+
+    RandomIt mid = first + n / 2;
+    T left = identity;
+
+    TaskGroup group(pool);
+    group.spawn([&pool, &left, first, mid, &identity, &op] { left = parallelReduce(pool, first, mid, identity, op); },
+                n / 2);
+    T right = identity;
+    pool.runInline([&] { right = parallelReduce(pool, mid, last, identity, op); });
+    group.sync();
+
+    return op(std::move(left), std::move(right));
+}
+
+#endif // CONCURENCY_FORK_JOIN_ALGORITHMS_H
@@ -0,0 +1,258 @@
+#ifndef CONCURENCY_FRONTIER_H
+#define CONCURENCY_FRONTIER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <unistd.h>
+#include "filesystem.h"
+
+/*
+ * The directories which are still to be listed - the frontier of a crawl.
+ *
+ * concurency5 keeps them in a vector and takes them with pop_back: a stack, so the crawl
+ * goes depth first just by accident. The order matters:
+ *
+ *  DepthFirst   - the newest directory first. The frontier stays small on wide trees
+ *                 (about depth * fanout) but the crawl dives to the bottom right away.
+ *  BreadthFirst - the oldest directory first, level by level. Shallow results come early,
+ *                 but the frontier holds a whole level - millions of paths on a wide tree.
+ *  Hybrid       - breadth first while the frontier is small (the top levels, enough work
+ *                 for all the tasks), depth first once it grows over hybridWidth.
+ *
+ * Whatever the order, at most maxInMemory paths stay in memory. Above that the older half
+ * of the in-memory part is written into a temporary file as a block, and blocks are read
+ * back when the memory runs dry. The logical sequence, oldest to newest, is
+ *
+ *   _front (memory)  |  blocks in the file  |  _back (memory)
+ *
+ * push appends to _back, a depth first pop takes the newest (from _back, then the last block,
+ * then _front), a breadth first pop the oldest (from _front, then the first block, then _back).
+ *
+ * Not thread safe - the crawl uses it from its coordinating thread only.
+ */
+
+enum class TraversalPolicy { DepthFirst, BreadthFirst, Hybrid };
+
+inline const char* policyName(TraversalPolicy p)
+{
+    switch (p)
+    {
+    case TraversalPolicy::DepthFirst:   return "dfs";
+    case TraversalPolicy::BreadthFirst: return "bfs";
+    default:                            return "hybrid";
+    }
+}
+
+class DirFrontier
+{
+    struct Block
+    {
+        std::uint64_t offset;
+        std::size_t count;
+    };
+
+    TraversalPolicy _policy;
+    std::size_t _maxInMemory;
+    std::size_t _hybridWidth;
+
+    std::deque<fs::path> _front;
+    std::deque<fs::path> _back;
+    std::deque<Block> _blocks;
+    std::size_t _spilledNow;        // paths in the file right now
+
+    fs::path _spillPath;
+    std::fstream _spill;
+    std::uint64_t _spillEnd;
+
+    // statistics
+    std::size_t _memBytes;          // approximate bytes of the paths in memory
+    std::size_t _peakInMemory;
+    std::size_t _peakMemBytes;
+    std::size_t _peakSize;
+    std::size_t _spilledTotal;
+
+    static std::size_t pathBytes(const fs::path& p)
+    {
+        return sizeof(fs::path) + p.native().capacity();
+    }
+
+    void openSpill()
+    {
+        static std::atomic<int> counter(0);
+        _spillPath = fs::temp_directory_path() /
+                     ("concurency_frontier_" + std::to_string(::getpid()) + "_" + std::to_string(counter++));
+        _spill.open(_spillPath.string(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!_spill)
+            throw std::runtime_error("DirFrontier: can't create " + _spillPath.string());
+        _spillEnd = 0;
+    }
+
+    /// Writes the oldest half of the in-memory paths as a new last block.
+    void spill()
+    {
+        if (!_spill.is_open())
+            openSpill();
+
+        // the oldest paths in memory are in _front, but only _back's ones sit right before the file end;
+        // an unread _front must stay in front of the blocks, so spill from _back
+        std::size_t count = _back.size() / 2;
+        if (count == 0)
+            return;
+
+        Block b = { _spillEnd, count };
+        _spill.seekp(static_cast<std::streamoff>(_spillEnd));
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const std::string& s = _back.front().native();
+            std::uint32_t len = static_cast<std::uint32_t>(s.size());
+            _spill.write(reinterpret_cast<const char*>(&len), sizeof(len));
+            _spill.write(s.data(), len);
+            _memBytes -= pathBytes(_back.front());
+            _back.pop_front();
+        }
+        if (!_spill)
+            throw std::runtime_error("DirFrontier: write to " + _spillPath.string() + " failed");
+        _spillEnd = static_cast<std::uint64_t>(_spill.tellp());
+
+        _blocks.push_back(b);
+        _spilledNow += count;
+        _spilledTotal += count;
+    }
+
+    void load(const Block& b, std::deque<fs::path>& into)
+    {
+        _spill.seekg(static_cast<std::streamoff>(b.offset));
+        std::string s;
+        for (std::size_t i = 0; i < b.count; ++i)
+        {
+            std::uint32_t len = 0;
+            _spill.read(reinterpret_cast<char*>(&len), sizeof(len));
+            s.resize(len);
+            _spill.read(&s[0], len);
+            into.push_back(fs::path(s));
+            _memBytes += pathBytes(into.back());
+        }
+        if (!_spill)
+            throw std::runtime_error("DirFrontier: read from " + _spillPath.string() + " failed");
+        _spilledNow -= b.count;
+
+        // nothing left in the file - start from its beginning again
+        if (_blocks.empty())
+        {
+            _spillEnd = 0;
+            _spill.close();
+            std::error_code ec;
+            fs::resize_file(_spillPath, 0, ec);
+            _spill.open(_spillPath.string(), std::ios::in | std::ios::out | std::ios::binary);
+        }
+    }
+
+    void track()
+    {
+        std::size_t mem = _front.size() + _back.size();
+        if (mem > _peakInMemory)
+            _peakInMemory = mem;
+        if (_memBytes > _peakMemBytes)
+            _peakMemBytes = _memBytes;
+        if (size() > _peakSize)
+            _peakSize = size();
+    }
+
+    bool popNewest(fs::path& out)
+    {
+        if (_back.empty() && !_blocks.empty())
+        {
+            // the last block is at the end of the file - reading it back frees its space
+            Block b = _blocks.back();
+            _blocks.pop_back();
+            load(b, _back);
+            _spillEnd = _blocks.empty() ? 0 : b.offset;
+        }
+        std::deque<fs::path>& from = !_back.empty() ? _back : _front;
+        if (from.empty())
+            return false;
+        out = std::move(from.back());
+        from.pop_back();
+        _memBytes -= pathBytes(out);
+        return true;
+    }
+
+    bool popOldest(fs::path& out)
+    {
+        if (_front.empty() && !_blocks.empty())
+        {
+            Block b = _blocks.front();
+            _blocks.pop_front();
+            load(b, _front);
+        }
+        std::deque<fs::path>& from = !_front.empty() ? _front : _back;
+        if (from.empty())
+            return false;
+        out = std::move(from.front());
+        from.pop_front();
+        _memBytes -= pathBytes(out);
+        return true;
+    }
+
+public:
+    static constexpr std::size_t UNLIMITED = std::numeric_limits<std::size_t>::max();
+
+    /// maxInMemory - paths kept in memory before spilling (at least 2)
+    /// hybridWidth - Hybrid goes depth first above this frontier size
+    explicit DirFrontier(TraversalPolicy policy = TraversalPolicy::DepthFirst,
+                         std::size_t maxInMemory = UNLIMITED, std::size_t hybridWidth = 256)
+        : _policy(policy), _maxInMemory(maxInMemory < 2 ? 2 : maxInMemory), _hybridWidth(hybridWidth),
+          _spilledNow(0), _spillEnd(0), _memBytes(0), _peakInMemory(0), _peakMemBytes(0), _peakSize(0), _spilledTotal(0)
+    {
+    }
+
+    DirFrontier(const DirFrontier&) = delete;
+    DirFrontier& operator=(const DirFrontier&) = delete;
+
+    ~DirFrontier()
+    {
+        if (_spill.is_open())
+            _spill.close();
+        if (!_spillPath.empty())
+        {
+            std::error_code ec;
+            fs::remove(_spillPath, ec);
+        }
+    }
+
+    void push(fs::path&& dir)
+    {
+        _memBytes += pathBytes(dir);
+        _back.push_back(std::move(dir));
+        if (_front.size() + _back.size() > _maxInMemory)
+            spill();
+        track();
+    }
+
+    /// false when the frontier is empty
+    bool pop(fs::path& out)
+    {
+        bool depthFirst = _policy == TraversalPolicy::DepthFirst ||
+                          (_policy == TraversalPolicy::Hybrid && size() > _hybridWidth);
+        return depthFirst ? popNewest(out) : popOldest(out);
+    }
+
+    bool empty() const { return size() == 0; }
+    std::size_t size() const { return _front.size() + _back.size() + _spilledNow; }
+
+    TraversalPolicy policy() const { return _policy; }
+    std::size_t peakInMemory() const { return _peakInMemory; }
+    std::size_t peakMemoryBytes() const { return _peakMemBytes; }
+    std::size_t peakSize() const { return _peakSize; }
+    std::size_t spilled() const { return _spilledTotal; }
+};
+
+#endif // CONCURENCY_FRONTIER_H
@@ -0,0 +1,119 @@
+#ifndef CONCURENCY_HASH64_H
+#define CONCURENCY_HASH64_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * 64 bit non-cryptographic hash of a memory block - the xxHash64 algorithm.
+ *
+ * The input is eaten in 32 byte stripes by four independent accumulators, so the
+ * multiplications of the four lanes overlap in the CPU pipeline - several bytes per cycle,
+ * far above what the disk or the page cache delivers. Good enough to find equal files;
+ * the duplicate finder compares sizes and hashes, not the bytes.
+ */
+
+namespace hash64_detail
+{
+    constexpr std::uint64_t P1 = 11400714785074694791ull;
+    constexpr std::uint64_t P2 = 14029467366897019727ull;
+    constexpr std::uint64_t P3 = 1609587929392839161ull;
+    constexpr std::uint64_t P4 = 9650029242287828579ull;
+    constexpr std::uint64_t P5 = 2870177450012600261ull;
+
+    inline std::uint64_t rotl(std::uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    inline std::uint64_t read64(const unsigned char* p)
+    {
+        std::uint64_t v;
+        std::memcpy(&v, p, sizeof(v)); // unaligned, little endian hosts only
+        return v;
+    }
+
+    inline std::uint32_t read32(const unsigned char* p)
+    {
+        std::uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline std::uint64_t round(std::uint64_t acc, std::uint64_t input)
+    {
+        acc += input * P2;
+        acc = rotl(acc, 31);
+        return acc * P1;
+    }
+
+    inline std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t val)
+    {
+        acc ^= round(0, val);
+        return acc * P1 + P4;
+    }
+}
+
+inline std::uint64_t hash64(const void* data, std::size_t len, std::uint64_t seed = 0)
+{
+    using namespace hash64_detail;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + len;
+    std::uint64_t h;
+
+    if (len >= 32)
+    {
+        std::uint64_t v1 = seed + P1 + P2;
+        std::uint64_t v2 = seed + P2;
+        std::uint64_t v3 = seed;
+        std::uint64_t v4 = seed - P1;
+        const unsigned char* limit = end - 32;
+        do
+        {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    }
+    else
+    {
+        h = seed + P5;
+    }
+
+    h += len;
+
+    for (; p + 8 <= end; p += 8)
+    {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * P1 + P4;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= static_cast<std::uint64_t>(read32(p)) * P1;
+        h = rotl(h, 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        h ^= (*p) * P5;
+        h = rotl(h, 11) * P1;
+    }
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+#endif // CONCURENCY_HASH64_H
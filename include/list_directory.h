@@ -0,0 +1,117 @@
+#ifndef CONCURENCY_LIST_DIRECTORY_H
+#define CONCURENCY_LIST_DIRECTORY_H
+
+#include <string>
+#include <vector>
+#include <future>
+#include <algorithm>
+#include <iterator>
+#include "cancellation.h"
+#include "crawl_errors.h"
+#include "executor.h"
+#include "filesystem.h"
+#include "fork_join.h"
+
+// This is good example of hiding disk I/O latency we will list many directories concurrently
+// (see concurency4). Every subdirectory is listed by its own task on the executor - by default
+// a new thread, like the std::async it used to be (see include/executor.h).
+// The token stops the whole tree of tasks: each of them checks it between the entries
+// and the OperationCancelled thrown by a child comes out of the parent's awaitFuture.
+// A symlink to a directory is listed as an entry, not followed - a link to a parent would never end.
+// With a walk policy (include/walk_policy.h) shared by the whole tree it is followed, every
+// directory listed once. There is no error table here: the first entry which can't be read
+// throws a filesystem_error, like the directory_iterator always did.
+typedef std::vector<std::string> string_vector;
+
+inline string_vector listDirectory(std::string&& dir, const CancellationToken& token = CancellationToken(),
+                                   Executor& executor = defaultExecutor(), WalkPolicy* walk = nullptr)
+{
+    token.throwIfCancelled();
+    string_vector listing;
+    std::string dirStr("\n> ");
+    dirStr += dir;
+    dirStr += ":\n\t ";
+    listing.push_back(dirStr);
+
+
+    std::vector<std::future<string_vector>> futures;
+    try
+    {
+        std::vector<CrawlError> errors;
+        forEachEntry(fs::path(dir), errors, token, walk,
+                     [&](fs::path&& p)
+                     {
+                         auto ftr = spawn(executor, &listDirectory, std::string(p), token, std::ref(executor), walk);
+                         futures.push_back(std::move(ftr));
+                     },
+                     [&](const fs::path& p, const struct stat&)
+                     {
+                         listing.push_back(p.filename());
+                     });
+        if (!errors.empty())
+            throw fs::filesystem_error("listDirectory", fs::path(errors.front().path), errors.front().code);
+
+        std::for_each(futures.begin(), futures.end(), [&listing, &executor](std::future<string_vector>& f)
+        {
+            string_vector lst = awaitFuture(executor, f);
+            // instead of copy we are moving;
+            std::copy(std::make_move_iterator(std::begin(lst)),
+                      std::make_move_iterator(std::end(lst)),
+                      std::back_inserter(listing));
+        });
+    }
+    catch (...)
+    {
+        // unlike std::async futures ours don't wait in the destructor - nothing
+        // of the tree may run anymore when the exception leaves
+        waitAll(executor, futures);
+        throw;
+    }
+
+    return listing;
+}
+
+/// The same listing as a fork/join task tree. Children are tasks on the pool instead
+/// of threads, each child writes its listing into its own slot and the parent moves
+/// the slots together after sync(). Below the pool's depth cutoff it's plain recursion.
+inline string_vector listDirectoryForkJoin(ForkJoinPool& pool, const std::string& dir)
+{
+    string_vector listing;
+    std::string dirStr("\n> ");
+    dirStr += dir;
+    dirStr += ":\n\t ";
+    listing.push_back(dirStr);
+
+    std::vector<std::string> subdirs;
+    for (fs::directory_iterator it(dir); it != fs::directory_iterator(); ++it)
+    {
+       if (fs::is_directory(it->symlink_status()))
+           subdirs.push_back(it->path());
+       else
+           listing.push_back(it->path().filename());
+    }
+
+    std::vector<string_vector> children(subdirs.size());
+    {
+        TaskGroup group(pool);
+        for (std::size_t i = 0; i < subdirs.size(); ++i)
+        {
+            group.spawn([&pool, &children, &subdirs, i]
+            {
+                children[i] = listDirectoryForkJoin(pool, subdirs[i]);
+            });
+        }
+        group.sync();
+    }
+
+    for (string_vector& lst : children)
+    {
+        std::copy(std::make_move_iterator(std::begin(lst)),
+                  std::make_move_iterator(std::end(lst)),
+                  std::back_inserter(listing));
+    }
+
+    return listing;
+}
+
+#endif // CONCURENCY_LIST_DIRECTORY_H
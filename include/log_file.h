@@ -0,0 +1,49 @@
+#ifndef CONCURENCY_LOG_FILE_H
+#define CONCURENCY_LOG_FILE_H
+
+#include <mutex>
+#include <string>
+#include <fstream>
+
+/// Logger from concurency10 - nice use of layzy initialization.
+/// The file is opened only ONCE, by the first thread which writes to it.
+
+class LogFile
+{
+    std::mutex _mu;
+    std::once_flag _flag; // Inditactor if the function was called!
+    std::ofstream _f;
+    std::string _fileName;
+public:
+    LogFile(std::string fileName = "log.txt") : _fileName(std::move(fileName))
+    {
+        // we don't need to open file if program does not write any log!
+        /// _f.open(_fileName);
+    }
+
+    void shared_print (std::string id, int value)
+    {
+        // Naiive solution is following - sync threads, then check the file if was not opened.
+        // but we lose the performance because every time the mu_open mutex is locked
+        // to check if the file was not already opened!!!
+        // without synchronization the file could be opened many times
+        /*
+        {
+            std::unique_lock<std::mutex> locker2 (_mu_open2);
+            if (!_f.open())
+            {
+            _f.open("log.txt");
+            }
+        }
+        */
+
+
+        std::call_once(_flag, [&]() { _f.open(_fileName);});
+        // the stream itself is still shared so writes have to be serialized
+        std::lock_guard<std::mutex> locker(_mu);
+        _f << "From " << id << ": " << value << std::endl;
+    }
+
+};
+
+#endif // CONCURENCY_LOG_FILE_H
@@ -0,0 +1,216 @@
+#ifndef CONCURENCY_MEMO_CACHE_H
+#define CONCURENCY_MEMO_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * Memoizing cache for async computations (single flight).
+ *
+ * concurency12 broadcasts one value by a shared_future to four tasks which all compute the same
+ * factorial. If the requests are the same, the work should be done once:
+ *
+ *   MemoCache<unsigned, BigInteger> cache(64);
+ *   std::shared_future<BigInteger> f = cache.get(n, [n] { return factorial(n); });
+ *
+ *  - the first caller for a key launches the computation on a new thread and gets its shared_future,
+ *  - callers arriving while it runs get the very same shared_future - nothing is computed again,
+ *  - finished values stay in a bounded LRU, later callers get a ready shared_future.
+ *
+ * The keys are spread over shards by their hash, every shard has its own mutex, map and LRU list,
+ * so requests for different keys rarely wait for each other. The lock is never held while computing.
+ * A computation which throws is not cached - its callers get the exception, the next call tries again.
+ */
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class MemoCache
+{
+    struct Entry
+    {
+        std::shared_future<Value> value;
+        bool ready;                                 // finished and in the LRU list
+        typename std::list<Key>::iterator lru;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_map<Key, Entry, Hash> map;
+        std::list<Key> lru;                         // finished keys, most recently used first
+    };
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::size_t _shardCapacity;
+    Hash _hash;
+
+    std::atomic<std::size_t> _hits;
+    std::atomic<std::size_t> _joins;
+    std::atomic<std::size_t> _misses;
+    std::atomic<std::size_t> _evictions;
+
+    Shard& shard(const Key& key)
+    {
+        return *_shards[_hash(key) % _shards.size()];
+    }
+
+    /// Called by the computation just before its future gets ready.
+    void finish(const Key& key, bool failed)
+    {
+        Shard& s = shard(key);
+        std::lock_guard<std::mutex> lck(s.mutex);
+        auto it = s.map.find(key);
+        if (it == s.map.end())
+            return;
+
+        if (failed)
+        {
+            s.map.erase(it);
+            return;
+        }
+
+        it->second.ready = true;
+        s.lru.push_front(key);
+        it->second.lru = s.lru.begin();
+
+        while (s.lru.size() > _shardCapacity)
+        {
+            s.map.erase(s.lru.back());
+            s.lru.pop_back();
+            _evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    struct Stats
+    {
+        std::size_t hits;       // value was already there
+        std::size_t joins;      // joined a computation in flight
+        std::size_t misses;     // launched a computation
+        std::size_t evictions;
+    };
+
+    /// capacity - finished values kept (split evenly between the shards)
+    explicit MemoCache(std::size_t capacity, std::size_t shards = 16)
+        : _shardCapacity((capacity + shards - 1) / shards), _hits(0), _joins(0), _misses(0), _evictions(0)
+    {
+        if (_shardCapacity == 0)
+            _shardCapacity = 1;
+        for (std::size_t i = 0; i < shards; ++i)
+            _shards.emplace_back(new Shard);
+    }
+
+    MemoCache(const MemoCache&) = delete;
+    MemoCache& operator=(const MemoCache&) = delete;
+
+    /// Computations in flight call back into the cache - wait for them.
+    ~MemoCache()
+    {
+        std::vector<std::shared_future<Value>> pending;
+        for (auto& s : _shards)
+        {
+            std::lock_guard<std::mutex> lck(s->mutex);
+            for (auto& kv : s->map)
+            {
+                if (!kv.second.ready)
+                    pending.push_back(kv.second.value);
+            }
+        }
+        for (auto& f : pending)
+            f.wait();
+    }
+
+    /// Value of compute() for key. compute is called (asynchronously) only if the key
+    /// is neither cached nor being computed right now.
+    template<typename F>
+    std::shared_future<Value> get(const Key& key, F compute)
+    {
+        Shard& s = shard(key);
+        std::lock_guard<std::mutex> lck(s.mutex);
+
+        auto it = s.map.find(key);
+        if (it != s.map.end())
+        {
+            Entry& e = it->second;
+            if (e.ready)
+            {
+                s.lru.splice(s.lru.begin(), s.lru, e.lru);
+                _hits.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                _joins.fetch_add(1, std::memory_order_relaxed);
+            }
+            return e.value;
+        }
+
+        _misses.fetch_add(1, std::memory_order_relaxed);
+        // a detached thread and a promise rather than std::async: the last copy of a std::async
+        // future joins its thread, and the entry may be dropped from inside that very thread
+        std::shared_ptr<std::promise<Value>> prms = std::make_shared<std::promise<Value>>();
+        std::shared_future<Value> ftr = prms->get_future().share();
+        std::thread([this, key, compute, prms]
+        {
+            try
+            {
+                Value v = compute();
+                finish(key, false);
+                prms->set_value(std::move(v));
+            }
+            catch (...)
+            {
+                finish(key, true);
+                prms->set_exception(std::current_exception());
+            }
+        }).detach();
+
+        Entry e;
+        e.value = ftr;
+        e.ready = false;
+        s.map.emplace(key, std::move(e));
+        return ftr;
+    }
+
+    /// Drops all finished values (computations in flight stay).
+    void clear()
+    {
+        for (auto& s : _shards)
+        {
+            std::lock_guard<std::mutex> lck(s->mutex);
+            for (const Key& key : s->lru)
+                s->map.erase(key);
+            s->lru.clear();
+        }
+    }
+
+    std::size_t size()
+    {
+        std::size_t n = 0;
+        for (auto& s : _shards)
+        {
+            std::lock_guard<std::mutex> lck(s->mutex);
+            n += s->lru.size();
+        }
+        return n;
+    }
+
+    Stats stats() const
+    {
+        Stats st;
+        st.hits = _hits.load(std::memory_order_relaxed);
+        st.joins = _joins.load(std::memory_order_relaxed);
+        st.misses = _misses.load(std::memory_order_relaxed);
+        st.evictions = _evictions.load(std::memory_order_relaxed);
+        return st;
+    }
+};
+
+#endif // CONCURENCY_MEMO_CACHE_H
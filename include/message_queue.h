@@ -0,0 +1,172 @@
+#ifndef CONCURENCY_MESSAGE_QUEUE_H
+#define CONCURENCY_MESSAGE_QUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <type_traits>
+#include "cancellation.h"
+#include "select.h"
+#include "trace.h"
+
+/// Message queue from concurency7. Producers call send, servers wait in recieve.
+/// See concurency7/main.cpp for the discussion about unique_lock vs lock_guard
+/// and the condition_variable protocol.
+///
+/// Besides the blocking recieve there are try_receive (never waits), receive_for (waits
+/// at most the given time) and select() from include/select.h to wait on several queues.
+///
+/// Mutex is std::mutex or a lock with the same interface - MessageQueue<T, AdaptiveMutex>
+/// (include/adaptive_mutex.h) spins before it sleeps. Other locks need condition_variable_any.
+template<typename T, typename Mutex = std::mutex>
+class MessageQueue : public SelectableQueue
+{
+    typedef typename std::conditional<std::is_same<Mutex, std::mutex>::value,
+                                      std::condition_variable, std::condition_variable_any>::type Condition;
+
+    std::deque<T> _queue;
+    Condition _cond;
+    Mutex _mutex;
+    SelectWaiterList _waiters;   // threads in select() on this queue
+
+public:
+
+    //Notify the reciever
+    void send(T&& message)
+    {
+        //lock is released in destr. So in this case in the end of this scope
+        //traceLock records the time spent waiting for the mutex when tracing is on
+        {
+            std::unique_lock<Mutex> lck(_mutex, std::defer_lock);
+            traceLock(lck, "MessageQueue::send lock");
+            _queue.push_front(std::move(message));
+            //under the lock - a waiter detached by select is never touched again
+            _waiters.signalAll();
+        }
+        _cond.notify_one();
+
+    }
+
+    T recieve()
+    {
+        std::unique_lock<Mutex> lck(_mutex, std::defer_lock);
+        traceLock(lck, "MessageQueue::recieve lock");
+
+        /// below corresponds to following piece of code;
+        /// since it is very common the condition_variable
+        /// is taking predicate as an argument
+        ///
+        /*
+         * while (queue.empty())
+         * {
+         *   cond.wait(lock) //release lock to give a chance for producer to do the changes
+         *
+         * }
+         */
+
+        /// Predicate is provided as lambda
+        /// so server will wake up when queue is not empty
+        ///
+        /// _queue is part of the class so we have to capture pointer to this class
+        if (_queue.empty())
+        {
+            //only real waits show up in the trace
+            TRACE_SCOPE("queue", "MessageQueue::wait");
+            _cond.wait(lck, [this] { return !_queue.empty();});
+        }
+
+        T msg = std::move(_queue.back());
+        _queue.pop_back();
+        return msg;
+    }
+
+    /// Takes a message if there is one, never waits.
+    bool try_receive(T& out)
+    {
+        std::lock_guard<Mutex> lck(_mutex);
+        if (_queue.empty())
+            return false;
+        out = std::move(_queue.back());
+        _queue.pop_back();
+        return true;
+    }
+
+    /// Waits for a message at most timeout. false if none came.
+    template<typename Rep, typename Period>
+    bool receive_for(T& out, std::chrono::duration<Rep, Period> timeout)
+    {
+        std::unique_lock<Mutex> lck(_mutex, std::defer_lock);
+        traceLock(lck, "MessageQueue::receive_for lock");
+        if (_queue.empty())
+        {
+            TRACE_SCOPE("queue", "MessageQueue::wait");
+            if (!_cond.wait_for(lck, timeout, [this] { return !_queue.empty(); }))
+                return false;
+        }
+        out = std::move(_queue.back());
+        _queue.pop_back();
+        return true;
+    }
+
+    bool ready() override
+    {
+        std::lock_guard<Mutex> lck(_mutex);
+        return !_queue.empty();
+    }
+
+    void attach(SelectWaiter* waiter) override
+    {
+        std::lock_guard<Mutex> lck(_mutex);
+        _waiters.add(waiter);
+    }
+
+    void detach(SelectWaiter* waiter) override
+    {
+        std::lock_guard<Mutex> lck(_mutex);
+        _waiters.remove(waiter);
+    }
+
+    /// recieve which gives up: throws OperationCancelled when the token is cancelled
+    /// or its deadline passes before a message comes.
+    T recieve(const CancellationToken& token)
+    {
+        // cancel() wakes us up. The callback locks _mutex so the notify can't slip in between
+        // our check of the predicate and the wait. The registration is made before taking the lock
+        // and removed after releasing it - cancel() calls the callback under the token's mutex.
+        CancelRegistration registration(token, [this]
+        {
+            std::lock_guard<Mutex> lck(_mutex);
+            _cond.notify_all();
+        });
+
+        std::unique_lock<Mutex> lck(_mutex, std::defer_lock);
+        traceLock(lck, "MessageQueue::recieve lock");
+
+        auto ready = [this, &token] { return !_queue.empty() || token.isCancelled(); };
+        if (!ready())
+        {
+            TRACE_SCOPE("queue", "MessageQueue::wait");
+            if (token.hasDeadline())
+                _cond.wait_until(lck, token.deadline(), ready);
+            else
+                _cond.wait(lck, ready);
+        }
+
+        // a message which is already there is still delivered
+        if (_queue.empty())
+        {
+            lck.unlock();
+            token.throwIfCancelled();
+            throw OperationCancelled("deadline exceeded");
+        }
+
+        T msg = std::move(_queue.back());
+        _queue.pop_back();
+        return msg;
+    }
+
+
+};
+
+#endif // CONCURENCY_MESSAGE_QUEUE_H
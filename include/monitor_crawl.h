@@ -0,0 +1,137 @@
+#ifndef CONCURENCY_MONITOR_CRAWL_H
+#define CONCURENCY_MONITOR_CRAWL_H
+
+#include <iostream>
+#include <string>
+#include <future>
+#include <vector>
+#include <system_error>
+#include "cancellation.h"
+#include "crawl_hooks.h"
+#include "executor.h"
+#include "filesystem.h"
+#include "monitor_result.h"
+#include "trace.h"
+
+/*
+ * Directory listing from concurency6. All the tasks share one
+ * MonitorResult instead of returning their own Result.
+ * Cancellation, the executor and the hooks (include/crawl_hooks.h) work like in
+ * include/batched_crawl.h. The errors come back in Result::errors, or in the ErrorTable of the hooks
+ * when there is one (Result::errors is left empty then).
+ * With SortedRuns the i-th task of every batch collects the full paths of its files into the i-th
+ * RunBuffer, which adds them as a sorted run every CRAWL_RUN_SIZE paths and at the end of the crawl,
+ * to be merged after it (see include/sorted_output.h).
+ */
+
+// Sharing result data
+// run - where the full paths go with hooks.sorted; without one they are a run of this directory.
+inline void listDir (fs::path && dir, MonitorResult& result, const CancellationToken& token,
+                     const CrawlHooks& hooks = CrawlHooks(), RunBuffer* run = nullptr)
+{
+    TRACE_SCOPE("task", "listDir");
+    std::size_t dirs = 0, files = 0;   // counted here, added to progress once
+    std::vector<CrawlError> errors;
+    RunBuffer own(hooks.sorted);
+    if (hooks.sorted && !run)
+        run = &own;
+    forEachEntry(dir, errors, token, hooks.walk,
+                 [&](fs::path&& d) { result.putDir(std::move(d)); ++dirs; },
+                 [&](const fs::path& f, const struct stat& st)
+                 {
+                     result.putFile(f.filename());
+                     if (hooks.index)
+                         hooks.index->insert(f.string(), st.st_size);
+                     if (run)
+                         run->push(f.string());
+                     ++files;
+                 });
+    own.flush();
+    if (hooks.progress)
+        hooks.progress->add(dirs, files, 0, errors.size());
+    if (!errors.empty())
+        result.putErrors(std::move(errors));
+
+}
+
+inline Result listAllFilesShared(std::string& root, int maxTasks = 16,
+                                 const CancellationToken& token = CancellationToken(),
+                                 Executor& executor = defaultExecutor(),
+                                 const CrawlHooks& hooks = CrawlHooks())
+{
+
+    //Create shared data
+    MonitorResult result;
+    result.putDir(fs::path(root));
+    if (hooks.progress)
+        hooks.progress->addRoot();
+    //with hooks.sorted the i-th task of every batch collects into runs[i]
+    std::vector<RunBuffer> runs;
+    if (hooks.sorted)
+        runs.resize(maxTasks, RunBuffer(hooks.sorted));
+
+
+    //we don't want to create unbounded number of tasks
+    while(!result.isDirsEmpty())
+    {
+        token.throwIfCancelled();
+        std::vector<fs::path> dirsToDo = result.getDirs(maxTasks);
+
+        std::vector<std::future<void>> futures;
+
+        //limit the number of tasks to maxTasks
+        for (std::size_t i = 0; !dirsToDo.empty(); ++i)
+        {
+            //pass the result (shared data) to async function
+            auto ftr = spawn(executor,
+                             static_cast<void (*)(fs::path&&, MonitorResult&, const CancellationToken&, const CrawlHooks&, RunBuffer*)>(&listDir),
+                             std::move(dirsToDo.back()), std::ref(result), token, hooks,
+                             runs.empty() ? nullptr : &runs[i]);
+            dirsToDo.pop_back();
+            futures.push_back(std::move(ftr));
+        }
+
+        try
+        {
+            TRACE_SCOPE("barrier", "listAllFilesShared batch barrier");
+            //here we are creating barrier
+            while(!futures.empty())
+            {
+                auto ftr = std::move(futures.back());
+                futures.pop_back();
+                awaitFuture(executor, ftr); //previously ftr.wait() was enough, get() passes OperationCancelled on
+            }
+        }
+        catch (OperationCancelled&)
+        {
+            //the remaining tasks write into result - wait for them
+            waitAll(executor, futures);
+            throw;
+        }
+        catch (std::system_error& e)
+        {
+            std::cout << "System error: " << e.code().message() << std::endl;
+        }
+
+        catch (std::exception& e)
+        {
+            std::cout << "Exception: " << e.what() << std::endl;
+        }
+
+        catch (...)
+        {
+            std::cout <<"Unknown Exception" << std::endl;
+        }
+        waitAll(executor, futures);
+    }
+
+    for (RunBuffer& run : runs)
+        run.flush();
+    //we are going out of scope of MonitorResult so we can get the data from it.
+    Result files = result.getResult();
+    if (hooks.errors)       // moves them, like listAllFiles does
+        hooks.errors->add(files.errors);
+    return files;
+}
+
+#endif // CONCURENCY_MONITOR_CRAWL_H
@@ -0,0 +1,104 @@
+#ifndef CONCURENCY_MONITOR_RESULT_H
+#define CONCURENCY_MONITOR_RESULT_H
+
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "adaptive_mutex.h"
+#include "result.h"
+#include "chunked_collector.h"
+#include "read_mostly.h"
+
+/// What MonitorResult::status() tells without the lock.
+struct MonitorStatus
+{
+    std::size_t dirsWaiting;    // put but not taken by getDirs yet
+    std::size_t dirsFound;      // all putDir calls
+};
+
+//create monitor pattern for result data;
+/// Monitor pattern should aquire locks in each public functions
+/// It makes it thread-safe
+/// getResult may be called only when the listing tasks are finished.
+class MonitorResult
+{
+    Result _result;
+    ChunkedCollector<std::string> _files;
+    // used for synchronization. The sections are a push_back or a few pop_backs - the lock
+    // spins a little before it sleeps, see include/adaptive_mutex.h
+    AdaptiveMutex _mutex;
+    // a copy of the counts for the readers, written under _mutex - include/read_mostly.h
+    SeqLock<MonitorStatus> _status;
+public:
+
+    /// The main loop asks this all the time - it never takes _mutex.
+    bool isDirsEmpty() const
+    {
+        return _status.read().dirsWaiting == 0;
+    }
+
+    MonitorStatus status() const
+    {
+        return _status.read();
+    }
+
+    //encapsulation to access the files collection;
+    /// Files are only appended during the crawl and read after it, so they don't need
+    /// the monitor lock at all - see include/chunked_collector.h
+    void putFile(std::string&& file)
+    {
+        _files.append(std::move(file));
+    }
+
+    void putDir(fs::path&& pth)
+    {
+        ///This piece of code is not very secure.
+        /// If we have an exception from push_back the mutex will
+        /// not be unlocked due to interuption.
+//        _mutex.lock();
+//        _result.dirs.push_back(pth);
+//        _mutex.unlock();
+
+        ///The solution is to use lock_guard.
+        /// It will release mutex when the lock_guard desctuctor is called!
+        /// In this case when code is interrupted when stack will be unvinded _mutex will be released;
+
+        //This is RAII object. Resource Aquisition Is Initialisation.
+        std::lock_guard<AdaptiveMutex> lck(_mutex);
+        //pth is an rvalue - move it instead of copying
+        _result.dirs.push_back(std::move(pth));
+        _status.update([](MonitorStatus& st) { ++st.dirsWaiting; ++st.dirsFound; });
+
+    }
+
+    /// Entries of a directory which couldn't be listed - rare, so under the lock.
+    void putErrors(std::vector<CrawlError>&& errors)
+    {
+        std::lock_guard<AdaptiveMutex> lck(_mutex);
+        std::move(errors.begin(), errors.end(), std::back_inserter(_result.errors));
+    }
+
+    std::vector<fs::path> getDirs(int n)
+    {
+        std::vector<fs::path> dirs;
+        std::lock_guard<AdaptiveMutex> lck(_mutex);
+        for (int i = 0; i < n && !_result.dirs.empty(); ++i)
+        {
+            dirs.push_back(std::move(_result.dirs.back()));
+            _result.dirs.pop_back();
+        }
+        std::size_t waiting = _result.dirs.size();
+        _status.update([waiting](MonitorStatus& st) { st.dirsWaiting = waiting; });
+        return dirs;
+    }
+
+    Result getResult()
+    {
+        Result res = std::move(_result);
+        res.files = _files.takeAll();
+        return res;
+    }
+};
+
+#endif // CONCURENCY_MONITOR_RESULT_H
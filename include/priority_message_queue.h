@@ -0,0 +1,175 @@
+#ifndef CONCURENCY_PRIORITY_MESSAGE_QUEUE_H
+#define CONCURENCY_PRIORITY_MESSAGE_QUEUE_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "select.h"
+#include "trace.h"
+
+/*
+ * MessageQueue with priorities.
+ *
+ * MessageQueue serves strictly in order of arrival. When a crawl of a deep tree has filled
+ * the queue with thousands of directories, a new user request waits behind all of them.
+ *
+ * Here every message goes into one of a few priority lanes (buckets), 0 is the most urgent:
+ *
+ *   PriorityMessageQueue<Job> queue(8);
+ *   queue.send(std::move(job), depth);                        // shallow directories first
+ *   queue.send(std::move(urgent), 0, Clock::now() + 5ms);     // with a deadline
+ *
+ * recieve takes the oldest message of the most urgent non-empty lane. Inside a lane it is FIFO.
+ *
+ * Starvation protection is aging: a message moves up one lane for every maxWait it waits,
+ * so the head of lane i is served as if it were in lane i - waited / maxWait (below 0 when
+ * it waited long enough). A steady stream of urgent work can't hold back the background
+ * lanes for good, but a background backlog which is a bit older than maxWait doesn't jump
+ * ahead of everything either - a fresh lane 0 message still beats a lane 4 one until that
+ * has waited 4 * maxWait. On equal effective lanes the originally more urgent one wins.
+ *
+ * A message with a deadline is served first once the deadline passed (the earliest first).
+ * Aging and deadlines are only looked at for the lane heads - a lane stays FIFO.
+ */
+template<typename T>
+class PriorityMessageQueue : public SelectableQueue
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    struct Entry
+    {
+        T msg;
+        Clock::time_point sent;
+        Clock::time_point deadline;     // time_point::max() - none
+    };
+
+    std::vector<std::deque<Entry>> _lanes;
+    std::size_t _size;
+    Clock::duration _maxWait;
+    std::condition_variable _cond;
+    std::mutex _mutex;
+    SelectWaiterList _waiters;
+
+    void push(T&& message, unsigned priority, Clock::time_point deadline)
+    {
+        priority = std::min<unsigned>(priority, static_cast<unsigned>(_lanes.size() - 1));
+        {
+            std::unique_lock<std::mutex> lck(_mutex, std::defer_lock);
+            traceLock(lck, "PriorityMessageQueue::send lock");
+            Entry e = { std::move(message), Clock::now(), deadline };
+            _lanes[priority].push_back(std::move(e));
+            ++_size;
+            _waiters.signalAll();
+        }
+        _cond.notify_one();
+    }
+
+    /// with the lock held and _size > 0
+    T pop()
+    {
+        Clock::time_point now = Clock::now();
+        std::size_t chosen = _lanes.size();
+
+        // heads past their deadline first, the earliest deadline of them
+        for (std::size_t i = 0; i < _lanes.size(); ++i)
+        {
+            if (!_lanes[i].empty() && _lanes[i].front().deadline <= now &&
+                (chosen == _lanes.size() || _lanes[i].front().deadline < _lanes[chosen].front().deadline))
+                chosen = i;
+        }
+
+        // otherwise the smallest aged lane
+        if (chosen == _lanes.size())
+        {
+            long long best = 0;
+            for (std::size_t i = 0; i < _lanes.size(); ++i)
+            {
+                if (_lanes[i].empty())
+                    continue;
+                long long level = static_cast<long long>(i) - (now - _lanes[i].front().sent) / _maxWait;
+                if (chosen == _lanes.size() || level < best)
+                {
+                    chosen = i;
+                    best = level;
+                }
+            }
+        }
+
+        T msg = std::move(_lanes[chosen].front().msg);
+        _lanes[chosen].pop_front();
+        --_size;
+        return msg;
+    }
+
+public:
+    explicit PriorityMessageQueue(unsigned levels = 8, Clock::duration maxWait = std::chrono::milliseconds(100))
+        : _lanes(std::max(levels, 1u)), _size(0), _maxWait(std::max(maxWait, Clock::duration(1)))
+    {
+    }
+
+    unsigned levels() const { return static_cast<unsigned>(_lanes.size()); }
+
+    /// priority 0 is the most urgent, bigger ones go into the last lane
+    void send(T&& message, unsigned priority = 0)
+    {
+        push(std::move(message), priority, Clock::time_point::max());
+    }
+
+    /// The message is served first once the deadline passed (unless an earlier deadline passed too).
+    void send(T&& message, unsigned priority, Clock::time_point deadline)
+    {
+        push(std::move(message), priority, deadline);
+    }
+
+    T recieve()
+    {
+        std::unique_lock<std::mutex> lck(_mutex, std::defer_lock);
+        traceLock(lck, "PriorityMessageQueue::recieve lock");
+        if (_size == 0)
+        {
+            TRACE_SCOPE("queue", "PriorityMessageQueue::wait");
+            _cond.wait(lck, [this] { return _size > 0; });
+        }
+        return pop();
+    }
+
+    bool try_receive(T& out)
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        if (_size == 0)
+            return false;
+        out = pop();
+        return true;
+    }
+
+    std::size_t size()
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _size;
+    }
+
+    bool ready() override
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _size > 0;
+    }
+
+    void attach(SelectWaiter* waiter) override
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        _waiters.add(waiter);
+    }
+
+    void detach(SelectWaiter* waiter) override
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        _waiters.remove(waiter);
+    }
+};
+
+#endif // CONCURENCY_PRIORITY_MESSAGE_QUEUE_H
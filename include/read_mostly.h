@@ -0,0 +1,200 @@
+#ifndef CONCURENCY_READ_MOSTLY_H
+#define CONCURENCY_READ_MOSTLY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "cache_line.h"
+
+/*
+ * Data which is read all the time and written rarely.
+ *
+ * The main loop of concurency6 asks MonitorResult::isDirsEmpty() again and again, and each
+ * time it took the monitor mutex which the listing tasks need for putDir. A read doesn't
+ * change anything, it only has to see a consistent state:
+ *
+ *  SeqLock<T>       - a small trivially copyable snapshot. The writer makes the sequence number
+ *                     odd, writes, makes it even again. A reader copies the value and retries
+ *                     if the number was odd or changed meanwhile. Readers write nothing at all,
+ *                     so any number of them never slow each other or the writer down.
+ *
+ *  SharedReadMutex  - for data which can't be copied in one go (a map, a vector). The readers
+ *                     count themselves in one of several counters, each on its own cache line,
+ *                     so they don't fight over one reader count like a plain rwlock does.
+ *                     A writer raises a flag and waits until every counter drops to zero.
+ *                     Writers are expensive - it is meant for data written once in a while.
+ *
+ *   SeqLock<Stats> stats;                  SharedReadMutex mutex;
+ *   stats.write(s);                        { SharedReadGuard g(mutex); lookup(); }
+ *   Stats now = stats.read();              { std::lock_guard<SharedReadMutex> g(mutex); update(); }
+ */
+
+template<typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock copies the value word by word");
+
+    static const std::size_t WORDS = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    std::atomic<unsigned> _seq;
+    // the value as atomic words: a reader may copy while the writer writes - that read is
+    // thrown away, but it must not be a data race
+    std::atomic<std::uint64_t> _words[WORDS];
+
+public:
+    explicit SeqLock(const T& value = T()) : _seq(0)
+    {
+        for (std::size_t i = 0; i < WORDS; ++i)
+            _words[i].store(0, std::memory_order_relaxed);
+        write(value);
+    }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    /// Never waits for a writer which isn't writing right now.
+    T read() const
+    {
+        std::uint64_t buffer[WORDS];
+        for (;;)
+        {
+            unsigned before = _seq.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            for (std::size_t i = 0; i < WORDS; ++i)
+                buffer[i] = _words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_seq.load(std::memory_order_relaxed) == before)
+                break;
+        }
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+
+    /// Writers exclude each other by the odd sequence number.
+    void write(const T& value)
+    {
+        update([&value](T& v) { v = value; });
+    }
+
+    /// read-modify-write, update(T&) changes the value in place.
+    template<typename F>
+    void update(F f)
+    {
+        unsigned seq = _seq.load(std::memory_order_relaxed);
+        while ((seq & 1) || !_seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            std::this_thread::yield();
+            seq = _seq.load(std::memory_order_relaxed);
+        }
+        // the odd number must be visible before any of the new words
+        std::atomic_thread_fence(std::memory_order_release);
+
+        std::uint64_t buffer[WORDS];
+        for (std::size_t i = 0; i < WORDS; ++i)
+            buffer[i] = _words[i].load(std::memory_order_relaxed);
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+        f(value);
+        std::memcpy(buffer, &value, sizeof(T));
+        for (std::size_t i = 0; i < WORDS; ++i)
+            _words[i].store(buffer[i], std::memory_order_relaxed);
+
+        _seq.store(seq + 2, std::memory_order_release);
+    }
+};
+
+class SharedReadMutex
+{
+    struct Slot
+    {
+        std::atomic<int> readers;
+        char pad[CACHE_LINE_SIZE - sizeof(std::atomic<int>)];
+    };
+
+    std::vector<Slot> _slots;
+    std::atomic<bool> _writing;
+    std::mutex _writer;                 // one writer at a time
+
+    /// A thread always counts itself in the same slot - unlock_shared must find it again.
+    /// The threads are dealt out round robin, with about as many slots as cores.
+    Slot& mySlot()
+    {
+        static std::atomic<unsigned> nextThread(0);
+        static thread_local unsigned thread = nextThread++;
+        return _slots[thread % _slots.size()];
+    }
+
+public:
+    explicit SharedReadMutex(unsigned slots = std::thread::hardware_concurrency())
+        : _slots(slots ? slots : 1), _writing(false)
+    {
+        for (Slot& s : _slots)
+            s.readers.store(0, std::memory_order_relaxed);
+    }
+
+    SharedReadMutex(const SharedReadMutex&) = delete;
+    SharedReadMutex& operator=(const SharedReadMutex&) = delete;
+
+    void lock_shared()
+    {
+        std::atomic<int>& readers = mySlot().readers;
+        for (;;)
+        {
+            // count ourselves first, then look for a writer - the writer does it the other way
+            // round, so at least one of us sees the other (both seq_cst)
+            readers.fetch_add(1, std::memory_order_seq_cst);
+            if (!_writing.load(std::memory_order_seq_cst))
+                return;
+            readers.fetch_sub(1, std::memory_order_release);
+            while (_writing.load(std::memory_order_relaxed))
+                std::this_thread::yield();
+        }
+    }
+
+    void unlock_shared()
+    {
+        mySlot().readers.fetch_sub(1, std::memory_order_release);
+    }
+
+    void lock()
+    {
+        _writer.lock();
+        _writing.store(true, std::memory_order_seq_cst);
+        for (Slot& s : _slots)
+        {
+            while (s.readers.load(std::memory_order_acquire) != 0)
+                std::this_thread::yield();
+        }
+    }
+
+    void unlock()
+    {
+        _writing.store(false, std::memory_order_release);
+        _writer.unlock();
+    }
+};
+
+/// std::shared_lock for SharedReadMutex (std::shared_lock is C++14).
+class SharedReadGuard
+{
+    SharedReadMutex& _mutex;
+
+public:
+    explicit SharedReadGuard(SharedReadMutex& mutex) : _mutex(mutex) { _mutex.lock_shared(); }
+    ~SharedReadGuard() { _mutex.unlock_shared(); }
+
+    SharedReadGuard(const SharedReadGuard&) = delete;
+    SharedReadGuard& operator=(const SharedReadGuard&) = delete;
+};
+
+#endif // CONCURENCY_READ_MOSTLY_H
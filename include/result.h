@@ -0,0 +1,36 @@
+#ifndef CONCURENCY_RESULT_H
+#define CONCURENCY_RESULT_H
+
+#include <string>
+#include <vector>
+#include "crawl_errors.h"
+#include "filesystem.h"
+
+/// Result of listing a single directory: plain files found there
+/// and subdirectories which still have to be listed.
+/// Entries which couldn't be listed are in errors (see include/crawl_errors.h).
+struct Result
+{
+    std::vector<std::string> files;
+    std::vector<fs::path> dirs;
+    std::vector<CrawlError> errors;
+
+    Result () {}
+    //Create move semantics to be able to RVO
+    //but since we defined move ctor we have to cvreate explicit default ctor
+    Result (Result && r): files(std::move(r.files)), dirs(std::move(r.dirs)), errors(std::move(r.errors))
+    {
+
+    }
+
+    Result & operator=(Result&& r)
+    {
+        files = std::move(r.files);
+        dirs = std::move(r.dirs);
+        errors = std::move(r.errors);
+
+        return *this;
+    }
+};
+
+#endif // CONCURENCY_RESULT_H
@@ -0,0 +1,48 @@
+#ifndef CONCURENCY_SCOPED_THREAD_H
+#define CONCURENCY_SCOPED_THREAD_H
+
+#include <thread>
+#include <utility>
+
+// Thread wrapper class to have scoped execution (see concurency8)
+
+
+class scoped_thread
+{
+    std::thread _t;
+
+public:
+
+    scoped_thread() = delete ;
+    scoped_thread(const scoped_thread  &) = delete;
+    scoped_thread& operator=(scoped_thread const&) = delete;
+
+    scoped_thread(std::thread t) : _t(std::move(t))
+    {
+    }
+
+    template<typename _Callable, typename... _Args>
+      explicit
+      scoped_thread(_Callable&& __f, _Args&&... __args): _t(__f, __args...)
+      {}
+
+
+    void detach()
+    {
+        _t.detach();
+    }
+
+    bool joinable()
+    {
+        return _t.joinable();
+    }
+
+    ~scoped_thread()
+    {
+
+        if (_t.joinable())
+            _t.join();
+    }
+};
+
+#endif // CONCURENCY_SCOPED_THREAD_H
@@ -0,0 +1,142 @@
+#ifndef CONCURENCY_SELECT_H
+#define CONCURENCY_SELECT_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <initializer_list>
+#include <mutex>
+#include <vector>
+
+/*
+ * Waiting on several queues at once.
+ *
+ * A server blocked in MessageQueue::recieve can only be woken by a message on that one queue.
+ * To listen to a work queue and a control queue, the server would need a thread per queue,
+ * or poll them in a loop (burning CPU, or sleeping and answering late).
+ *
+ * select() gives the waiting thread ONE wakeup object (SelectWaiter) and attaches it
+ * to all the queues. Every send() on any of them signals it:
+ *
+ *   int i = select({ &control, &work });      // index of a queue with a message
+ *   if (i == 0 && control.try_receive(cmd)) ...
+ *   if (i == 1 && work.try_receive(job)) ...
+ *
+ * select only tells which queue has a message; another server may take it first,
+ * so the caller uses try_receive and goes back to select when it gets nothing.
+ */
+
+/// One wakeup per selecting thread. Signalled by the queues, consumed by select.
+class SelectWaiter
+{
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    bool _signalled;
+
+public:
+    SelectWaiter() : _signalled(false) {}
+
+    void signal()
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        _signalled = true;
+        _cond.notify_one();
+    }
+
+    /// false on timeout
+    template<typename Clock, typename Duration>
+    bool waitUntil(const std::chrono::time_point<Clock, Duration>& deadline)
+    {
+        std::unique_lock<std::mutex> lck(_mutex);
+        bool ok = _cond.wait_until(lck, deadline, [this] { return _signalled; });
+        _signalled = false;
+        return ok;
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lck(_mutex);
+        _cond.wait(lck, [this] { return _signalled; });
+        _signalled = false;
+    }
+};
+
+/// What select needs from a queue. attach/detach and the signal from send
+/// happen under the queue's mutex, so a detached waiter is never signalled again.
+class SelectableQueue
+{
+public:
+    virtual ~SelectableQueue() {}
+    virtual bool ready() = 0;
+    virtual void attach(SelectWaiter* waiter) = 0;
+    virtual void detach(SelectWaiter* waiter) = 0;
+};
+
+/// Keeps the waiters of one queue. Used by the queues under their own mutex.
+class SelectWaiterList
+{
+    std::vector<SelectWaiter*> _waiters;
+
+public:
+    void add(SelectWaiter* w) { _waiters.push_back(w); }
+
+    void remove(SelectWaiter* w)
+    {
+        _waiters.erase(std::remove(_waiters.begin(), _waiters.end(), w), _waiters.end());
+    }
+
+    void signalAll()
+    {
+        for (SelectWaiter* w : _waiters)
+            w->signal();
+    }
+};
+
+namespace select_detail
+{
+    inline int firstReady(const std::vector<SelectableQueue*>& queues)
+    {
+        for (std::size_t i = 0; i < queues.size(); ++i)
+            if (queues[i]->ready())
+                return static_cast<int>(i);
+        return -1;
+    }
+
+    /// wait(waiter) returns false when select should give up
+    template<typename Wait>
+    int select(std::initializer_list<SelectableQueue*> list, Wait wait)
+    {
+        std::vector<SelectableQueue*> queues(list);
+        SelectWaiter waiter;
+        // attach first, then look - a message sent in between signals the waiter
+        for (SelectableQueue* q : queues)
+            q->attach(&waiter);
+
+        int index;
+        while ((index = firstReady(queues)) < 0)
+        {
+            if (!wait(waiter))
+                break;
+        }
+
+        for (SelectableQueue* q : queues)
+            q->detach(&waiter);
+        return index;
+    }
+}
+
+/// Blocks until one of the queues is not empty and returns its index.
+inline int select(std::initializer_list<SelectableQueue*> queues)
+{
+    return select_detail::select(queues, [](SelectWaiter& w) { w.wait(); return true; });
+}
+
+/// Like select, but returns -1 if no queue got a message within the timeout.
+template<typename Rep, typename Period>
+int selectFor(std::initializer_list<SelectableQueue*> queues, std::chrono::duration<Rep, Period> timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    return select_detail::select(queues, [deadline](SelectWaiter& w) { return w.waitUntil(deadline); });
+}
+
+#endif // CONCURENCY_SELECT_H
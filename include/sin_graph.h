@@ -0,0 +1,195 @@
+#ifndef CONCURENCY_SIN_GRAPH_H
+#define CONCURENCY_SIN_GRAPH_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+/*
+ * The sin graph of concurency2 for big inputs.
+ *
+ * concurency2 computes sin over the whole list on one thread, then display_graph prints
+ * it: cout.put per star and std::endl - a flush, a write syscall - per row. For 1e7 points
+ * that's 1e7 syscalls, and nothing is printed before the last sin is computed.
+ *
+ * sinGraphPipeline runs it as two stages with fixed-size chunks:
+ *
+ *   transform thread:  sin into chunk slot 0 | sin into slot 1 | sin into slot 0 | ...
+ *   render (caller):                         | rows of slot 0   | rows of slot 1   | ...
+ *
+ * There are two slots (double buffering): the transform stage fills one while the render
+ * stage formats the other. The slots and the render buffer are allocated once, a row is a
+ * memcpy of a precomputed row of stars, and the render stage gives its slot back before the
+ * one write() of the chunk, so the write overlaps the next sin too. A handoff is a mutex and
+ * a condition variable - once per chunk, not per element.
+ */
+
+/// Stars of display_graph for y in [-1, 1]: 10 * y + 10.5 of them, then a newline.
+inline int starCount(double y)
+{
+    return static_cast<int>(10 * y + 10.5);
+}
+
+/// Rows of 0..20 stars, precomputed for the render stage.
+class GraphRows
+{
+    static const int MAX_STARS = 20;
+    char _stars[MAX_STARS + 1];
+
+public:
+    static const std::size_t MAX_ROW = MAX_STARS + 1;
+
+    GraphRows()
+    {
+        std::memset(_stars, '*', MAX_STARS);
+        _stars[MAX_STARS] = '\n';
+    }
+
+    /// Writes the row of y to out, returns its length.
+    std::size_t render(double y, char* out) const
+    {
+        int count = starCount(y);
+        count = count < 0 ? 0 : count > MAX_STARS ? MAX_STARS : count;
+        std::memcpy(out, _stars, count);
+        out[count] = '\n';
+        return static_cast<std::size_t>(count) + 1;
+    }
+};
+
+/// write() all of it, throws std::system_error when it can't.
+inline void writeAll(int fd, const char* data, std::size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "sin graph write");
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+}
+
+/// The concurency2 way: sin over everything, then cout.put per star and std::endl per row.
+template<typename It>
+void sinThenGraph(It first, It last, std::ostream& os)
+{
+    std::vector<double> ys;
+    for (It it = first; it != last; ++it)
+        ys.push_back(std::sin(*it));
+    for (double y : ys)
+    {
+        int count = starCount(y);
+        for (int i = 0; i < count; ++i)
+            os.put('*');
+        os << std::endl;
+    }
+}
+
+/// The graph of sin over [first, last) written to fd, two stages, chunk points at a time.
+/// Returns the bytes written. The iterators are read by the transform thread only.
+template<typename It>
+std::size_t sinGraphPipeline(It first, It last, int fd, std::size_t chunk = 65536)
+{
+    struct Slot
+    {
+        std::vector<double> values;
+        std::size_t count;
+        bool full;
+    };
+
+    chunk = std::max<std::size_t>(chunk, 1);
+    Slot slots[2];
+    for (Slot& s : slots)
+    {
+        s.values.resize(chunk);
+        s.count = 0;
+        s.full = false;
+    }
+    bool done = false;      // the transform is finished
+    bool stop = false;      // the render failed, the transform must not wait for it
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    std::thread transform([&]
+    {
+        It it = first;
+        for (std::size_t i = 0; it != last; i ^= 1)
+        {
+            Slot& s = slots[i];
+            {
+                std::unique_lock<std::mutex> lck(mutex);
+                changed.wait(lck, [&] { return !s.full || stop; });
+                if (stop)
+                    break;
+            }
+            std::size_t n = 0;
+            for (; n < chunk && it != last; ++n, ++it)
+                s.values[n] = std::sin(*it);
+            {
+                std::lock_guard<std::mutex> lck(mutex);
+                s.count = n;
+                s.full = true;
+            }
+            changed.notify_all();
+        }
+        {
+            std::lock_guard<std::mutex> lck(mutex);
+            done = true;
+        }
+        changed.notify_all();
+    });
+
+    GraphRows rows;
+    std::vector<char> buffer(chunk * GraphRows::MAX_ROW);
+    std::size_t written = 0;
+    try
+    {
+        for (std::size_t i = 0;; i ^= 1)
+        {
+            Slot& s = slots[i];
+            {
+                std::unique_lock<std::mutex> lck(mutex);
+                changed.wait(lck, [&] { return s.full || done; });
+                if (!s.full)
+                    break;      // done, and the transform doesn't fill slots out of turn
+            }
+            std::size_t bytes = 0;
+            for (std::size_t k = 0; k < s.count; ++k)
+                bytes += rows.render(s.values[k], buffer.data() + bytes);
+            {
+                std::lock_guard<std::mutex> lck(mutex);
+                s.full = false;
+            }
+            changed.notify_all();
+            writeAll(fd, buffer.data(), bytes);
+            written += bytes;
+        }
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard<std::mutex> lck(mutex);
+            stop = true;
+        }
+        changed.notify_all();
+        transform.join();
+        throw;
+    }
+    transform.join();
+    return written;
+}
+
+#endif // CONCURENCY_SIN_GRAPH_H
@@ -0,0 +1,471 @@
+#ifndef CONCURENCY_SORTED_OUTPUT_H
+#define CONCURENCY_SORTED_OUTPUT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include "executor.h"
+#include "filesystem.h"
+
+/*
+ * Sorted output of a crawl.
+ *
+ * The workers of concurency6 and concurency7 finish the directories in whatever order the
+ * scheduler likes, so two crawls of one tree never print the same. Sorting the whole vector
+ * at the end is one thread doing n log n while the others wait. Instead every worker sorts
+ * what it found (a run) and hands it over with add(); in the end the runs are merged:
+ *
+ *  merge()     - in parallel: the runs are cut at parts - 1 splitters (quantiles of a sample
+ *                of all runs), so every part of the output comes from a known range of every
+ *                run and has a known place in it. Each part is merged by a task on the executor
+ *                with its own loser tree, straight into its slice of the result.
+ *  forEach(f)  - one loser tree over all the runs, f gets the paths in order, nothing is collected.
+ *
+ * A loser tree merges k runs with log k comparisons per element: the leaves are the runs, every
+ * inner node keeps the loser of the match played there, the root the overall winner. When the
+ * winner is taken, only its way up to the root is replayed.
+ *
+ * With a memory budget the runs don't all stay in memory: once they take more than the budget
+ * they are merged into one run which goes to a temporary file (external merge sort). merge()
+ * and forEach() then read the file runs back along with the ones still in memory - forEach
+ * is the one which doesn't need the memory for everything.
+ *
+ *   SortedRuns sorted(64 << 20);
+ *   // in every worker:
+ *   sorted.add(std::move(myFiles));
+ *   // after the crawl:
+ *   sorted.forEach([](const std::string& path) { std::cout << path << "\n"; });
+ *
+ * add() may be called from any number of threads, merge() / forEach() once, after the last add().
+ */
+
+/// Merges the runs of cursors (done(), head(), next()) - see above.
+template<typename Cursor>
+class LoserTree
+{
+    std::vector<Cursor>& _runs;
+    std::vector<std::size_t> _tree;     // [0] the winner, [1, k) the losers of the inner nodes
+    std::size_t _k;
+
+    bool beats(std::size_t a, std::size_t b) const
+    {
+        if (_runs[a].done())
+            return false;
+        if (_runs[b].done())
+            return true;
+        return _runs[a].head() < _runs[b].head();
+    }
+
+    /// Node n >= k is the leaf of run n - k.
+    std::size_t build(std::size_t n)
+    {
+        if (n >= _k)
+            return n - _k;
+        std::size_t l = build(2 * n), r = build(2 * n + 1);
+        if (beats(l, r))
+        {
+            _tree[n] = r;
+            return l;
+        }
+        _tree[n] = l;
+        return r;
+    }
+
+public:
+    explicit LoserTree(std::vector<Cursor>& runs) : _runs(runs), _tree(std::max<std::size_t>(runs.size(), 1)), _k(runs.size())
+    {
+        if (_k > 0)
+            _tree[0] = build(1);
+    }
+
+    bool done() const { return _k == 0 || _runs[_tree[0]].done(); }
+
+    /// The run with the smallest head.
+    Cursor& top() { return _runs[_tree[0]]; }
+
+    /// Advances the top run and replays its way up.
+    void pop()
+    {
+        std::size_t winner = _tree[0];
+        _runs[winner].next();
+        for (std::size_t n = (winner + _k) / 2; n > 0; n /= 2)
+            if (beats(_tree[n], winner))
+                std::swap(_tree[n], winner);
+        _tree[0] = winner;
+    }
+};
+
+class SortedRuns
+{
+public:
+    /// A run in memory - [pos, end) of a vector.
+    struct MemoryCursor
+    {
+        std::string* pos;
+        std::string* end;
+
+        bool done() const { return pos == end; }
+        std::string& head() { return *pos; }
+        const std::string& head() const { return *pos; }
+        void next() { ++pos; }
+    };
+
+    /// A run in memory or in the spill file.
+    class RunCursor
+    {
+        MemoryCursor _mem;
+        std::unique_ptr<std::ifstream> _file;
+        std::unique_ptr<char[]> _buffer;
+        std::size_t _left;
+        std::string _head;
+        bool _done;
+
+        void read()
+        {
+            if (_left == 0)
+            {
+                _done = true;
+                return;
+            }
+            std::uint32_t len = 0;
+            _file->read(reinterpret_cast<char*>(&len), sizeof(len));
+            _head.resize(len);
+            if (len)
+                _file->read(&_head[0], len);
+            if (!*_file)
+                throw std::runtime_error("SortedRuns: read from the spill file failed");
+            --_left;
+        }
+
+    public:
+        explicit RunCursor(MemoryCursor mem) : _mem(mem), _left(0), _done(false) {}
+
+        RunCursor(const fs::path& file, std::uint64_t offset, std::size_t count)
+            : _mem(MemoryCursor{ nullptr, nullptr }), _file(new std::ifstream), _buffer(new char[1 << 16]),
+              _left(count), _done(false)
+        {
+            _file->rdbuf()->pubsetbuf(_buffer.get(), 1 << 16);
+            _file->open(file.string(), std::ios::in | std::ios::binary);
+            _file->seekg(static_cast<std::streamoff>(offset));
+            read();
+        }
+
+        bool done() const { return _file ? _done : _mem.done(); }
+        const std::string& head() const { return _file ? _head : _mem.head(); }
+        void next()
+        {
+            if (_file)
+                read();
+            else
+                _mem.next();
+        }
+    };
+
+private:
+    struct Extent
+    {
+        std::uint64_t offset;
+        std::size_t count;
+    };
+
+    std::size_t _memoryBudget;          // bytes of the runs in memory, 0 - no limit
+    std::vector<std::vector<std::string>> _runs;
+    std::size_t _memBytes;
+    std::size_t _size;
+    std::size_t _peakMemBytes;
+    std::mutex _mutex;
+
+    fs::path _spillPath;
+    std::ofstream _spill;
+    std::uint64_t _spillEnd;
+    std::vector<Extent> _extents;
+    std::size_t _spilled;
+    std::mutex _spillMutex;             // one spill at a time, the adds go on meanwhile
+
+    static std::size_t runBytes(const std::vector<std::string>& run)
+    {
+        std::size_t n = run.capacity() * sizeof(std::string);
+        for (const std::string& s : run)
+            if (s.capacity() > 15)      // longer ones live on the heap
+                n += s.capacity() + 1;
+        return n;
+    }
+
+    /// Merges runs into one extent of the spill file.
+    void spill(std::vector<std::vector<std::string>> runs)
+    {
+        std::lock_guard<std::mutex> lck(_spillMutex);
+        if (!_spill.is_open())
+        {
+            static std::atomic<int> counter(0);
+            _spillPath = fs::temp_directory_path() /
+                         ("concurency_runs_" + std::to_string(::getpid()) + "_" + std::to_string(counter++));
+            _spill.open(_spillPath.string(), std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!_spill)
+                throw std::runtime_error("SortedRuns: can't create " + _spillPath.string());
+            _spillEnd = 0;
+        }
+
+        std::vector<MemoryCursor> cursors;
+        for (std::vector<std::string>& run : runs)
+            cursors.push_back(MemoryCursor{ run.data(), run.data() + run.size() });
+        Extent e = { _spillEnd, 0 };
+        for (LoserTree<MemoryCursor> tree(cursors); !tree.done(); tree.pop())
+        {
+            const std::string& s = tree.top().head();
+            std::uint32_t len = static_cast<std::uint32_t>(s.size());
+            _spill.write(reinterpret_cast<const char*>(&len), sizeof(len));
+            _spill.write(s.data(), len);
+            ++e.count;
+        }
+        if (!_spill)
+            throw std::runtime_error("SortedRuns: write to " + _spillPath.string() + " failed");
+        _spillEnd = static_cast<std::uint64_t>(_spill.tellp());
+
+        std::lock_guard<std::mutex> lck2(_mutex);
+        _extents.push_back(e);
+        _spilled += e.count;
+    }
+
+    /// Cursors over everything, the runs in memory stay where they are.
+    std::vector<RunCursor> cursors()
+    {
+        std::vector<RunCursor> result;
+        for (std::vector<std::string>& run : _runs)
+            result.push_back(RunCursor(MemoryCursor{ run.data(), run.data() + run.size() }));
+        if (!_extents.empty())
+        {
+            _spill.flush();
+            for (const Extent& e : _extents)
+                result.push_back(RunCursor(_spillPath, e.offset, e.count));
+        }
+        return result;
+    }
+
+    /// Merges [from[r], to[r]) of every run into out.
+    static void mergePart(std::vector<std::vector<std::string>>& runs, std::vector<std::size_t> from,
+                          std::vector<std::size_t> to, std::string* out)
+    {
+        std::vector<MemoryCursor> cursors;
+        for (std::size_t r = 0; r < runs.size(); ++r)
+            if (from[r] < to[r])
+                cursors.push_back(MemoryCursor{ runs[r].data() + from[r], runs[r].data() + to[r] });
+        for (LoserTree<MemoryCursor> tree(cursors); !tree.done(); tree.pop())
+            *out++ = std::move(tree.top().head());
+    }
+
+public:
+    explicit SortedRuns(std::size_t memoryBudget = 0)
+        : _memoryBudget(memoryBudget), _memBytes(0), _size(0), _peakMemBytes(0), _spillEnd(0), _spilled(0) {}
+
+    ~SortedRuns()
+    {
+        if (_spill.is_open())
+        {
+            _spill.close();
+            std::error_code ec;
+            fs::remove(_spillPath, ec);
+        }
+    }
+
+    SortedRuns(const SortedRuns&) = delete;
+    SortedRuns& operator=(const SortedRuns&) = delete;
+
+    /// Sorts run (in the calling thread) and keeps it - or spills, when it's over the budget.
+    void add(std::vector<std::string> run)
+    {
+        if (run.empty())
+            return;
+        std::sort(run.begin(), run.end());
+        std::size_t bytes = runBytes(run);
+
+        std::vector<std::vector<std::string>> toSpill;
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            _size += run.size();
+            _memBytes += bytes;
+            _runs.push_back(std::move(run));
+            if (_memBytes > _peakMemBytes)
+                _peakMemBytes = _memBytes;
+            if (_memoryBudget && _memBytes > _memoryBudget)
+            {
+                toSpill.swap(_runs);
+                _memBytes = 0;
+            }
+        }
+        if (!toSpill.empty())
+            spill(std::move(toSpill));
+    }
+
+    /// Everything sorted. In memory the parts are merged in parallel on the executor;
+    /// with spilled runs it is one merge over all of them.
+    std::vector<std::string> merge(Executor& executor = defaultExecutor(), int parts = 4)
+    {
+        std::lock_guard<std::mutex> spillLck(_spillMutex);
+        std::lock_guard<std::mutex> lck(_mutex);
+        std::vector<std::string> out;
+        out.reserve(_size);
+        if (!_extents.empty())
+        {
+            std::vector<RunCursor> all = cursors();
+            for (LoserTree<RunCursor> tree(all); !tree.done(); tree.pop())
+                out.push_back(tree.top().head());
+            return out;
+        }
+
+        // splitters - the quantiles of a sample: every step-th path over all the runs,
+        // about 256 per part however many (small) runs there are
+        std::vector<std::string> sample;
+        std::size_t step = std::max<std::size_t>(1, _size / (256 * parts)), skip = 0;
+        for (const std::vector<std::string>& run : _runs)
+        {
+            std::size_t i = skip;
+            for (; i < run.size(); i += step)
+                sample.push_back(run[i]);
+            skip = i - run.size();
+        }
+        std::sort(sample.begin(), sample.end());
+        std::vector<std::string> splitters;
+        for (int p = 1; p < parts && !sample.empty(); ++p)
+            splitters.push_back(sample[sample.size() * p / parts]);
+
+        // cut every run at the splitters, a part starts where the ones before it end
+        std::size_t n = splitters.size() + 1;
+        std::vector<std::vector<std::size_t>> cut(n + 1, std::vector<std::size_t>(_runs.size()));
+        for (std::size_t r = 0; r < _runs.size(); ++r)
+        {
+            for (std::size_t p = 1; p < n; ++p)
+                cut[p][r] = std::lower_bound(_runs[r].begin(), _runs[r].end(), splitters[p - 1]) - _runs[r].begin();
+            cut[n][r] = _runs[r].size();
+        }
+
+        out.resize(_size);
+        std::vector<std::future<void>> futures;
+        std::size_t offset = 0;
+        try
+        {
+            for (std::size_t p = 0; p < n; ++p)
+            {
+                futures.push_back(spawn(executor, &SortedRuns::mergePart, std::ref(_runs), cut[p], cut[p + 1],
+                                        out.data() + offset));
+                for (std::size_t r = 0; r < _runs.size(); ++r)
+                    offset += cut[p + 1][r] - cut[p][r];
+            }
+            for (std::future<void>& f : futures)
+                awaitFuture(executor, f);
+        }
+        catch (...)
+        {
+            waitAll(executor, futures);
+            throw;
+        }
+        _runs.clear();
+        _memBytes = 0;
+        return out;
+    }
+
+    /// f(const std::string&) for every path in order - one merge, nothing is collected.
+    template<typename F>
+    void forEach(F f)
+    {
+        std::lock_guard<std::mutex> spillLck(_spillMutex);
+        std::lock_guard<std::mutex> lck(_mutex);
+        std::vector<RunCursor> all = cursors();
+        for (LoserTree<RunCursor> tree(all); !tree.done(); tree.pop())
+            f(tree.top().head());
+    }
+
+    std::size_t size()
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _size;
+    }
+
+    std::size_t runs()
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _runs.size() + _extents.size();
+    }
+
+    /// Paths which went through the spill file.
+    std::size_t spilled()
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _spilled;
+    }
+
+    /// Most bytes the runs took in memory at once (approximately).
+    std::size_t peakMemoryBytes()
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _peakMemBytes;
+    }
+};
+
+/// Paths a crawl collects before they go to SortedRuns as one run.
+constexpr std::size_t CRAWL_RUN_SIZE = 65536;
+
+/// The smallest memory budget taken from a user - below it nearly every add() spills.
+constexpr std::size_t MIN_MEMORY_BUDGET = std::size_t(1) << 20;
+
+/// A memory budget in bytes (CONCURENCY_SORT_BUDGET of concurency6 / concurency7), 0 - no limit.
+/// False for anything but a number, and for a budget under MIN_MEMORY_BUDGET.
+inline bool parseMemoryBudget(const char* text, std::size_t& budget)
+{
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = std::strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || *text == '-')
+        return false;
+    if (value != 0 && value < MIN_MEMORY_BUDGET)
+        return false;
+    budget = static_cast<std::size_t>(value);
+    return true;
+}
+
+/*
+ * The paths of one crawl worker. A run per directory would be a handful of paths - the merge
+ * would have as many runs as directories. The buffer instead keeps what the worker found over
+ * many directories and add()s it once runSize paths are there (sorted in the worker), the rest
+ * when the crawl is over (flush()). One buffer has one writer at a time.
+ */
+class RunBuffer
+{
+    SortedRuns* _sorted;
+    std::size_t _runSize;
+    std::vector<std::string> _paths;
+
+public:
+    explicit RunBuffer(SortedRuns* sorted, std::size_t runSize = CRAWL_RUN_SIZE)
+        : _sorted(sorted), _runSize(runSize) {}
+
+    void push(std::string&& path)
+    {
+        _paths.push_back(std::move(path));
+        if (_paths.size() >= _runSize)
+            flush();
+    }
+
+    void flush()
+    {
+        if (_paths.empty())
+            return;
+        _sorted->add(std::move(_paths));
+        _paths.clear();
+    }
+};
+
+#endif // CONCURENCY_SORTED_OUTPUT_H
@@ -0,0 +1,212 @@
+#ifndef CONCURENCY_SPSC_CHANNEL_H
+#define CONCURENCY_SPSC_CHANNEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <thread>
+#include "cache_line.h"
+
+/*
+ * Single producer / single consumer ring buffer.
+ *
+ * MessageQueue serializes all the senders on one mutex. When we know that a channel
+ * has exactly one sender and one reciever we don't need any lock: the producer
+ * is the only one who moves the tail, the consumer is the only one who moves the head.
+ * try_send and try_receive finish in a bounded number of steps (wait-free).
+ *
+ * To avoid ping-ponging cache lines between the two threads:
+ *  - head and tail live on separate cache lines,
+ *  - each side keeps a cached copy of the other side's index and reads
+ *    the shared one only when the cached copy says full / empty,
+ *  - the producer publishes its tail only every `batch` messages (or on flush/close),
+ *    so the consumer sees messages in bursts instead of one cache miss per message.
+ */
+
+template<typename T>
+class SpscChannel
+{
+    std::vector<T> _slots;
+    std::size_t _mask;
+    std::size_t _batch;
+
+    char _pad0[CACHE_LINE_SIZE];
+
+    // written by producer, read by consumer
+    std::atomic<std::size_t> _tail;
+    std::atomic<bool> _closed;
+    char _pad1[CACHE_LINE_SIZE];
+
+    // producer only
+    std::size_t _writeIndex;
+    std::size_t _published;
+    std::size_t _headCache;
+    char _pad2[CACHE_LINE_SIZE];
+
+    // written by consumer, read by producer
+    std::atomic<std::size_t> _head;
+    char _pad3[CACHE_LINE_SIZE];
+
+    // consumer only
+    std::size_t _readIndex;
+    std::size_t _tailCache;
+    char _pad4[CACHE_LINE_SIZE];
+
+public:
+    /// capacity is rounded up to power of two
+    explicit SpscChannel(std::size_t capacity = 1024, std::size_t batch = 16)
+        : _batch(batch ? batch : 1), _tail(0), _closed(false),
+          _writeIndex(0), _published(0), _headCache(0), _head(0), _readIndex(0), _tailCache(0)
+    {
+        std::size_t c = 1;
+        while (c < capacity || c < _batch)
+            c <<= 1;
+        _slots.resize(c);
+        _mask = c - 1;
+    }
+
+    SpscChannel(const SpscChannel&) = delete;
+    SpscChannel& operator=(const SpscChannel&) = delete;
+
+    std::size_t capacity() const { return _slots.size(); }
+
+    // ---- producer side ----
+
+    /// Returns false when the channel is full. The message is not moved from in that case.
+    bool try_send(T&& message)
+    {
+        std::size_t w = _writeIndex;
+        if (w - _headCache == _slots.size())
+        {
+            _headCache = _head.load(std::memory_order_acquire);
+            if (w - _headCache == _slots.size())
+            {
+                //consumer can't see what we have not published yet
+                flush();
+                return false;
+            }
+        }
+
+        _slots[w & _mask] = std::move(message);
+        _writeIndex = w + 1;
+
+        if (_writeIndex - _published >= _batch)
+            flush();
+        return true;
+    }
+
+    /// Blocking send: yields while the consumer catches up.
+    void send(T&& message)
+    {
+        while (!try_send(std::move(message)))
+            std::this_thread::yield();
+    }
+
+    /// Makes all sent messages visible to the consumer.
+    void flush()
+    {
+        if (_published != _writeIndex)
+        {
+            _published = _writeIndex;
+            _tail.store(_writeIndex, std::memory_order_release);
+        }
+    }
+
+    /// Producer is done. Flushes the pending messages.
+    void close()
+    {
+        flush();
+        _closed.store(true, std::memory_order_release);
+    }
+
+    // ---- consumer side ----
+
+    /// Returns false when there is no published message.
+    bool try_receive(T& message)
+    {
+        std::size_t r = _readIndex;
+        if (r == _tailCache)
+        {
+            _tailCache = _tail.load(std::memory_order_acquire);
+            if (r == _tailCache)
+                return false;
+        }
+
+        message = std::move(_slots[r & _mask]);
+        _readIndex = r + 1;
+        _head.store(r + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// True when the producer closed the channel and everything was recieved.
+    bool finished()
+    {
+        // closed has to be checked first: close() publishes the tail before setting it
+        if (!_closed.load(std::memory_order_acquire))
+            return false;
+        return _readIndex == _tail.load(std::memory_order_acquire);
+    }
+};
+
+/*
+ * N producers -> 1 consumer without a shared lock: every producer gets its own lane.
+ * The consumer polls the lanes round robin and takes at most `burst` messages
+ * from a lane before moving to the next one, so a busy producer can't starve the others.
+ */
+template<typename T>
+class SpscLanes
+{
+    std::vector<std::unique_ptr<SpscChannel<T>>> _lanes;
+    std::size_t _burst;
+
+    // consumer only
+    std::size_t _current;
+    std::size_t _takenFromCurrent;
+
+public:
+    SpscLanes(std::size_t lanes, std::size_t capacity = 1024, std::size_t batch = 16, std::size_t burst = 64)
+        : _burst(burst ? burst : 1), _current(0), _takenFromCurrent(0)
+    {
+        for (std::size_t i = 0; i < lanes; ++i)
+            _lanes.push_back(std::unique_ptr<SpscChannel<T>>(new SpscChannel<T>(capacity, batch)));
+    }
+
+    std::size_t size() const { return _lanes.size(); }
+
+    /// Lane for the i-th producer. Only one thread may send through it.
+    SpscChannel<T>& lane(std::size_t i) { return *_lanes[i]; }
+
+    /// Blocks (spinning, then yielding) until a message arrives.
+    /// Returns false when all lanes are closed and drained.
+    bool receive(T& message)
+    {
+        for (unsigned spins = 0;; ++spins)
+        {
+            std::size_t finished = 0;
+            for (std::size_t k = 0; k < _lanes.size(); ++k)
+            {
+                SpscChannel<T>& ch = *_lanes[_current];
+                if (_takenFromCurrent < _burst && ch.try_receive(message))
+                {
+                    ++_takenFromCurrent;
+                    return true;
+                }
+                if (ch.finished())
+                    ++finished;
+
+                _current = (_current + 1) % _lanes.size();
+                _takenFromCurrent = 0;
+            }
+
+            if (finished == _lanes.size())
+                return false;
+
+            //nothing to do - don't steal the CPU from the producers
+            if (spins > 16)
+                std::this_thread::yield();
+        }
+    }
+};
+
+#endif // CONCURENCY_SPSC_CHANNEL_H
@@ -0,0 +1,335 @@
+#ifndef CONCURENCY_TRACE_H
+#define CONCURENCY_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/*
+ * Timeline tracing which can be opened in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Every thread records its events into its own ring buffer, so recording an event
+ * does not take any lock and does not share cache lines with other threads.
+ * When the program ends the buffers are written as Chrome trace-event JSON.
+ *
+ * Tracing is opt-in: create a TraceSession in main and run the program with
+ *   CONCURENCY_TRACE=trace.json ./concurency7
+ * Without the variable a TRACE_SCOPE costs one relaxed atomic load.
+ * Compile with -DCONCURENCY_NO_TRACE to remove the scopes completely.
+ *
+ * Only string literals may be used as category and name - we store the pointers.
+ */
+
+struct TraceEvent
+{
+    const char* category;
+    const char* name;
+    std::uint64_t startNs;
+    std::uint64_t durNs;
+};
+
+/// Single writer (the owning thread) ring buffer. When it is full the oldest events are overwritten.
+class TraceBuffer
+{
+    int _tid;
+    std::string _name;
+    std::vector<TraceEvent> _events;
+    std::size_t _mask;
+    std::atomic<std::size_t> _head;
+
+public:
+    TraceBuffer(int tid, std::size_t capacity)
+        : _tid(tid), _events(capacity), _mask(capacity - 1), _head(0)
+    {
+    }
+
+    int tid() const { return _tid; }
+    const std::string& name() const { return _name; }
+    void setName(const char* name) { _name = name; }
+
+    void push(const TraceEvent& e)
+    {
+        std::size_t h = _head.load(std::memory_order_relaxed);
+        _events[h & _mask] = e;
+        //publish the event for the thread which will write the file
+        _head.store(h + 1, std::memory_order_release);
+    }
+
+    void clear()
+    {
+        _head.store(0, std::memory_order_release);
+    }
+
+    /// Events still held in the buffer, oldest first. Call it when the writer is quiet.
+    template<typename F>
+    void forEach(F f) const
+    {
+        std::size_t h = _head.load(std::memory_order_acquire);
+        std::size_t n = h < _events.size() ? h : _events.size();
+        for (std::size_t i = h - n; i < h; ++i)
+            f(_events[i & _mask]);
+    }
+};
+
+class Tracer
+{
+    /// All buffers ever created. A buffer of finished thread goes to the free list
+    /// and is reused by the next thread, so the thousands of short std::async threads
+    /// from the crawls end up in a few lanes instead of allocating a buffer each.
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<TraceBuffer>> buffers;
+        std::vector<TraceBuffer*> free;
+        std::size_t capacity;
+        std::uint64_t startNs;
+
+        Registry() : capacity(1 << 14), startNs(0) {}
+    };
+
+    struct ThreadSlot
+    {
+        TraceBuffer* buffer;
+
+        ThreadSlot() : buffer(nullptr) {}
+        ~ThreadSlot()
+        {
+            if (buffer)
+                Tracer::release(buffer);
+        }
+    };
+
+    static Registry& registry()
+    {
+        //never destroyed - thread_local slots may give their buffers back during exit
+        static Registry* r = new Registry;
+        return *r;
+    }
+
+    static std::atomic<bool>& enabledFlag()
+    {
+        static std::atomic<bool> flag(false);
+        return flag;
+    }
+
+    static TraceBuffer* acquire()
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lck(r.mutex);
+        if (!r.free.empty())
+        {
+            TraceBuffer* b = r.free.back();
+            r.free.pop_back();
+            return b;
+        }
+        r.buffers.push_back(std::unique_ptr<TraceBuffer>(
+                                new TraceBuffer(static_cast<int>(r.buffers.size()) + 1, r.capacity)));
+        return r.buffers.back().get();
+    }
+
+    static void release(TraceBuffer* b)
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lck(r.mutex);
+        r.free.push_back(b);
+    }
+
+    static TraceBuffer* threadBuffer()
+    {
+        static thread_local ThreadSlot slot;
+        if (!slot.buffer)
+            slot.buffer = acquire();
+        return slot.buffer;
+    }
+
+    static void writeEscaped(std::ostream& os, const char* s)
+    {
+        for (; *s; ++s)
+        {
+            if (*s == '"' || *s == '\\')
+                os << '\\';
+            os << *s;
+        }
+    }
+
+public:
+    static std::uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static bool enabled()
+    {
+        return enabledFlag().load(std::memory_order_relaxed);
+    }
+
+    /// Events per thread buffer, rounded up to power of two. Takes effect for new buffers.
+    static void setCapacity(std::size_t events)
+    {
+        std::size_t c = 1;
+        while (c < events)
+            c <<= 1;
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lck(r.mutex);
+        r.capacity = c;
+    }
+
+    static void enable()
+    {
+        Registry& r = registry();
+        {
+            std::lock_guard<std::mutex> lck(r.mutex);
+            if (r.startNs == 0)
+                r.startNs = now();
+        }
+        enabledFlag().store(true, std::memory_order_relaxed);
+    }
+
+    static void disable()
+    {
+        enabledFlag().store(false, std::memory_order_relaxed);
+    }
+
+    /// Drops all recorded events. Writers have to be quiet.
+    static void clear()
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lck(r.mutex);
+        for (auto& b : r.buffers)
+            b->clear();
+        r.startNs = now();
+    }
+
+    static void record(const char* category, const char* name, std::uint64_t startNs, std::uint64_t endNs)
+    {
+        TraceEvent e = { category, name, startNs, endNs - startNs };
+        threadBuffer()->push(e);
+    }
+
+    /// Name shown for the lane of the calling thread.
+    static void setThreadName(const char* name)
+    {
+        if (enabled())
+            threadBuffer()->setName(name);
+    }
+
+    /// Chrome trace-event format, spans are written as complete ("X") events.
+    static void write(std::ostream& os)
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lck(r.mutex);
+
+        long pid = static_cast<long>(::getpid());
+        bool first = true;
+        os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+
+        for (auto& b : r.buffers)
+        {
+            os << (first ? "\n" : ",\n");
+            first = false;
+            os << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " << pid << ", \"tid\": " << b->tid()
+               << ", \"args\": {\"name\": \"";
+            writeEscaped(os, b->name().empty() ? "worker" : b->name().c_str());
+            os << "\"}}";
+
+            std::uint64_t start = r.startNs;
+            b->forEach([&os, pid, &b, start](const TraceEvent& e)
+            {
+                double ts = e.startNs > start ? (e.startNs - start) / 1000.0 : 0.0;
+                os << ",\n{\"ph\": \"X\", \"cat\": \"";
+                writeEscaped(os, e.category);
+                os << "\", \"name\": \"";
+                writeEscaped(os, e.name);
+                os << "\", \"pid\": " << pid << ", \"tid\": " << b->tid()
+                   << ", \"ts\": " << ts << ", \"dur\": " << e.durNs / 1000.0 << "}";
+            });
+        }
+        os << "\n]}\n";
+    }
+};
+
+/// RAII span: measures the time from construction to the end of the scope.
+class TraceScope
+{
+    const char* _category;
+    const char* _name;
+    std::uint64_t _start;
+
+public:
+    TraceScope(const char* category, const char* name)
+        : _category(category), _name(name), _start(Tracer::enabled() ? Tracer::now() : 0)
+    {
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    ~TraceScope()
+    {
+        if (_start)
+            Tracer::record(_category, _name, _start, Tracer::now());
+    }
+};
+
+/// Locks lck and records a "lock" span, but only if the mutex was contended.
+template<typename Mutex>
+void traceLock(std::unique_lock<Mutex>& lck, const char* name)
+{
+    if (!lck.try_lock())
+    {
+        TraceScope scope("lock", name);
+        lck.lock();
+    }
+}
+
+/// Put it at the beginning of main. If CONCURENCY_TRACE names a file the tracing
+/// is enabled and the trace is written to that file when the session ends.
+class TraceSession
+{
+    std::string _path;
+
+public:
+    TraceSession()
+    {
+        const char* path = std::getenv("CONCURENCY_TRACE");
+        if (path && *path)
+        {
+            _path = path;
+            Tracer::enable();
+            Tracer::setThreadName("main");
+        }
+    }
+
+    TraceSession(const TraceSession&) = delete;
+    TraceSession& operator=(const TraceSession&) = delete;
+
+    ~TraceSession()
+    {
+        if (_path.empty())
+            return;
+
+        Tracer::disable();
+        std::ofstream f(_path);
+        Tracer::write(f);
+    }
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#ifdef CONCURENCY_NO_TRACE
+#define TRACE_SCOPE(category, name)
+#else
+#define TRACE_SCOPE(category, name) TraceScope TRACE_CONCAT(_traceScope, __LINE__)(category, name)
+#endif
+
+#endif // CONCURENCY_TRACE_H
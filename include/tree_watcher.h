@@ -0,0 +1,423 @@
+#ifndef CONCURENCY_TREE_WATCHER_H
+#define CONCURENCY_TREE_WATCHER_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <time.h>
+#include <unistd.h>
+#include "cancellation.h"
+#include "crawl_errors.h"
+#include "filesystem.h"
+#include "message_queue.h"
+#include "trace.h"
+
+/*
+ * A live index of a directory tree.
+ *
+ * The crawls of concurency4 - 7 are one-shot: to see changes the tree has to be listed again.
+ * TreeWatcher crawls once (concurency7 style servers) and puts an inotify watch on every
+ * directory. A dedicated event thread then applies the changes to the index:
+ *
+ *  - create / moved in      - a file is added. A directory is crawled (targeted rescan): files
+ *                             may be created in it before its watch exists.
+ *  - delete / moved out     - the entry is removed, for a directory with everything below it.
+ *  - queue overflow         - the kernel dropped events (fs.inotify.max_queued_events) and
+ *                             doesn't say which, so the whole tree is crawled again and swapped in.
+ *
+ * A watch is added before its directory is listed - an entry created in between is reported
+ * both by the listing and by an event, and applying it twice does no harm.
+ *
+ * The index is a std::map ordered by path, so the subtree of "a/b" is the range
+ * ["a/b/", "a/b0") - '0' is the character after '/'.
+ */
+
+struct WatchStats
+{
+    std::size_t entries;        // files and directories in the index (the root not counted)
+    std::size_t watches;
+    std::uint64_t events;       // inotify events applied
+    std::uint64_t rescans;      // directories crawled after the initial crawl
+    std::uint64_t overflows;
+    std::uint64_t watchErrors;  // inotify_add_watch failed (e.g. fs.inotify.max_user_watches)
+    std::uint64_t scanErrors;   // directories or entries a scan couldn't read (gone meanwhile, EACCES)
+    std::uint64_t eventThreadCpuNs;
+};
+
+class TreeWatcher
+{
+public:
+    typedef std::map<std::string, bool> Index;  // path -> is directory
+
+private:
+    static constexpr std::uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                                IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+    std::string _root;
+    int _fd;        // inotify
+    int _stopFd;    // eventfd, wakes the event thread up for the shutdown
+
+    mutable std::mutex _mutex;              // _index, _suspended
+    mutable std::condition_variable _changed;
+    std::condition_variable _resumed;
+    Index _index;
+    bool _suspended;
+    bool _stop;
+
+    mutable std::mutex _watchMutex;         // _wdPath, _dirWd
+    std::unordered_map<int, std::string> _wdPath;
+    std::map<std::string, int> _dirWd;
+
+    std::atomic<std::uint64_t> _events;
+    std::atomic<std::uint64_t> _rescans;
+    std::atomic<std::uint64_t> _overflows;
+    std::atomic<std::uint64_t> _watchErrors;
+    std::atomic<std::uint64_t> _scanErrors;
+    std::atomic<std::uint64_t> _cpuNs;
+
+    std::thread _thread;
+
+    static std::string subtreeEnd(const std::string& dir)
+    {
+        return dir + "0";
+    }
+
+    void addWatch(const std::string& dir)
+    {
+        int wd = ::inotify_add_watch(_fd, dir.c_str(), WATCH_MASK);
+        if (wd < 0)
+        {
+            ++_watchErrors;
+            return;
+        }
+        std::lock_guard<std::mutex> lck(_watchMutex);
+        _wdPath[wd] = dir;
+        _dirWd[dir] = wd;
+    }
+
+    /// Watch and list one directory. The entries go to out, the subdirectories also to subdirs.
+    void scanDir(const std::string& dir, std::vector<std::pair<std::string, bool>>& out,
+                 std::vector<std::string>& subdirs)
+    {
+        addWatch(dir);
+        // an entry which is gone before its lstat is skipped, the rest of the directory still indexed
+        std::vector<CrawlError> errors;
+        forEachEntry(fs::path(dir), errors, CancellationToken(),
+                     [&](fs::path&& d)
+                     {
+                         out.push_back(std::make_pair(d.string(), true));
+                         subdirs.push_back(d.string());
+                     },
+                     [&](const fs::path& f, const struct stat&)
+                     {
+                         out.push_back(std::make_pair(f.string(), false));
+                     });
+        _scanErrors += errors.size();
+    }
+
+    void initialCrawl(int threads)
+    {
+        MessageQueue<std::string> dirs;
+        std::atomic<int> pending(1);
+        dirs.send(std::string(_root));
+
+        std::vector<std::thread> servers;
+        for (int i = 0; i < threads; ++i)
+        {
+            servers.push_back(std::thread([this, threads, &dirs, &pending]
+            {
+                Tracer::setThreadName("TreeWatcher crawl");
+                std::vector<std::pair<std::string, bool>> entries;
+                std::vector<std::string> subdirs;
+                for (;;)
+                {
+                    std::string dir = dirs.recieve();
+                    if (dir.empty())
+                        break;
+                    {
+                        TRACE_SCOPE("task", "TreeWatcher scan dir");
+                        entries.clear();
+                        subdirs.clear();
+                        scanDir(dir, entries, subdirs);
+                        {
+                            std::lock_guard<std::mutex> lck(_mutex);
+                            _index.insert(entries.begin(), entries.end());
+                        }
+                        pending += static_cast<int>(subdirs.size());
+                        for (std::string& d : subdirs)
+                            dirs.send(std::move(d));
+                    }
+                    if (--pending == 0)
+                    {
+                        for (int k = 0; k < threads; ++k)
+                            dirs.send(std::string());
+                    }
+                }
+            }));
+        }
+        for (std::thread& t : servers)
+            t.join();
+    }
+
+    /// Crawls dir again (event thread) and replaces its part of the index.
+    void rescan(const std::string& dir, bool isRoot)
+    {
+        TRACE_SCOPE("task", "TreeWatcher rescan");
+        ++_rescans;
+        std::vector<std::pair<std::string, bool>> entries;
+        std::vector<std::string> stack(1, dir);
+        while (!stack.empty())
+        {
+            std::string d = std::move(stack.back());
+            stack.pop_back();
+            scanDir(d, entries, stack);
+        }
+
+        std::lock_guard<std::mutex> lck(_mutex);
+        if (isRoot)
+            _index.clear();
+        else
+        {
+            _index.erase(_index.lower_bound(dir + "/"), _index.lower_bound(subtreeEnd(dir)));
+            _index[dir] = true;
+        }
+        _index.insert(entries.begin(), entries.end());
+    }
+
+    void remove(const std::string& path, bool isDir)
+    {
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            _index.erase(path);
+            if (isDir)
+                _index.erase(_index.lower_bound(path + "/"), _index.lower_bound(subtreeEnd(path)));
+        }
+        if (!isDir)
+            return;
+
+        // a directory moved out of the tree is still watched by the kernel
+        std::lock_guard<std::mutex> lck(_watchMutex);
+        auto forget = [this](std::map<std::string, int>::iterator it)
+        {
+            ::inotify_rm_watch(_fd, it->second);
+            _wdPath.erase(it->second);
+            return _dirWd.erase(it);
+        };
+        auto self = _dirWd.find(path);
+        if (self != _dirWd.end())
+            forget(self);
+        for (auto it = _dirWd.lower_bound(path + "/"); it != _dirWd.end() && it->first < subtreeEnd(path); )
+            it = forget(it);
+    }
+
+    void apply(const struct inotify_event* ev, bool& overflow)
+    {
+        if (ev->mask & IN_Q_OVERFLOW)
+        {
+            ++_overflows;
+            overflow = true;
+            return;
+        }
+
+        std::string dir;
+        {
+            std::lock_guard<std::mutex> lck(_watchMutex);
+            auto it = _wdPath.find(ev->wd);
+            if (it == _wdPath.end())
+                return;
+            if (ev->mask & IN_IGNORED)
+            {
+                // the directory is gone, the kernel dropped the watch
+                auto dw = _dirWd.find(it->second);
+                if (dw != _dirWd.end() && dw->second == ev->wd)
+                    _dirWd.erase(dw);
+                _wdPath.erase(it);
+                return;
+            }
+            dir = it->second;
+        }
+        if (ev->len == 0)
+            return;
+
+        ++_events;
+        std::string path = dir + "/" + ev->name;
+        bool isDir = (ev->mask & IN_ISDIR) != 0;
+        if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+        {
+            if (isDir)
+                rescan(path, false);
+            else
+            {
+                std::lock_guard<std::mutex> lck(_mutex);
+                _index[path] = false;
+            }
+        }
+        else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+        {
+            remove(path, isDir);
+        }
+    }
+
+    void eventLoop()
+    {
+        Tracer::setThreadName("TreeWatcher events");
+        alignas(struct inotify_event) char buffer[64 * 1024];
+        struct pollfd fds[2] = { { _fd, POLLIN, 0 }, { _stopFd, POLLIN, 0 } };
+
+        for (;;)
+        {
+            if (::poll(fds, 2, -1) < 0 && errno != EINTR)
+                break;
+            {
+                std::unique_lock<std::mutex> lck(_mutex);
+                _resumed.wait(lck, [this] { return !_suspended || _stop; });
+                if (_stop)
+                    break;
+            }
+
+            bool overflow = false;
+            {
+                TRACE_SCOPE("task", "TreeWatcher events");
+                for (;;)
+                {
+                    ssize_t n = ::read(_fd, buffer, sizeof(buffer));
+                    if (n <= 0)
+                        break;  // EAGAIN - drained
+                    for (char* p = buffer; p < buffer + n; )
+                    {
+                        const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(p);
+                        apply(ev, overflow);
+                        p += sizeof(struct inotify_event) + ev->len;
+                    }
+                }
+                if (overflow)
+                    rescan(_root, true);
+            }
+            _changed.notify_all();
+
+            struct timespec ts;
+            ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+            _cpuNs = static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+        }
+    }
+
+public:
+    /// Crawls root with crawlThreads servers and starts watching.
+    /// Throws std::system_error if inotify isn't available.
+    explicit TreeWatcher(const std::string& root, int crawlThreads = 4)
+        : _root(root), _fd(-1), _stopFd(-1), _suspended(false), _stop(false),
+          _events(0), _rescans(0), _overflows(0), _watchErrors(0), _scanErrors(0), _cpuNs(0)
+    {
+        while (_root.size() > 1 && _root.back() == '/')
+            _root.pop_back();
+
+        _fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (_fd < 0)
+            throw std::system_error(errno, std::generic_category(), "inotify_init1");
+        _stopFd = ::eventfd(0, EFD_CLOEXEC);
+        if (_stopFd < 0)
+        {
+            int err = errno;
+            ::close(_fd);
+            throw std::system_error(err, std::generic_category(), "eventfd");
+        }
+
+        initialCrawl(crawlThreads > 0 ? crawlThreads : 1);
+        _thread = std::thread(&TreeWatcher::eventLoop, this);
+    }
+
+    ~TreeWatcher()
+    {
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            _stop = true;
+        }
+        _resumed.notify_all();
+        std::uint64_t one = 1;
+        ssize_t written = ::write(_stopFd, &one, sizeof(one));
+        (void)written;
+        _thread.join();
+        ::close(_stopFd);
+        ::close(_fd);
+    }
+
+    TreeWatcher(const TreeWatcher&) = delete;
+    TreeWatcher& operator=(const TreeWatcher&) = delete;
+
+    const std::string& root() const { return _root; }
+
+    bool contains(const std::string& path) const
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _index.count(path) != 0;
+    }
+
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _index.size();
+    }
+
+    Index snapshot() const
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        return _index;
+    }
+
+    /// Waits until pred(index) holds - checked after every batch of events. false on timeout.
+    template<typename Pred>
+    bool waitFor(Pred pred, std::chrono::milliseconds timeout) const
+    {
+        std::unique_lock<std::mutex> lck(_mutex);
+        return _changed.wait_for(lck, timeout, [&] { return pred(static_cast<const Index&>(_index)); });
+    }
+
+    /// Stops applying events, the kernel keeps queueing them. If the kernel queue fills
+    /// up meanwhile, resume() ends in a full rescan.
+    void suspend()
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        _suspended = true;
+    }
+
+    void resume()
+    {
+        {
+            std::lock_guard<std::mutex> lck(_mutex);
+            _suspended = false;
+        }
+        _resumed.notify_all();
+    }
+
+    WatchStats stats() const
+    {
+        WatchStats s;
+        s.entries = size();
+        {
+            std::lock_guard<std::mutex> lck(_watchMutex);
+            s.watches = _wdPath.size();
+        }
+        s.events = _events;
+        s.rescans = _rescans;
+        s.overflows = _overflows;
+        s.watchErrors = _watchErrors;
+        s.scanErrors = _scanErrors;
+        s.eventThreadCpuNs = _cpuNs;
+        return s;
+    }
+};
+
+#endif // CONCURENCY_TREE_WATCHER_H
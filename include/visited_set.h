@@ -0,0 +1,194 @@
+#ifndef CONCURENCY_VISITED_SET_H
+#define CONCURENCY_VISITED_SET_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "read_mostly.h"
+
+/*
+ * The set of directories a crawl has been in, by (device, inode).
+ *
+ * When the crawl follows symlinks (or meets a bind mount) the same physical directory shows up
+ * under many paths, and a link to a parent makes the tree infinite. Before a worker lists a
+ * directory it inserts its (st_dev, st_ino): only the worker whose insert was first lists it.
+ *
+ * Every worker inserts every directory, so the set must not become the lock all of them wait
+ * for. It is split into 64 shards by the hash; a shard is an open addressing table (linear
+ * probing) and an insert claims a free slot with one compare_exchange:
+ *
+ *   state 0 - free, 1 - being written, >= 2 - the tag (hash) of the key in dev / ino
+ *
+ * The writer of a slot fills dev and ino and then publishes the tag (release); somebody who
+ * probes the slot meanwhile waits for the tag. Slots are never freed, a key never moves - except
+ * when a shard grows: the inserts hold the shard's SharedReadMutex (include/read_mostly.h)
+ * shared, the one which doubles the table holds it exclusive. A shard grows at 70 % load.
+ */
+
+class VisitedSet
+{
+    static const int SHARD_BITS = 6;
+    static const std::size_t SHARDS = std::size_t(1) << SHARD_BITS;
+    static const std::uint64_t FREE = 0;
+    static const std::uint64_t BUSY = 1;
+
+    struct Slot
+    {
+        std::atomic<std::uint64_t> state;
+        std::uint64_t dev;
+        std::uint64_t ino;
+    };
+
+    struct Shard
+    {
+        SharedReadMutex growLock;
+        std::unique_ptr<Slot[]> slots;
+        std::size_t mask;
+        std::atomic<std::size_t> count;
+
+        Shard() : growLock(4), mask(0), count(0) {}
+    };
+
+    enum class Insert { Added, Present, Full };
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+
+    static std::uint64_t hash(std::uint64_t dev, std::uint64_t ino)
+    {
+        // splitmix64 finalizer over both words
+        std::uint64_t h = ino ^ (dev * 0x9e3779b97f4a7c15ull);
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+        return h ^ (h >> 31);
+    }
+
+    static std::uint64_t tag(std::uint64_t h) { return h | 2; }
+
+    static std::size_t limit(std::size_t mask) { return (mask + 1) / 10 * 7; }
+
+    /// Called with the shard's growLock held shared.
+    static Insert tryInsert(Shard& sh, std::uint64_t h, std::uint64_t dev, std::uint64_t ino)
+    {
+        std::uint64_t t = tag(h);
+        std::size_t mask = sh.mask;
+        // the low bits picked the shard, the probe starts with the next ones
+        std::size_t i = static_cast<std::size_t>(h >> SHARD_BITS) & mask;
+        for (std::size_t probes = 0; probes <= mask; ++probes, i = (i + 1) & mask)
+        {
+            Slot& s = sh.slots[i];
+            std::uint64_t state = s.state.load(std::memory_order_acquire);
+            if (state == FREE)
+            {
+                if (s.state.compare_exchange_strong(state, BUSY, std::memory_order_acquire, std::memory_order_acquire))
+                {
+                    s.dev = dev;
+                    s.ino = ino;
+                    s.state.store(t, std::memory_order_release);
+                    return Insert::Added;
+                }
+                // somebody else took it - state is what the other thread put there
+            }
+            while (state == BUSY)
+            {
+                std::this_thread::yield();  // a few stores away, unless the writer was preempted
+                state = s.state.load(std::memory_order_acquire);
+            }
+            if (state == t && s.dev == dev && s.ino == ino)
+                return Insert::Present;
+        }
+        return Insert::Full;
+    }
+
+    static void allocate(Shard& sh, std::size_t slots)
+    {
+        sh.slots.reset(new Slot[slots]());
+        sh.mask = slots - 1;
+    }
+
+    /// Doubles the table unless somebody else did it since we saw mask.
+    static void grow(Shard& sh, std::size_t seenMask)
+    {
+        std::lock_guard<SharedReadMutex> lck(sh.growLock);
+        if (sh.mask != seenMask)
+            return;
+        std::unique_ptr<Slot[]> old = std::move(sh.slots);
+        std::size_t oldSize = sh.mask + 1;
+        allocate(sh, oldSize * 2);
+        for (std::size_t j = 0; j < oldSize; ++j)
+        {
+            std::uint64_t state = old[j].state.load(std::memory_order_relaxed);
+            if (state < 2)
+                continue;
+            std::size_t i = static_cast<std::size_t>(hash(old[j].dev, old[j].ino) >> SHARD_BITS) & sh.mask;
+            while (sh.slots[i].state.load(std::memory_order_relaxed) != FREE)
+                i = (i + 1) & sh.mask;
+            sh.slots[i].dev = old[j].dev;
+            sh.slots[i].ino = old[j].ino;
+            sh.slots[i].state.store(state, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    /// expected - about how many directories, the shards start big enough for them.
+    explicit VisitedSet(std::size_t expected = 0)
+    {
+        std::size_t perShard = 64;
+        while (limit(perShard - 1) < expected / SHARDS + 1)
+            perShard *= 2;
+        for (std::size_t i = 0; i < SHARDS; ++i)
+        {
+            _shards.emplace_back(new Shard);
+            allocate(*_shards.back(), perShard);
+        }
+    }
+
+    VisitedSet(const VisitedSet&) = delete;
+    VisitedSet& operator=(const VisitedSet&) = delete;
+
+    /// true for the first insert of (dev, ino) - that caller lists the directory.
+    bool insert(std::uint64_t dev, std::uint64_t ino)
+    {
+        std::uint64_t h = hash(dev, ino);
+        Shard& sh = *_shards[h & (SHARDS - 1)];
+        for (;;)
+        {
+            Insert r;
+            std::size_t mask;
+            bool full = false;
+            {
+                SharedReadGuard g(sh.growLock);
+                mask = sh.mask;
+                r = tryInsert(sh, h, dev, ino);
+                if (r == Insert::Added)
+                    full = sh.count.fetch_add(1, std::memory_order_relaxed) + 1 > limit(mask);
+            }
+            if (r == Insert::Full || full)
+                grow(sh, mask);
+            if (r != Insert::Full)
+                return r == Insert::Added;
+        }
+    }
+
+    std::size_t size() const
+    {
+        std::size_t n = 0;
+        for (const std::unique_ptr<Shard>& sh : _shards)
+            n += sh->count.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    /// Bytes of the tables (not the locks).
+    std::size_t memoryBytes() const
+    {
+        std::size_t n = 0;
+        for (const std::unique_ptr<Shard>& sh : _shards)
+            n += (sh->mask + 1) * sizeof(Slot);
+        return n;
+    }
+};
+
+#endif // CONCURENCY_VISITED_SET_H
@@ -0,0 +1,96 @@
+#ifndef CONCURENCY_WALK_POLICY_H
+#define CONCURENCY_WALK_POLICY_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <sys/stat.h>
+#include "visited_set.h"
+
+/*
+ * Which directories a crawl goes into.
+ *
+ * The crawls list a tree physically: a symlink is an entry like a file, even when it points
+ * to a directory (forEachEntry in include/crawl_errors.h). A WalkPolicy shared by all the
+ * workers of one crawl changes that:
+ *
+ *  followSymlinks  - a symlink to a directory is listed as the directory. Every directory
+ *                    goes through the VisitedSet first, so each physical directory is listed
+ *                    exactly once - a link to a parent ends there, two links to one directory
+ *                    list it once. It catches bind mounts too.
+ *  oneFileSystem   - don't cross into other file systems (find -xdev): a directory with
+ *                    another st_dev than the root isn't listed.
+ *
+ *   WalkOptions opt;
+ *   opt.followSymlinks = true;
+ *   WalkPolicy walk(root, opt);
+ *   CrawlHooks hooks;
+ *   hooks.walk = &walk;
+ *   listAllFiles(root, 8, token, executor, hooks);
+ */
+
+struct WalkOptions
+{
+    bool followSymlinks;
+    bool oneFileSystem;
+    std::size_t expectedDirs;   // sizes the visited set up front
+
+    WalkOptions() : followSymlinks(false), oneFileSystem(false), expectedDirs(0) {}
+};
+
+class WalkPolicy
+{
+    WalkOptions _opt;
+    dev_t _rootDev;
+    std::unique_ptr<VisitedSet> _visited;   // only when following
+    std::atomic<std::size_t> _seenAgain;
+    std::atomic<std::size_t> _otherDevice;
+
+public:
+    WalkPolicy(const std::string& root, const WalkOptions& opt = WalkOptions())
+        : _opt(opt), _rootDev(0), _seenAgain(0), _otherDevice(0)
+    {
+        if (_opt.followSymlinks)
+            _visited.reset(new VisitedSet(_opt.expectedDirs));
+        struct stat st;
+        if (::stat(root.c_str(), &st) == 0)
+        {
+            _rootDev = st.st_dev;
+            if (_visited)
+                _visited->insert(st.st_dev, st.st_ino);
+        }
+    }
+
+    WalkPolicy(const WalkPolicy&) = delete;
+    WalkPolicy& operator=(const WalkPolicy&) = delete;
+
+    bool followSymlinks() const { return _opt.followSymlinks; }
+
+    /// A directory was found (st is its stat, through the link when following);
+    /// false if it must not be listed.
+    bool enter(const struct stat& st)
+    {
+        if (_opt.oneFileSystem && st.st_dev != _rootDev)
+        {
+            _otherDevice.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (_visited && !_visited->insert(st.st_dev, st.st_ino))
+        {
+            _seenAgain.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    /// Directories not listed because they were listed already (only when following).
+    std::size_t seenAgain() const { return _seenAgain; }
+    /// Directories not listed because they are on another file system.
+    std::size_t otherDevice() const { return _otherDevice; }
+    /// Distinct directories (only when following).
+    std::size_t visited() const { return _visited ? _visited->size() : 0; }
+};
+
+#endif // CONCURENCY_WALK_POLICY_H